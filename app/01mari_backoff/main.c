@@ -14,18 +14,25 @@
 #include "mr_rng.h"
 #include "mr_timer_hf.h"
 #include "association.h"
+#include "scheduler.h"
+#include "packet.h"
 
 //=========================== defines ==========================================
 
 #define MARI_APP_TIMER_DEV 1
 
+//=========================== variables ========================================
+
+extern schedule_t schedule_huge;
+
 //============================ main ============================================
 
 int main(void) {
     printf("Test Mari Backoff\n");
     mr_timer_hf_init(MARI_APP_TIMER_DEV);
 
-    mr_assoc_init(NULL);
+    mr_assoc_init(MARI_NET_ID_DEFAULT, NULL);
+    mr_scheduler_init(&schedule_huge);
 
     // test backoff re-schedule execution time (depends on rng)
     size_t   n_runs      = 10;
@@ -22,39 +22,39 @@ int main(void) {
     }
 }
 
-// NOTE: this test depends on MARI_MAX_SCAN_LIST_SIZE being 10
+static uint64_t _selected(uint32_t ts_scan_started, uint32_t ts_scan_ended) {
+    mr_channel_info_t selected = { 0 };
+    mr_scan_select(&selected, ts_scan_started, ts_scan_ended);
+    return selected.beacon.src;
+}
+
+// NOTE: this test depends on MARI_MAX_SCAN_LIST_SIZE being 32
 void test_scan(void) {
-    mr_beacon_packet_header_t beacon = { 0 };
+    mr_beacon_packet_header_t beacon = { .remaining_capacity = 10 };
 
     beacon.src = 1;  // src is the gateway_id
-    mr_scan_add(beacon, 1, 37, 1);
-    mr_scan_add(beacon, 2, 37, 2);  // update new rssi info wrt gateway_id = 1
+    mr_scan_add(beacon, -60, 37, 1, 0);
+    mr_scan_add(beacon, -58, 38, 2, 0);  // update the rssi averages of gateway_id = 1
 
     beacon.src = 2;
-    mr_scan_add(beacon, 2, 37, 3);
-    beacon.src = 3;
-    mr_scan_add(beacon, 1, 37, 4);
-    beacon.src = 4;
-    mr_scan_add(beacon, 1, 37, 5);
-    beacon.src = 5;
-    mr_scan_add(beacon, 1, 37, 6);
-    printf("Selected gateway should be 1: %llu\n", mr_scan_select(1, 7).beacon.src);
-
-    beacon.src = 6;
-    mr_scan_add(beacon, 1, 37, 7);
-    beacon.src = 7;
-    mr_scan_add(beacon, 1, 37, 8);
-    beacon.src = 8;
-    mr_scan_add(beacon, 1, 37, 9);
-    beacon.src = 9;
-    mr_scan_add(beacon, 1, 37, 10);
-    beacon.src = 10;
-    mr_scan_add(beacon, 1, 37, 11);
-    beacon.src = 11;
-    mr_scan_add(beacon, 1, 37, 12);                                                    // scan list is full, override oldest scan (gateway_id = 1)
-    printf("Selected gateway should be 2: %llu\n", mr_scan_select(1, 13).beacon.src);  // and not 1, because 11 overrides 1
-
-    beacon.src = 8;
-    mr_scan_add(beacon, 3, 38, 13);
-    printf("Selected gateway should be 8: %llu\n", mr_scan_select(1, MARI_SCAN_OLD_US + 5).beacon.src);
+    mr_scan_add(beacon, -80, 37, 3, 0);
+    printf("Selected gateway should be 1: %llu\n", _selected(1, 4));
+
+    // fill the scan list, gateway_id = 1 is the least recently heard and gets replaced
+    for (uint32_t i = 0; i < MARI_MAX_SCAN_LIST_SIZE - 1; i++) {
+        beacon.src = 3 + i;
+        mr_scan_add(beacon, -90, 37, 4 + i, 0);
+    }
+    printf("Selected gateway should be 2: %llu\n", _selected(1, 4 + MARI_MAX_SCAN_LIST_SIZE));
+
+    // a full gateway is never selected
+    beacon.src                = 8;
+    beacon.remaining_capacity = 0;
+    mr_scan_add(beacon, -30, 38, 100, 0);
+    printf("Selected gateway should be 2: %llu\n", _selected(1, 101));
+
+    // only recent readings count
+    beacon.remaining_capacity = 10;
+    mr_scan_add(beacon, -30, 38, MARI_SCAN_OLD_US, 0);
+    printf("Selected gateway should be 8: %llu\n", _selected(1, MARI_SCAN_OLD_US + 5));
 }
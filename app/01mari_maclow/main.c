@@ -27,7 +27,7 @@ schedule_t schedule_test_app = {
     .backoff_n_min = 5,
     .backoff_n_max = 9,
     .n_cells       = 5,
-    .cells         = {
+    .cells         = (cell_t[]){
         //{'B', 0, NULL},
         //{'S', 1, NULL},
         //{'D', 2, NULL},
@@ -66,6 +66,7 @@ int main(void) {
 
     mari_set_node_type(node_type);
 
+    mr_queue_init();
     mr_assoc_init(MARI_NET_ID_DEFAULT, mari_event_callback);
 
     mr_scheduler_init(&schedule);
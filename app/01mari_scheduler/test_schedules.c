@@ -7,7 +7,7 @@ schedule_t schedule_test_app = {
     .backoff_n_min = 5,
     .backoff_n_max = 9,
     .n_cells       = 5,
-    .cells         = {
+    .cells         = (cell_t[]){
         // Only downlink slot_durations
         { 'B', 0, NULL },
         { 'S', 1, NULL },
@@ -24,7 +24,7 @@ schedule_t schedule_all_uplink = {
     .backoff_n_min = 5,
     .backoff_n_max = 9,
     .n_cells       = 5,
-    .cells         = {
+    .cells         = (cell_t[]){
         // Only downlink slot_durations
         { 'U', 0, NULL },
         { 'U', 1, NULL },
@@ -41,7 +41,7 @@ schedule_t schedule_all_downlink = {
     .backoff_n_min = 5,
     .backoff_n_max = 9,
     .n_cells       = 5,
-    .cells         = {
+    .cells         = (cell_t[]){
         // Only downlink slot_durations
         { 'D', 0, NULL },
         { 'D', 1, NULL },
@@ -25,6 +25,7 @@
 #include "mari.h"
 #include "packet.h"
 #include "models.h"
+#include "profile.h"
 
 #include "metrics.h"
 
@@ -35,14 +36,21 @@
 
 #define MARI_APP_TIMER_DEV 1
 
+#define MARI_APP_EVENT_BATCH 8   // events handled per wake-up, e.g. several nodes leaving in the same slot
+#define MARI_APP_STATS_TICKS 10  // gateway loop ticks between two stats frames
+
 typedef struct {
-    mr_event_t      mari_event;
-    mr_event_data_t mari_event_data;
-    bool            mari_event_ready;
-    bool            uart_to_radio_packet_ready;
-    bool            to_uart_gateway_loop_ready;
-    uint32_t        tx_count;
-    uint32_t        rx_count;
+    mari_event_t       mari_events[MARI_APP_EVENT_BATCH];
+    bool               uart_to_radio_packet_ready;
+    bool               to_uart_gateway_loop_ready;
+    bool               send_link_deltas;  // alternates gateway info and link deltas frames
+    uint32_t           loop_ticks;
+    uint32_t           tx_count;
+    uint32_t           rx_count;
+    mr_profile_entry_t profile[MARI_PROFILE_N];  // snapshot taken on request, sent one frame per loop tick
+    size_t             profile_n_points;
+    uint8_t            profile_offset;
+    bool               profile_pending;
 } gateway_vars_t;
 
 typedef struct {
@@ -55,14 +63,77 @@ typedef struct {
 gateway_vars_t _app_vars = { 0 };
 
 extern schedule_t schedule_tiny, schedule_medium, schedule_big, schedule_huge;
-schedule_t       *schedule_app = &schedule_huge;
+#if MARI_ENABLE_SCHEDULE_MIGRATION
+schedule_t *schedule_app = &schedule_tiny;  // start small, the schedule grows with the number of nodes
+#else
+schedule_t *schedule_app = &schedule_huge;
+#endif
 
 volatile __attribute__((section(".shared_data"))) ipc_shared_data_t ipc_shared_data;
 
-static void _mari_event_callback(mr_event_t event, mr_event_data_t event_data) {
-    _app_vars.mari_event = event;
-    memcpy(&_app_vars.mari_event_data, &event_data, sizeof(mr_event_data_t));
-    _app_vars.mari_event_ready = true;
+static void _handle_mari_event(mari_event_t *mari_event) {
+    mr_event_t      event      = mari_event->event;
+    mr_event_data_t event_data = mari_event->event_data;
+
+    uint32_t now_ts_s     = mr_timer_hf_now(MARI_APP_TIMER_DEV) / 1000 / 1000;
+    bool     send_to_uart = false;
+    switch (event) {
+        case MARI_NEW_PACKET:
+        {
+            // latency probes sent by the gateway itself only go into the summaries
+            if (metrics_is_latency_probe(event_data.data.new_packet.payload, event_data.data.new_packet.payload_len)) {
+                metrics_handle_latency_probe(event_data.data.new_packet.header->src, event_data.data.new_packet.payload);
+                break;
+            }
+
+            // handle metrics probe
+            if (metrics_is_probe(event_data.data.new_packet.payload, event_data.data.new_packet.payload_len)) {
+                metrics_handle_rx_probe(event_data.data.new_packet.header->src, event_data.data.new_packet.payload);
+            }
+
+            // the payload does not follow the header when it was taken out of an aggregated frame, so copy them one by one
+            // and forward them as a regular data packet
+            mr_packet_header_t header         = *event_data.data.new_packet.header;
+            header.type                       = MARI_PACKET_DATA;
+            ipc_shared_data.radio_to_uart_len = event_data.data.new_packet.len + 1;
+            ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_DATA;
+            memcpy((void *)ipc_shared_data.radio_to_uart + 1, &header, sizeof(mr_packet_header_t));
+            memcpy((void *)ipc_shared_data.radio_to_uart + 1 + sizeof(mr_packet_header_t), event_data.data.new_packet.payload, event_data.data.new_packet.payload_len);
+            send_to_uart = true;
+            break;
+        }
+        case MARI_KEEPALIVE:
+            ipc_shared_data.radio_to_uart_len = 1 + sizeof(uint64_t);
+            ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_KEEPALIVE;
+            memcpy((void *)ipc_shared_data.radio_to_uart + 1, &event_data.data.node_info.node_id, sizeof(uint64_t));
+            send_to_uart = true;
+            break;
+        case MARI_NODE_JOINED:
+            printf("%d New node joined: %016llX  (%d nodes connected)\n", now_ts_s, event_data.data.node_info.node_id, mari_gateway_count_nodes());
+            metrics_add_node(event_data.data.node_info.node_id);
+            ipc_shared_data.radio_to_uart_len = 1 + sizeof(uint64_t);
+            ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_NODE_JOINED;
+            memcpy((void *)ipc_shared_data.radio_to_uart + 1, &event_data.data.node_info.node_id, sizeof(uint64_t));
+            send_to_uart = true;
+            break;
+        case MARI_NODE_LEFT:
+            printf("%d Node left: %016llX, reason: %u  (%d nodes connected)\n", now_ts_s, event_data.data.node_info.node_id, event_data.tag, mari_gateway_count_nodes());
+            metrics_clear_node(event_data.data.node_info.node_id);
+            ipc_shared_data.radio_to_uart_len = 1 + sizeof(uint64_t);
+            ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_NODE_LEFT;
+            memcpy((void *)ipc_shared_data.radio_to_uart + 1, &event_data.data.node_info.node_id, sizeof(uint64_t));
+            send_to_uart = true;
+            break;
+        case MARI_ERROR:
+            printf("Error, reason: %u\n", event_data.tag);
+            break;
+        default:
+            break;
+    }
+
+    if (send_to_uart) {
+        NRF_IPC_NS->TASKS_SEND[IPC_CHAN_RADIO_TO_UART] = 1;
+    }
 }
 
 static void _to_uart_gateway_loop(void) {
@@ -94,10 +165,10 @@ int main(void) {
     mr_timer_hf_init(MARI_APP_TIMER_DEV);
     _init_ipc();
 
-    mari_init(MARI_GATEWAY, _net_id(), schedule_app, &_mari_event_callback);
+    mari_init(MARI_GATEWAY, _net_id(), schedule_app, NULL);  // events are polled from the main loop
 
-    // NOTE: to send the stats every slotframe, we need to use the duration of the slotframe
-    mr_timer_hf_set_periodic_us(MARI_APP_TIMER_DEV, 3, mr_scheduler_get_duration_us(), &_to_uart_gateway_loop);
+    // NOTE: the slotframe duration changes when the schedule is switched, so use the one of the largest schedule
+    mr_timer_hf_set_periodic_us(MARI_APP_TIMER_DEV, 3, MARI_WHOLE_SLOT_DURATION * schedule_huge.n_cells, &_to_uart_gateway_loop);
 
     // Unlock the application core
     ipc_shared_data.net_ready = true;
@@ -105,65 +176,25 @@ int main(void) {
     while (1) {
         __WFE();
 
-        if (_app_vars.mari_event_ready) {
-            _app_vars.mari_event_ready = false;
-
-            mr_event_t      event      = _app_vars.mari_event;
-            mr_event_data_t event_data = _app_vars.mari_event_data;
-
-            uint32_t now_ts_s     = mr_timer_hf_now(MARI_APP_TIMER_DEV) / 1000 / 1000;
-            bool     send_to_uart = false;
-            switch (event) {
-                case MARI_NEW_PACKET:
-                {
-                    // handle metrics probe
-                    if (metrics_is_probe(event_data.data.new_packet.payload, event_data.data.new_packet.payload_len)) {
-                        metrics_handle_rx_probe(event_data.data.new_packet.header->src, event_data.data.new_packet.payload);
-                    }
-
-                    ipc_shared_data.radio_to_uart_len = event_data.data.new_packet.len + 1;
-                    ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_DATA;
-                    memcpy((void *)ipc_shared_data.radio_to_uart + 1, event_data.data.new_packet.header, event_data.data.new_packet.len);
-                    send_to_uart = true;
-                    break;
-                }
-                case MARI_KEEPALIVE:
-                    ipc_shared_data.radio_to_uart_len = 1 + sizeof(uint64_t);
-                    ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_KEEPALIVE;
-                    memcpy((void *)ipc_shared_data.radio_to_uart + 1, &event_data.data.node_info.node_id, sizeof(uint64_t));
-                    send_to_uart = true;
-                    break;
-                case MARI_NODE_JOINED:
-                    printf("%d New node joined: %016llX  (%d nodes connected)\n", now_ts_s, event_data.data.node_info.node_id, mari_gateway_count_nodes());
-                    metrics_add_node(event_data.data.node_info.node_id);
-                    ipc_shared_data.radio_to_uart_len = 1 + sizeof(uint64_t);
-                    ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_NODE_JOINED;
-                    memcpy((void *)ipc_shared_data.radio_to_uart + 1, &event_data.data.node_info.node_id, sizeof(uint64_t));
-                    send_to_uart = true;
-                    break;
-                case MARI_NODE_LEFT:
-                    printf("%d Node left: %016llX, reason: %u  (%d nodes connected)\n", now_ts_s, event_data.data.node_info.node_id, event_data.tag, mari_gateway_count_nodes());
-                    metrics_clear_node(event_data.data.node_info.node_id);
-                    ipc_shared_data.radio_to_uart_len = 1 + sizeof(uint64_t);
-                    ipc_shared_data.radio_to_uart[0]  = MARI_EDGE_NODE_LEFT;
-                    memcpy((void *)ipc_shared_data.radio_to_uart + 1, &event_data.data.node_info.node_id, sizeof(uint64_t));
-                    send_to_uart = true;
-                    break;
-                case MARI_ERROR:
-                    printf("Error, reason: %u\n", event_data.tag);
-                    break;
-                default:
-                    break;
-            }
-
-            if (send_to_uart) {
-                NRF_IPC_NS->TASKS_SEND[IPC_CHAN_RADIO_TO_UART] = 1;
-            }
+        size_t n_events = mari_poll_events(_app_vars.mari_events, MARI_APP_EVENT_BATCH);
+        for (size_t i = 0; i < n_events; i++) {
+            _handle_mari_event(&_app_vars.mari_events[i]);
+            mari_release_event(&_app_vars.mari_events[i]);
         }
 
         if (_app_vars.uart_to_radio_packet_ready) {
             _app_vars.uart_to_radio_packet_ready = false;
             uint8_t packet_type                  = ipc_shared_data.uart_to_radio_tx[0];
+            if (packet_type == MARI_EDGE_PROBE_CONFIG) {
+                metrics_probe_config((const mr_uart_packet_probe_config_t *)(ipc_shared_data.uart_to_radio_tx + 1), ipc_shared_data.uart_to_radio_len - 1);
+                continue;
+            }
+            if (packet_type == MARI_EDGE_PROFILE) {
+                _app_vars.profile_n_points = mari_profile_snapshot(_app_vars.profile);
+                _app_vars.profile_offset   = 0;
+                _app_vars.profile_pending  = true;
+                continue;
+            }
             if (packet_type != MARI_EDGE_DATA) {
                 printf("Invalid UART packet type: %02X\n", packet_type);
                 continue;
@@ -187,9 +218,40 @@ int main(void) {
         }
 
         if (_app_vars.to_uart_gateway_loop_ready) {
-            _app_vars.to_uart_gateway_loop_ready           = false;
-            ipc_shared_data.radio_to_uart[0]               = MARI_EDGE_GATEWAY_INFO;
-            size_t len                                     = mr_build_uart_packet_gateway_info((uint8_t *)(ipc_shared_data.radio_to_uart + 1));
+            _app_vars.to_uart_gateway_loop_ready = false;
+            metrics_probe_tick();
+
+            // a requested profile comes first, then latency summaries once per summary period,
+            // both take the place of the other frames until they are all sent
+            size_t len = 0;
+            if (_app_vars.profile_pending) {
+                ipc_shared_data.radio_to_uart[0] = MARI_EDGE_PROFILE;
+                len                              = mr_build_uart_packet_profile((uint8_t *)(ipc_shared_data.radio_to_uart + 1), _app_vars.profile, _app_vars.profile_n_points, _app_vars.profile_offset);
+                _app_vars.profile_offset += MARI_PROFILE_PER_FRAME;
+                _app_vars.profile_pending = _app_vars.profile_offset < _app_vars.profile_n_points;
+            } else {
+                ipc_shared_data.radio_to_uart[0] = MARI_EDGE_LATENCY;
+                len                              = metrics_build_uart_packet_latency((uint8_t *)(ipc_shared_data.radio_to_uart + 1));
+            }
+            if (len == 0 && ++_app_vars.loop_ticks % MARI_APP_STATS_TICKS == 0) {
+                ipc_shared_data.radio_to_uart[0] = MARI_EDGE_STATS;
+                len                              = mr_build_uart_packet_stats((uint8_t *)(ipc_shared_data.radio_to_uart + 1));
+            }
+            if (len == 0 && _app_vars.send_link_deltas) {
+                ipc_shared_data.radio_to_uart[0] = MARI_EDGE_LINK_DELTAS;
+                len                              = mr_build_uart_packet_link_deltas((uint8_t *)(ipc_shared_data.radio_to_uart + 1));
+                if (len == sizeof(mr_uart_packet_link_deltas_t)) {
+                    // no link changed, send the gateway info instead
+                    len = 0;
+                }
+            }
+            if (len == 0) {
+                ipc_shared_data.radio_to_uart[0] = MARI_EDGE_GATEWAY_INFO;
+                len                              = mr_build_uart_packet_gateway_info((uint8_t *)(ipc_shared_data.radio_to_uart + 1));
+            }
+            if (ipc_shared_data.radio_to_uart[0] != MARI_EDGE_PROFILE && ipc_shared_data.radio_to_uart[0] != MARI_EDGE_LATENCY && ipc_shared_data.radio_to_uart[0] != MARI_EDGE_STATS) {
+                _app_vars.send_link_deltas = !_app_vars.send_link_deltas;
+            }
             ipc_shared_data.radio_to_uart_len              = 1 + len;
             NRF_IPC_NS->TASKS_SEND[IPC_CHAN_RADIO_TO_UART] = 1;
         }
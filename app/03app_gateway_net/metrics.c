@@ -10,9 +10,12 @@
  */
 
 #include <stdbool.h>
+#include <string.h>
 
 #include "mr_radio.h"
 #include "mac.h"
+#include "mari.h"
+#include "packet.h"
 #include "models.h"
 
 #include "metrics.h"
@@ -25,30 +28,60 @@ typedef struct {
     uint32_t rx_count;
 } node_metrics_t;
 
+typedef struct {
+    bool                 joined;          ///< Only joined nodes are probed
+    uint16_t             seq;             ///< Of the next probe
+    uint64_t             next_probe_asn;  ///< When to probe the node again
+    mr_latency_summary_t summary;         ///< Since the previous summary, node_id is 0 if the entry is free
+} latency_node_t;
+
 //=========================== variables ========================================
 
 typedef struct {
     node_metrics_t nodes[MARI_N_CELLS_MAX];
+
+    // latency probes
+    latency_node_t latency[MARI_LATENCY_MAX_NODES];
+    bool           probe_any_node;      ///< Any joined node is probed, as opposed to the ones given by the host
+    uint32_t       probe_period_ms;     ///< 0 while probing is stopped
+    uint64_t       probe_period_asn;
+    uint64_t       summary_period_asn;
+    uint64_t       next_summary_asn;
+    bool           summary_pending;     ///< Summaries are due and not all of them were sent yet
+    size_t         probe_cursor;        ///< Probes are sent round robin, a few per tick
+    size_t         summary_cursor;
 } metrics_vars_t;
 
 metrics_vars_t metrics_vars = { 0 };
 
+//=========================== prototypes =======================================
+
+static latency_node_t *_latency_find(uint64_t node_id);
+static void            _latency_add(uint64_t node_id);
+
 //=========================== functions ========================================
 
 void metrics_init(void) {
 }
 
 void metrics_add_node(uint64_t node_id) {
-    for (uint8_t i = 0; i < MARI_N_CELLS_MAX; i++) {
+    for (size_t i = 0; i < MARI_N_CELLS_MAX; i++) {
         if (metrics_vars.nodes[i].node_id == 0) {
             metrics_vars.nodes[i].node_id = node_id;
             break;
         }
     }
+
+    latency_node_t *latency = _latency_find(node_id);
+    if (latency != NULL) {
+        latency->joined = true;
+    } else if (metrics_vars.probe_any_node) {
+        _latency_add(node_id);
+    }
 }
 
 void metrics_clear_node(uint64_t node_id) {
-    for (uint8_t i = 0; i < MARI_N_CELLS_MAX; i++) {
+    for (size_t i = 0; i < MARI_N_CELLS_MAX; i++) {
         if (metrics_vars.nodes[i].node_id == node_id) {
             metrics_vars.nodes[i].node_id  = 0;
             metrics_vars.nodes[i].tx_count = 0;
@@ -56,6 +89,12 @@ void metrics_clear_node(uint64_t node_id) {
             break;
         }
     }
+
+    // the entry is kept until its last summary is sent
+    latency_node_t *latency = _latency_find(node_id);
+    if (latency != NULL) {
+        latency->joined = false;
+    }
 }
 
 bool metrics_is_probe(uint8_t *payload, uint32_t payload_len) {
@@ -68,7 +107,7 @@ void metrics_handle_rx_probe(uint64_t node_id, uint8_t *payload) {
     metrics_payload->gw_rx_asn  = mr_mac_get_asn();
     metrics_payload->rssi_at_gw = mr_radio_rssi();
 
-    for (uint8_t i = 0; i < MARI_N_CELLS_MAX; i++) {
+    for (size_t i = 0; i < MARI_N_CELLS_MAX; i++) {
         if (metrics_vars.nodes[i].node_id == node_id) {
             metrics_payload->gw_rx_count = ++metrics_vars.nodes[i].rx_count;
             break;
@@ -81,10 +120,195 @@ void metrics_handle_tx_probe(uint64_t node_id, uint8_t *payload) {
 
     metrics_payload->gw_tx_enqueued_asn = mr_mac_get_asn();
 
-    for (uint8_t i = 0; i < MARI_N_CELLS_MAX; i++) {
+    for (size_t i = 0; i < MARI_N_CELLS_MAX; i++) {
         if (metrics_vars.nodes[i].node_id == node_id) {
             metrics_payload->gw_tx_count = ++metrics_vars.nodes[i].tx_count;
             break;
         }
     }
 }
+
+void metrics_probe_config(const mr_uart_packet_probe_config_t *config, size_t length) {
+    if (length < sizeof(mr_uart_packet_probe_config_t) || config->n_nodes > MARI_LATENCY_MAX_NODES || length < sizeof(mr_uart_packet_probe_config_t) + config->n_nodes * sizeof(uint64_t)) {
+        return;
+    }
+
+    // summaries of the previous configuration are dropped
+    memset(metrics_vars.latency, 0, sizeof(metrics_vars.latency));
+    uint32_t summary_period_ms      = config->summary_period_ms ? config->summary_period_ms : METRICS_LATENCY_SUMMARY_PERIOD_MS_DEFAULT;
+    uint64_t asn                    = mr_mac_get_asn();
+    metrics_vars.probe_period_ms    = config->period_ms;
+    metrics_vars.probe_period_asn   = (uint64_t)config->period_ms * 1000 / MARI_WHOLE_SLOT_DURATION;
+    metrics_vars.summary_period_asn = (uint64_t)summary_period_ms * 1000 / MARI_WHOLE_SLOT_DURATION;
+    metrics_vars.next_summary_asn   = asn + metrics_vars.summary_period_asn;
+    metrics_vars.summary_pending    = false;
+    metrics_vars.probe_any_node     = config->n_nodes == 0 && config->period_ms != 0;
+    metrics_vars.probe_cursor       = 0;
+    if (config->period_ms == 0) {
+        return;
+    }
+
+    if (metrics_vars.probe_any_node) {
+        for (size_t i = 0; i < MARI_N_CELLS_MAX; i++) {
+            if (metrics_vars.nodes[i].node_id != 0) {
+                _latency_add(metrics_vars.nodes[i].node_id);
+            }
+        }
+    } else {
+        for (uint8_t i = 0; i < config->n_nodes; i++) {
+            uint64_t node_id;
+            memcpy(&node_id, &config->node_ids[i], sizeof(uint64_t));
+            _latency_add(node_id);
+        }
+        for (size_t i = 0; i < MARI_LATENCY_MAX_NODES; i++) {
+            metrics_vars.latency[i].joined = false;
+            for (size_t j = 0; j < MARI_N_CELLS_MAX && metrics_vars.latency[i].summary.node_id != 0; j++) {
+                if (metrics_vars.nodes[j].node_id == metrics_vars.latency[i].summary.node_id) {
+                    metrics_vars.latency[i].joined = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // spread the probes over the period
+    for (size_t i = 0; i < MARI_LATENCY_MAX_NODES; i++) {
+        metrics_vars.latency[i].next_probe_asn = asn + metrics_vars.probe_period_asn * i / MARI_LATENCY_MAX_NODES;
+    }
+}
+
+void metrics_probe_tick(void) {
+    if (metrics_vars.probe_period_ms == 0) {
+        return;
+    }
+
+    uint64_t asn  = mr_mac_get_asn();
+    size_t   sent = 0;
+    for (size_t n = 0; n < MARI_LATENCY_MAX_NODES && sent < METRICS_PROBES_PER_TICK; n++) {
+        latency_node_t *latency   = &metrics_vars.latency[metrics_vars.probe_cursor];
+        metrics_vars.probe_cursor = (metrics_vars.probe_cursor + 1) % MARI_LATENCY_MAX_NODES;
+        if (latency->summary.node_id == 0 || !latency->joined || asn < latency->next_probe_asn) {
+            continue;
+        }
+
+        mr_latency_probe_t probe = { .type = MARI_PAYLOAD_TYPE_LATENCY_PROBE, .seq = latency->seq, .tx_asn = asn };
+        uint8_t            packet[MARI_PACKET_MAX_SIZE];
+        size_t             length = mr_build_packet_data(packet, latency->summary.node_id, (uint8_t *)&probe, sizeof(probe));
+        // a probe still in the queue after a period is as good as lost
+        if (!mari_tx_with_priority(packet, length, MARI_PRIORITY_NORMAL, metrics_vars.probe_period_ms)) {
+            return;  // queue full, try again at the next tick
+        }
+        latency->seq++;
+        latency->next_probe_asn = asn + metrics_vars.probe_period_asn;
+        if (latency->summary.sent < UINT16_MAX) {
+            latency->summary.sent++;
+        }
+        sent++;
+    }
+}
+
+bool metrics_is_latency_probe(uint8_t *payload, uint32_t payload_len) {
+    return payload_len == sizeof(mr_latency_probe_t) && payload[0] == MARI_PAYLOAD_TYPE_LATENCY_PROBE;
+}
+
+void metrics_handle_latency_probe(uint64_t node_id, uint8_t *payload) {
+    mr_latency_probe_t probe;
+    memcpy(&probe, payload, sizeof(mr_latency_probe_t));
+    latency_node_t *latency = _latency_find(node_id);
+    uint64_t        asn     = mr_mac_get_asn();
+    if (latency == NULL || probe.tx_asn > asn) {
+        return;
+    }
+
+    mr_latency_summary_t *summary = &latency->summary;
+    uint64_t              rtt     = asn - probe.tx_asn;
+    uint16_t              rtt_16  = rtt < UINT16_MAX ? rtt : UINT16_MAX;
+    if (summary->received == 0 || rtt_16 < summary->rtt_min) {
+        summary->rtt_min = rtt_16;
+    }
+    if (rtt_16 > summary->rtt_max) {
+        summary->rtt_max = rtt_16;
+    }
+    summary->rtt_sum = rtt < UINT32_MAX - summary->rtt_sum ? summary->rtt_sum + rtt : UINT32_MAX;
+
+    // index of the highest bit set
+    uint8_t bucket = 31 - __builtin_clz((uint32_t)rtt_16 | 1);
+    if (bucket >= MARI_LATENCY_N_BUCKETS) {
+        bucket = MARI_LATENCY_N_BUCKETS - 1;
+    }
+    if (summary->buckets[bucket] < UINT16_MAX) {
+        summary->buckets[bucket]++;
+    }
+    if (summary->received < UINT16_MAX) {
+        summary->received++;
+    }
+}
+
+size_t metrics_build_uart_packet_latency(uint8_t *buffer) {
+    if (!metrics_vars.summary_pending) {
+        if (metrics_vars.summary_period_asn == 0 || mr_mac_get_asn() < metrics_vars.next_summary_asn) {
+            return 0;
+        }
+        metrics_vars.summary_pending = true;
+        metrics_vars.summary_cursor  = 0;
+        metrics_vars.next_summary_asn += metrics_vars.summary_period_asn;
+    }
+
+    mr_uart_packet_latency_t *packet = (mr_uart_packet_latency_t *)buffer;
+    packet->count                    = 0;
+    for (; metrics_vars.summary_cursor < MARI_LATENCY_MAX_NODES && packet->count < METRICS_LATENCY_PER_FRAME; metrics_vars.summary_cursor++) {
+        latency_node_t *latency = &metrics_vars.latency[metrics_vars.summary_cursor];
+        if (latency->summary.node_id == 0) {
+            continue;
+        }
+        if (latency->summary.sent != 0 || latency->summary.received != 0) {
+            memcpy(&packet->summaries[packet->count++], &latency->summary, sizeof(mr_latency_summary_t));
+        }
+
+        // snapshot and reset
+        uint64_t node_id = latency->summary.node_id;
+        memset(&latency->summary, 0, sizeof(mr_latency_summary_t));
+        if (latency->joined || !metrics_vars.probe_any_node) {
+            latency->summary.node_id = node_id;
+        }
+    }
+    if (metrics_vars.summary_cursor == MARI_LATENCY_MAX_NODES) {
+        metrics_vars.summary_pending = false;
+        if (metrics_vars.probe_any_node && metrics_vars.probe_period_ms != 0) {
+            // nodes that joined while all the entries were taken
+            for (size_t i = 0; i < MARI_N_CELLS_MAX; i++) {
+                _latency_add(metrics_vars.nodes[i].node_id);
+            }
+        }
+    }
+
+    if (packet->count == 0) {
+        return 0;
+    }
+    return sizeof(mr_uart_packet_latency_t) + packet->count * sizeof(mr_latency_summary_t);
+}
+
+//=========================== private ==========================================
+
+static latency_node_t *_latency_find(uint64_t node_id) {
+    for (size_t i = 0; i < MARI_LATENCY_MAX_NODES; i++) {
+        if (metrics_vars.latency[i].summary.node_id == node_id) {
+            return &metrics_vars.latency[i];
+        }
+    }
+    return NULL;
+}
+
+static void _latency_add(uint64_t node_id) {
+    if (node_id == 0 || _latency_find(node_id) != NULL) {
+        return;
+    }
+    for (size_t i = 0; i < MARI_LATENCY_MAX_NODES; i++) {
+        latency_node_t *latency = &metrics_vars.latency[i];
+        if (latency->summary.node_id == 0) {
+            *latency                = (latency_node_t){ .joined = true, .next_probe_asn = mr_mac_get_asn() };
+            latency->summary.node_id = node_id;
+            return;
+        }
+    }
+}
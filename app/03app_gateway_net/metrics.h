@@ -13,9 +13,20 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "models.h"
 
+//=========================== defines ==========================================
+
+#define METRICS_PROBES_PER_TICK                   4  // latency probes queued per tick at most, to leave room in the queue for the application
+#define METRICS_LATENCY_SUMMARY_PERIOD_MS_DEFAULT 10000
+
+// summaries per uart frame, after the uart type and the count
+#define METRICS_LATENCY_PER_FRAME ((MARI_PACKET_MAX_SIZE - 2) / sizeof(mr_latency_summary_t))
+
+//=========================== prototypes =======================================
+
 void metrics_init(void);
 void metrics_add_node(uint64_t node_id);
 void metrics_clear_node(uint64_t node_id);
@@ -23,4 +34,11 @@ bool metrics_is_probe(uint8_t *payload, uint32_t payload_len);
 void metrics_handle_rx_probe(uint64_t node_id, uint8_t *payload);
 void metrics_handle_tx_probe(uint64_t node_id, uint8_t *payload);
 
+// latency probes, sent by the gateway itself
+void   metrics_probe_config(const mr_uart_packet_probe_config_t *config, size_t length);
+void   metrics_probe_tick(void);
+bool   metrics_is_latency_probe(uint8_t *payload, uint32_t payload_len);
+void   metrics_handle_latency_probe(uint64_t node_id, uint8_t *payload);
+size_t metrics_build_uart_packet_latency(uint8_t *buffer);  // 0 until the summaries are due
+
 #endif  // METRICS_H
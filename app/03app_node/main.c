@@ -30,6 +30,10 @@
 
 #define MARI_APP_TIMER_DEV 1
 
+#define MARI_APP_EVENT_BATCH 4  // events handled per wake-up
+
+#define MARI_APP_STATUS_MAILBOX 0  // only the latest status matters
+
 // -2 is for the type and needs_ack fields
 #define DEFAULT_PAYLOAD_SIZE MARI_PACKET_MAX_SIZE - sizeof(mr_packet_header_t) - 2
 
@@ -39,11 +43,9 @@ typedef struct __attribute__((packed)) {
 } default_payload_t;
 
 typedef struct {
-    mr_event_t      event;
-    mr_event_data_t event_data;
-    bool            event_ready;
-    bool            led_blink_state;  // for blinking when not connected
-    bool            send_status_ready;
+    mari_event_t events[MARI_APP_EVENT_BATCH];
+    bool         led_blink_state;  // for blinking when not connected
+    bool         send_status_ready;
 } node_vars_t;
 
 typedef struct __attribute__((packed)) {
@@ -78,12 +80,6 @@ static void _led_blink_callback(void) {
     }
 }
 
-static void mari_event_callback(mr_event_t event, mr_event_data_t event_data) {
-    memcpy(&node_vars.event, &event, sizeof(mr_event_t));
-    memcpy(&node_vars.event_data, &event_data, sizeof(mr_event_data_t));
-    node_vars.event_ready = true;
-}
-
 static void handle_metrics_payload(mr_metrics_payload_t *metrics_payload) {
     // update metrics probe
     metrics_payload->node_rx_count        = ++node_stats.rx_counter;
@@ -100,6 +96,44 @@ static void _send_status_packet_callback(void) {
     node_vars.send_status_ready = true;
 }
 
+static void _handle_event(mari_event_t *mari_event) {
+    mr_event_data_t event_data = mari_event->event_data;
+
+    switch (mari_event->event) {
+        case MARI_NEW_PACKET:
+        {
+            mari_packet_t packet = event_data.data.new_packet;
+
+            if (packet.payload_len == sizeof(mr_metrics_payload_t) && packet.payload[0] == MARI_PAYLOAD_TYPE_METRICS_PROBE) {
+                handle_metrics_payload((mr_metrics_payload_t *)packet.payload);
+            } else if (packet.payload_len == sizeof(mr_latency_probe_t) && packet.payload[0] == MARI_PAYLOAD_TYPE_LATENCY_PROBE) {
+                // the gateway measures the round trip, send it back as is
+                mari_node_tx_payload(packet.payload, packet.payload_len);
+            } else {
+                // TBD custom application logic
+            }
+
+            break;
+        }
+        case MARI_CONNECTED:
+        {
+            uint64_t gateway_id = event_data.data.gateway_info.gateway_id;
+            printf("Connected to gateway %016llX\n", gateway_id);
+            board_set_led_mari_gateway(gateway_id);
+            break;
+        }
+        case MARI_DISCONNECTED:
+        {
+            uint64_t gateway_id = event_data.data.gateway_info.gateway_id;
+            printf("Disconnected from gateway %016llX, reason: %u\n", gateway_id, event_data.tag);
+            board_set_led_mari(OFF);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
 //=========================== main =============================================
 
 int main(void) {
@@ -109,7 +143,7 @@ int main(void) {
     board_init();
     board_set_led_mari(RED);
 
-    mari_init(MARI_NODE, MARI_APP_NET_ID, schedule_app, &mari_event_callback);
+    mari_init(MARI_NODE, MARI_APP_NET_ID, schedule_app, NULL);  // events are polled from the main loop
 
     // blink blue every 100ms
     mr_timer_hf_set_periodic_us(MARI_APP_TIMER_DEV, 0, 100 * 1000, &_led_blink_callback);
@@ -124,47 +158,15 @@ int main(void) {
         __WFE();
         __WFE();
 
-        if (node_vars.event_ready) {
-            node_vars.event_ready = false;
-
-            mr_event_t      event      = node_vars.event;
-            mr_event_data_t event_data = node_vars.event_data;
-
-            switch (event) {
-                case MARI_NEW_PACKET:
-                {
-                    mari_packet_t packet = event_data.data.new_packet;
-
-                    if (packet.payload_len == sizeof(mr_metrics_payload_t) && packet.payload[0] == MARI_PAYLOAD_TYPE_METRICS_PROBE) {
-                        handle_metrics_payload((mr_metrics_payload_t *)packet.payload);
-                    } else {
-                        // TBD custom application logic
-                    }
-
-                    break;
-                }
-                case MARI_CONNECTED:
-                {
-                    uint64_t gateway_id = event_data.data.gateway_info.gateway_id;
-                    printf("Connected to gateway %016llX\n", gateway_id);
-                    board_set_led_mari_gateway(gateway_id);
-                    break;
-                }
-                case MARI_DISCONNECTED:
-                {
-                    uint64_t gateway_id = event_data.data.gateway_info.gateway_id;
-                    printf("Disconnected from gateway %016llX, reason: %u\n", gateway_id, event_data.tag);
-                    board_set_led_mari(OFF);
-                    break;
-                }
-                default:
-                    break;
-            }
+        size_t n_events = mari_poll_events(node_vars.events, MARI_APP_EVENT_BATCH);
+        for (size_t i = 0; i < n_events; i++) {
+            _handle_event(&node_vars.events[i]);
+            mari_release_event(&node_vars.events[i]);
         }
 
         if (node_vars.send_status_ready) {
             node_vars.send_status_ready = false;
-            mari_node_tx_payload((uint8_t *)status_packet_mock, sizeof(status_packet_mock));
+            mari_node_set_mailbox(MARI_APP_STATUS_MAILBOX, (uint8_t *)status_packet_mock, sizeof(status_packet_mock));
         }
 
         mari_event_loop();
@@ -31,6 +31,7 @@
 
 #define MR_BLE_PAYLOAD_MAX_LENGTH        UINT8_MAX
 #define MR_IEEE802154_PAYLOAD_MAX_LENGTH (125UL)  ///< Total usable payload for IEEE 802.15.4 is 125 octets (PSDU) when CRC is activated
+#define MR_RADIO_PDU_HEADER_LENGTH       (2U)     ///< A PDU starts with a header and a length byte, the payload comes right after
 
 /// Modes supported by the radio
 typedef enum {
@@ -126,6 +127,32 @@ void mr_radio_disable(void);
 bool mr_radio_pending_rx_read(void);
 void mr_radio_get_rx_packet(uint8_t *packet, uint8_t *length);
 
+/**
+ * @brief Sets the buffer the next packets are received in, by the radio DMA
+ *
+ * The buffer must hold MR_RADIO_PDU_HEADER_LENGTH + MR_BLE_PAYLOAD_MAX_LENGTH bytes, and stay valid until
+ * another buffer is set. Packets are sent from the internal buffer of the driver in any case.
+ *
+ * @param[in] pdu   Buffer receiving the packets, NULL to go back to the internal buffer
+ */
+void mr_radio_set_rx_buffer(uint8_t *pdu);
+
+/**
+ * @brief Gets the last received packet in place, in the buffer it was received in
+ *
+ * @param[out] length   Length of the packet
+ *
+ * @return Pointer to the packet
+ */
+uint8_t *mr_radio_get_rx_packet_ptr(uint8_t *length);
+
+/**
+ * @brief Gets the number of packets received with a wrong CRC, and dropped, since the radio was initialized
+ *
+ * @return Number of packets, only goes up (and wraps around)
+ */
+uint32_t mr_radio_get_crc_errors(void);
+
 void mr_radio_tx_prepare(const uint8_t *tx_buffer, uint8_t length);
 void mr_radio_tx_dispatch(void);
 
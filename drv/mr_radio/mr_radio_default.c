@@ -53,7 +53,9 @@ typedef struct __attribute__((packed)) {
 
 typedef struct {
     radio_pdu_t       pdu;              ///< Variable that stores the radio PDU (protocol data unit) that arrives and the radio packets that are about to be sent.
+    radio_pdu_t      *rx_pdu;           ///< PDU the packets are received in, either pdu or a buffer set by the user
     bool              pending_rx_read;  ///< Flag to indicate that a PDU has been received, but not yet read by the application.
+    uint32_t          crc_errors;       ///< Number of packets received with a wrong CRC, only goes up
     radio_ts_packet_t start_pac_cb;     ///< Function pointer, stores the callback to capture the start of the packet.
     radio_ts_packet_t end_pac_cb;       ///< Function pointer, stores the callback to capture the end of the packet.
     uint8_t           state;            ///< Internal state of the radio
@@ -79,6 +81,7 @@ static radio_vars_t radio_vars = { 0 };
 //========================== prototypes ========================================
 
 static void _radio_enable(void);
+static void _set_packet_ptr(radio_pdu_t *pdu);
 
 //=========================== public ===========================================
 
@@ -198,11 +201,8 @@ void mr_radio_init(radio_ts_packet_t start_pac_cb, radio_ts_packet_t end_pac_cb,
     }
 
     // Configure pointer to PDU for EasyDMA
-    if (mode == MR_RADIO_IEEE802154_250Kbit) {
-        NRF_RADIO->PACKETPTR = (uint32_t)((uint8_t *)&radio_vars.pdu + 1);  // Skip header for IEEE 802.15.4
-    } else {
-        NRF_RADIO->PACKETPTR = (uint32_t)&radio_vars.pdu;
-    }
+    radio_vars.rx_pdu = &radio_vars.pdu;
+    _set_packet_ptr(&radio_vars.pdu);
 
     // Assign the callbacks that will be called in the RADIO_IRQHandler
     radio_vars.start_pac_cb = start_pac_cb;
@@ -253,9 +253,23 @@ bool mr_radio_pending_rx_read(void) {
 }
 
 void mr_radio_get_rx_packet(uint8_t *packet, uint8_t *length) {
-    *length = radio_vars.pdu.length;
-    memcpy(packet, radio_vars.pdu.payload, radio_vars.pdu.length);
+    *length = radio_vars.rx_pdu->length;
+    memcpy(packet, radio_vars.rx_pdu->payload, radio_vars.rx_pdu->length);
+    radio_vars.pending_rx_read = false;
+}
+
+void mr_radio_set_rx_buffer(uint8_t *pdu) {
+    radio_vars.rx_pdu = pdu ? (radio_pdu_t *)pdu : &radio_vars.pdu;
+}
+
+uint8_t *mr_radio_get_rx_packet_ptr(uint8_t *length) {
+    *length                    = radio_vars.rx_pdu->length;
     radio_vars.pending_rx_read = false;
+    return radio_vars.rx_pdu->payload;
+}
+
+uint32_t mr_radio_get_crc_errors(void) {
+    return radio_vars.crc_errors;
 }
 
 //--------------------------- send and receive --------------------------------
@@ -267,6 +281,9 @@ void mr_radio_rx(void) {
         return;
     }
 
+    // receive directly in the rx buffer
+    _set_packet_ptr(radio_vars.rx_pdu);
+
     // enable the radio shorts and interrupts
     NRF_RADIO->SHORTS = RADIO_SHORTS_COMMON | (RADIO_SHORTS_RXREADY_START_Enabled << RADIO_SHORTS_RXREADY_START_Pos);
     _radio_enable();
@@ -279,6 +296,7 @@ void mr_radio_tx_prepare(const uint8_t *tx_buffer, uint8_t length) {
     // TODO: check for IDLE?
     radio_vars.pdu.length = length;
     memcpy(radio_vars.pdu.payload, tx_buffer, length);
+    _set_packet_ptr(&radio_vars.pdu);
 
     // ramp up the radio for tx (packet will not be sent yet)
     NRF_RADIO->TASKS_TXEN = RADIO_TASKS_TXEN_TASKS_TXEN_Trigger << RADIO_TASKS_TXEN_TASKS_TXEN_Pos;
@@ -307,6 +325,14 @@ static void _radio_enable(void) {
     NRF_RADIO->INTENSET        = RADIO_INTERRUPTS;
 }
 
+static void _set_packet_ptr(radio_pdu_t *pdu) {
+    if (radio_vars.mode == MR_RADIO_IEEE802154_250Kbit) {
+        NRF_RADIO->PACKETPTR = (uint32_t)((uint8_t *)pdu + 1);  // Skip header for IEEE 802.15.4
+    } else {
+        NRF_RADIO->PACKETPTR = (uint32_t)pdu;
+    }
+}
+
 //=========================== interrupt handlers ===============================
 
 /**
@@ -339,7 +365,7 @@ void RADIO_IRQHandler(void) {
         if (radio_vars.state == (RADIO_STATE_BUSY | RADIO_STATE_RX)) {
             // if rx, check the CRC
             if (NRF_RADIO->CRCSTATUS != RADIO_CRCSTATUS_CRCSTATUS_CRCOk) {
-                puts("Invalid CRC");
+                radio_vars.crc_errors++;
             } else {
                 if (radio_vars.end_pac_cb) {
                     radio_vars.pending_rx_read = true;
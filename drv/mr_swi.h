@@ -0,0 +1,41 @@
+#ifndef __MR_SWI_H
+#define __MR_SWI_H
+
+/**
+ * @defgroup    bsp_swi     Software interrupt
+ * @ingroup     bsp
+ * @brief       Run a callback in a low priority interrupt, triggered from software
+ *
+ * Used to defer work out of the radio and timer interrupts: the callback runs as soon as they return,
+ * before the main loop, and can itself be preempted by them.
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025
+ * @}
+ */
+
+#include <stdint.h>
+
+//=========================== defines ==========================================
+
+typedef void (*mr_swi_cb_t)(void);  ///< Callback function prototype, it is called in the software interrupt
+
+//=========================== prototypes =======================================
+
+/**
+ * @brief Configure the software interrupt, at a lower priority than the radio and timer interrupts
+ *
+ * @param[in] callback  function called each time the interrupt is triggered
+ */
+void mr_swi_init(mr_swi_cb_t callback);
+
+/**
+ * @brief Trigger the software interrupt, can be called from any interrupt
+ *
+ * Triggers that happen before the callback runs are merged into one call.
+ */
+void mr_swi_trigger(void);
+
+#endif  // __MR_SWI_H
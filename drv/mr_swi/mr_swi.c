@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @ingroup bsp_swi
+ *
+ * @brief  nRF52833/nRF5340-specific definition of the "swi" bsp module, based on the event generator unit (EGU).
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <nrf.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mr_swi.h"
+
+//=========================== defines ==========================================
+
+/// Below the timer (0) and radio (1) interrupts
+#define SWI_IRQ_PRIORITY (2U)
+#define SWI_EGU_CHANNEL  (0U)
+
+#if defined(NRF5340_XXAA)
+#if defined(NRF_NETWORK) || defined(NRF_TRUSTZONE_NONSECURE)
+#define SWI_EGU NRF_EGU0_NS
+#else
+#define SWI_EGU NRF_EGU0_S
+#endif
+#define SWI_IRQn       EGU0_IRQn
+#define SWI_IRQHandler EGU0_IRQHandler
+#else
+#define SWI_EGU        NRF_EGU0
+#define SWI_IRQn       SWI0_EGU0_IRQn
+#define SWI_IRQHandler SWI0_EGU0_IRQHandler
+#endif
+
+//=========================== variables ========================================
+
+static mr_swi_cb_t _swi_callback = NULL;
+
+//=========================== public ===========================================
+
+void mr_swi_init(mr_swi_cb_t callback) {
+    _swi_callback = callback;
+
+    SWI_EGU->EVENTS_TRIGGERED[SWI_EGU_CHANNEL] = 0;
+    SWI_EGU->INTENSET                          = (1 << SWI_EGU_CHANNEL);
+
+    NVIC_ClearPendingIRQ(SWI_IRQn);
+    NVIC_SetPriority(SWI_IRQn, SWI_IRQ_PRIORITY);
+    NVIC_EnableIRQ(SWI_IRQn);
+}
+
+void mr_swi_trigger(void) {
+    SWI_EGU->TASKS_TRIGGER[SWI_EGU_CHANNEL] = 1;
+}
+
+//=========================== interrupt handlers ===============================
+
+void SWI_IRQHandler(void) {
+    if (SWI_EGU->EVENTS_TRIGGERED[SWI_EGU_CHANNEL]) {
+        SWI_EGU->EVENTS_TRIGGERED[SWI_EGU_CHANNEL] = 0;
+        if (_swi_callback) {
+            _swi_callback();
+        }
+    }
+}
@@ -0,0 +1,225 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Monte Carlo simulation of a whole swarm re-joining a gateway at once
+ *
+ * All the nodes of the huge schedule sync to the gateway in the same slot, e.g. after a gateway reboot, and contend
+ * in its shared uplink slots. Each one backs off, transmits a join request, waits for the join response in the
+ * downlink slot that follows, and backs off again if there was none. The backoff that grows from a fixed window,
+ * as used before the gateway advertised its join backlog, is compared with the one drawn by mari from the backlog.
+ * The gateway backlog estimation and the backoff exponents are those of association.c.
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mari.h"
+#include "scheduler.h"
+#include "association.h"
+#include "scan.h"
+#include "packet.h"
+#include "mac.h"
+
+//=========================== defines ==========================================
+
+#define SIM_N_NODES               102                                              // all the nodes of the huge schedule
+#define SIM_N_RUNS                20                                               // results are averaged over this many runs
+#define SIM_SEED                  0x2545F491                                       // runs are reproducible
+#define SIM_MAX_SLOTS             (60 * 1000 * 1000 / MARI_WHOLE_SLOT_DURATION)    // give up after 60 seconds
+#define SIM_JOIN_TIMEOUT_SLOTS    ((1000 * 1000 * 5) / MARI_WHOLE_SLOT_DURATION)   // same as MARI_JOIN_TIMEOUT_SINCE_SYNCED
+#define SIM_JOINING_TIMEOUT_SLOTS 2                                                // same as MARI_JOINING_STATE_TIMEOUT, in whole slots
+#define SIM_SCAN_SLOTS            (MARI_SCAN_MAX_SLOTS)                            // time a node spends scanning after giving up
+
+#define SIM_FIXED_BACKOFF_N_MIN 4  // the backoff used before the gateway advertised its join backlog
+#define SIM_FIXED_BACKOFF_N_MAX 6
+
+#define SIM_MAX_ADAPTIVE_PERCENT 85  // the check fails if the adaptive backoff does not save at least 15% of the re-join time (it saves about 28%)
+
+typedef enum {
+    SIM_NODE_SCANNING,
+    SIM_NODE_SYNCED,
+    SIM_NODE_JOINING,
+    SIM_NODE_JOINED,
+} sim_node_state_t;
+
+typedef struct {
+    sim_node_state_t state;
+    int16_t          backoff_n;
+    uint16_t         backoff_slots;  // shared uplink slots left before trying to join
+    uint32_t         state_asn;      // when the node synced, or started scanning
+    uint32_t         request_asn;    // when the node sent its join request, while joining
+    bool             answered;       // true if the join request was the only one in its slot
+} sim_node_t;
+
+//=========================== variables ========================================
+
+extern schedule_t schedule_huge;
+
+static sim_node_t _nodes[SIM_N_NODES];
+static uint32_t   _prng_state = SIM_SEED;
+static int        _errors     = 0;
+
+//=========================== prototypes =======================================
+
+static uint32_t _simulate_rejoin(bool adaptive);
+static uint32_t _prng(void);
+static void     _check(bool condition, const char *what);
+
+//============================ main ============================================
+
+int main(void) {
+    mari_set_node_type(MARI_GATEWAY);
+    mr_assoc_init(MARI_NET_ID_DEFAULT, NULL);
+    mr_scheduler_init(&schedule_huge);
+
+    uint32_t sum_fixed_ms    = 0;
+    uint32_t sum_adaptive_ms = 0;
+    for (size_t i = 0; i < SIM_N_RUNS; i++) {
+        uint32_t fixed_ms    = _simulate_rejoin(false);
+        uint32_t adaptive_ms = _simulate_rejoin(true);
+        printf("Run %2zu: %d nodes joined in %5u ms (fixed) vs %5u ms (adaptive)\n", i, SIM_N_NODES, fixed_ms, adaptive_ms);
+        sum_fixed_ms += fixed_ms;
+        sum_adaptive_ms += adaptive_ms;
+    }
+    uint32_t fixed_ms    = sum_fixed_ms / SIM_N_RUNS;
+    uint32_t adaptive_ms = sum_adaptive_ms / SIM_N_RUNS;
+    printf("Average re-join time: %u ms (fixed), %u ms (adaptive)\n", fixed_ms, adaptive_ms);
+    _check(adaptive_ms * 100 <= fixed_ms * SIM_MAX_ADAPTIVE_PERCENT, "adaptive backoff re-joins faster");
+
+    if (_errors) {
+        printf("%d checks failed\n", _errors);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+//=========================== private ==========================================
+
+static void _node_backoff(sim_node_t *node, bool adaptive, uint8_t join_backlog) {
+    if (adaptive) {
+        node->backoff_n = mr_assoc_node_compute_backoff_n(join_backlog, node->backoff_n);
+    } else if (node->backoff_n == -1) {
+        node->backoff_n = SIM_FIXED_BACKOFF_N_MIN;
+    } else if (node->backoff_n < SIM_FIXED_BACKOFF_N_MAX) {
+        node->backoff_n++;
+    }
+    node->backoff_slots = _prng() % (1 << node->backoff_n);
+}
+
+static void _node_sync(sim_node_t *node, bool adaptive, uint8_t join_backlog, uint32_t asn) {
+    node->state     = SIM_NODE_SYNCED;
+    node->state_asn = asn;
+    node->backoff_n = -1;
+    _node_backoff(node, adaptive, join_backlog);
+}
+
+// returns the time it took for all nodes to join, in ms, and counts a failed check if some never did
+static uint32_t _simulate_rejoin(bool adaptive) {
+    schedule_t *schedule     = mr_scheduler_get_active_schedule_ptr();
+    uint8_t     join_backlog = 1;  // as advertised in the last beacon
+    size_t      n_joined     = 0;
+
+    // resets the gateway backlog estimation
+    mr_assoc_init(MARI_NET_ID_DEFAULT, NULL);
+
+    for (size_t i = 0; i < SIM_N_NODES; i++) {
+        _node_sync(&_nodes[i], adaptive, join_backlog, 0);
+    }
+
+    uint32_t asn = 0;
+    for (; asn < SIM_MAX_SLOTS && n_joined < SIM_N_NODES; asn++) {
+        slot_type_t type = schedule->cells[asn % schedule->n_cells].type;
+
+        if (type == SLOT_TYPE_BEACON) {
+            join_backlog = mr_assoc_gateway_get_join_backlog();
+        }
+
+        if (adaptive && asn % schedule->n_cells == 0) {
+            // at the first beacon of every slotframe, nodes re-draw their backoff if the backlog calls for a larger window
+            int16_t backlog_n = mr_assoc_node_compute_backoff_n(join_backlog, -1);
+            for (size_t i = 0; i < SIM_N_NODES; i++) {
+                sim_node_t *node = &_nodes[i];
+                if (node->state == SIM_NODE_SYNCED && backlog_n > node->backoff_n) {
+                    node->backoff_n     = backlog_n;
+                    node->backoff_slots = _prng() % (1 << node->backoff_n);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < SIM_N_NODES; i++) {
+            sim_node_t *node = &_nodes[i];
+            if (node->state == SIM_NODE_JOINING && node->answered && type == SLOT_TYPE_DOWNLINK) {
+                // the join response, in the downlink slot that follows the request
+                node->state = SIM_NODE_JOINED;
+                n_joined++;
+            } else if (node->state == SIM_NODE_JOINING && !node->answered && asn - node->request_asn >= SIM_JOINING_TIMEOUT_SLOTS) {
+                // no response, back off again
+                node->state = SIM_NODE_SYNCED;
+                _node_backoff(node, adaptive, join_backlog);
+            } else if (node->state == SIM_NODE_SCANNING && asn - node->state_asn > SIM_SCAN_SLOTS) {
+                _node_sync(node, adaptive, join_backlog, asn);
+            } else if (node->state == SIM_NODE_SYNCED && asn - node->state_asn > SIM_JOIN_TIMEOUT_SLOTS) {
+                // too long without joining, give up and scan again
+                node->state     = SIM_NODE_SCANNING;
+                node->state_asn = asn;
+            }
+        }
+
+        if (type != SLOT_TYPE_SHARED_UPLINK) {
+            continue;
+        }
+
+        // the nodes whose backoff is over transmit a join request in this slot
+        size_t n_tx = 0;
+        for (size_t i = 0; i < SIM_N_NODES; i++) {
+            sim_node_t *node = &_nodes[i];
+            if (node->state != SIM_NODE_SYNCED) {
+                continue;
+            }
+            if (node->backoff_slots > 0) {
+                node->backoff_slots--;
+                continue;
+            }
+            node->state       = SIM_NODE_JOINING;
+            node->request_asn = asn;
+            n_tx++;
+        }
+        for (size_t i = 0; i < SIM_N_NODES; i++) {
+            if (_nodes[i].state == SIM_NODE_JOINING && _nodes[i].request_asn == asn) {
+                _nodes[i].answered = n_tx == 1;
+            }
+        }
+
+        if (n_tx == 0) {
+            mr_assoc_gateway_register_shared_slot(MARI_SHARED_SLOT_IDLE);
+        } else if (n_tx == 1) {
+            mr_assoc_gateway_register_shared_slot(MARI_SHARED_SLOT_SUCCESS);
+        } else {
+            mr_assoc_gateway_register_shared_slot(MARI_SHARED_SLOT_COLLISION);
+        }
+    }
+
+    _check(n_joined == SIM_N_NODES, "all nodes joined within the simulated time");
+    return (uint64_t)asn * MARI_WHOLE_SLOT_DURATION / 1000;
+}
+
+static uint32_t _prng(void) {
+    // xorshift32
+    _prng_state ^= _prng_state << 13;
+    _prng_state ^= _prng_state >> 17;
+    _prng_state ^= _prng_state << 5;
+    return _prng_state;
+}
+
+static void _check(bool condition, const char *what) {
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        _errors++;
+    }
+}
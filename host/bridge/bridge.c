@@ -0,0 +1,449 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Bridge between a Mari gateway, over its HDLC serial link, and any number of local applications
+ *
+ * Reads the serial link served by 03app_gateway_app without blocking, decodes the HDLC frames in batches, and
+ * sends each frame to every application connected to a UNIX socket. The socket is of type SOCK_SEQPACKET: each
+ * message is one frame, starting with its MARI_EDGE_* type, exactly as sent by the gateway, so applications never
+ * parse the byte stream themselves. An application that does not keep up loses frames, the others are not slowed down.
+ *
+ * Applications send downlink frames on the same socket: MARI_EDGE_DATA followed by a mari frame, or
+ * MARI_EDGE_PROBE_CONFIG to set the latency probes of the gateway, or MARI_EDGE_PROFILE to ask for its execution time
+ * profile. They are queued, and written to the gateway one at a time, at least a gap apart, since the gateway takes a
+ * single frame at a time.
+ *
+ * Usage: mari_bridge -d <serial port> -s <socket path> [-g <downlink gap, us>] [-v]
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "models.h"
+#include "hdlc.h"
+
+//=========================== defines ==========================================
+
+#define BRIDGE_MAX_CLIENTS             64
+#define BRIDGE_READ_SIZE               4096                                   // bytes read from the serial port at once
+#define BRIDGE_BATCH_SIZE              64                                     // frames decoded before they are sent to the applications
+#define BRIDGE_FRAME_MAX_SIZE          (1 + MARI_PACKET_MAX_SIZE)             // edge type, and the largest frame the gateway sends
+#define BRIDGE_HDLC_MAX_SIZE           (2 * (BRIDGE_FRAME_MAX_SIZE + 2) + 2)  // every byte escaped, with the fcs and the flags
+#define BRIDGE_DOWNLINK_QUEUE_SIZE     256
+#define BRIDGE_DOWNLINK_GAP_US_DEFAULT 2000  // the gateway forwards one frame to its radio core, then waits for the next
+#define BRIDGE_STATS_PERIOD_S          10    // with -v
+
+typedef struct {
+    uint8_t length;
+    uint8_t buffer[BRIDGE_FRAME_MAX_SIZE];
+} bridge_frame_t;
+
+typedef struct {
+    int      fd;  ///< -1 if the entry is free
+    uint32_t dropped;
+} bridge_client_t;
+
+typedef struct {
+    int      serial_fd;
+    int      listen_fd;
+    uint32_t downlink_gap_us;
+    bool     verbose;
+
+    bridge_client_t clients[BRIDGE_MAX_CLIENTS];
+
+    bridge_frame_t batch[BRIDGE_BATCH_SIZE];
+    size_t         batch_len;
+
+    bridge_frame_t downlinks[BRIDGE_DOWNLINK_QUEUE_SIZE];
+    size_t         downlinks_head;
+    size_t         downlinks_len;
+    uint8_t        hdlc_buffer[BRIDGE_HDLC_MAX_SIZE];  ///< Downlink being written to the serial port
+    size_t         hdlc_len;
+    size_t         hdlc_written;
+    uint64_t       next_downlink_ns;  ///< No downlink is started before this time
+
+    uint64_t gateway_id;  ///< From the gateway info frames, 0 until the first one
+    uint16_t network_id;
+
+    // statistics
+    uint64_t frames_up;
+    uint64_t hdlc_errors;
+    uint64_t frames_down;
+    uint64_t downlinks_invalid;
+    uint64_t downlinks_dropped;
+} bridge_vars_t;
+
+//=========================== variables ========================================
+
+static bridge_vars_t         _bridge_vars = { 0 };
+static volatile sig_atomic_t _stop        = 0;
+
+//=========================== prototypes =======================================
+
+static int      _open_serial(const char *path);
+static int      _open_socket(const char *path);
+static void     _accept_clients(void);
+static void     _read_serial(void);
+static void     _flush_batch(void);
+static void     _read_client(bridge_client_t *client);
+static void     _close_client(bridge_client_t *client);
+static void     _write_downlink(void);
+static int      _poll_timeout_ms(void);
+static void     _print_stats(void);
+static uint64_t _now_ns(void);
+static void     _handle_signal(int signal);
+static void     _usage(const char *name);
+
+//============================ main ============================================
+
+int main(int argc, char **argv) {
+    const char *serial_path = NULL;
+    const char *socket_path = NULL;
+
+    _bridge_vars.downlink_gap_us = BRIDGE_DOWNLINK_GAP_US_DEFAULT;
+    int option;
+    while ((option = getopt(argc, argv, "d:s:g:v")) != -1) {
+        switch (option) {
+            case 'd':
+                serial_path = optarg;
+                break;
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'g':
+                _bridge_vars.downlink_gap_us = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                _bridge_vars.verbose = true;
+                break;
+            default:
+                _usage(argv[0]);
+                return 1;
+        }
+    }
+    if (serial_path == NULL || socket_path == NULL) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    for (size_t i = 0; i < BRIDGE_MAX_CLIENTS; i++) {
+        _bridge_vars.clients[i].fd = -1;
+    }
+    if ((_bridge_vars.serial_fd = _open_serial(serial_path)) < 0) {
+        return 1;
+    }
+    if ((_bridge_vars.listen_fd = _open_socket(socket_path)) < 0) {
+        return 1;
+    }
+
+    signal(SIGINT, _handle_signal);
+    signal(SIGTERM, _handle_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    uint64_t next_stats_ns = _now_ns() + BRIDGE_STATS_PERIOD_S * 1000000000ULL;
+    int      status        = 0;
+    while (!_stop) {
+        // serial port, listening socket, and the clients, in this order
+        struct pollfd fds[2 + BRIDGE_MAX_CLIENTS];
+        size_t        n_fds = 0;
+        fds[n_fds++]        = (struct pollfd){ .fd = _bridge_vars.serial_fd, .events = POLLIN | (_bridge_vars.hdlc_written < _bridge_vars.hdlc_len ? POLLOUT : 0) };
+        fds[n_fds++]        = (struct pollfd){ .fd = _bridge_vars.listen_fd, .events = POLLIN };
+        for (size_t i = 0; i < BRIDGE_MAX_CLIENTS; i++) {
+            fds[n_fds++] = (struct pollfd){ .fd = _bridge_vars.clients[i].fd, .events = POLLIN };  // ignored if fd is -1
+        }
+
+        if (poll(fds, n_fds, _poll_timeout_ms()) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            status = 1;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            _read_serial();
+        } else if (fds[0].revents & (POLLHUP | POLLERR)) {
+            fprintf(stderr, "Serial port closed\n");
+            status = 1;
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            _accept_clients();
+        }
+        for (size_t i = 0; i < BRIDGE_MAX_CLIENTS; i++) {
+            if (fds[2 + i].revents & POLLIN) {
+                _read_client(&_bridge_vars.clients[i]);
+            } else if (fds[2 + i].revents & (POLLHUP | POLLERR)) {
+                _close_client(&_bridge_vars.clients[i]);
+            }
+        }
+        _write_downlink();
+
+        if (_bridge_vars.verbose && _now_ns() >= next_stats_ns) {
+            next_stats_ns += BRIDGE_STATS_PERIOD_S * 1000000000ULL;
+            _print_stats();
+        }
+    }
+
+    _print_stats();
+    for (size_t i = 0; i < BRIDGE_MAX_CLIENTS; i++) {
+        _close_client(&_bridge_vars.clients[i]);
+    }
+    close(_bridge_vars.listen_fd);
+    close(_bridge_vars.serial_fd);
+    unlink(socket_path);
+    return status;
+}
+
+//=========================== private ==========================================
+
+static int _open_serial(const char *path) {
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct termios tty;
+    if (tcgetattr(fd, &tty) < 0) {
+        perror("tcgetattr");
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B1000000);  // the baudrate of 03app_gateway_app
+    cfsetospeed(&tty, B1000000);
+    tty.c_cflag |= CLOCAL | CREAD;
+    if (tcsetattr(fd, TCSANOW, &tty) < 0) {
+        perror("tcsetattr");
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int _open_socket(const char *path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);  // left behind by a bridge that did not exit cleanly
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, BRIDGE_MAX_CLIENTS) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void _accept_clients(void) {
+    int fd;
+    while ((fd = accept(_bridge_vars.listen_fd, NULL, NULL)) >= 0) {  // clients are read and written with MSG_DONTWAIT
+        bridge_client_t *client = NULL;
+        for (size_t i = 0; i < BRIDGE_MAX_CLIENTS && client == NULL; i++) {
+            if (_bridge_vars.clients[i].fd < 0) {
+                client = &_bridge_vars.clients[i];
+            }
+        }
+        if (client == NULL) {
+            fprintf(stderr, "Too many clients, connection refused\n");
+            close(fd);
+            continue;
+        }
+        client->fd      = fd;
+        client->dropped = 0;
+    }
+}
+
+// reads what the serial port has, and sends the decoded frames to the applications, a batch at a time
+static void _read_serial(void) {
+    uint8_t buffer[BRIDGE_READ_SIZE];
+    ssize_t length;
+    while ((length = read(_bridge_vars.serial_fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < length; i++) {
+            mr_hdlc_state_t state = mr_hdlc_rx_byte(buffer[i]);
+            if (state == MR_HDLC_STATE_ERROR) {
+                _bridge_vars.hdlc_errors++;
+                mr_hdlc_reset();
+                continue;
+            }
+            if (state != MR_HDLC_STATE_READY) {
+                continue;
+            }
+            // decode into a buffer large enough for anything the decoder holds, frames longer than the gateway sends are dropped
+            uint8_t frame[1024];
+            size_t  frame_len = mr_hdlc_decode(frame);
+            if (frame_len == 0 || frame_len > BRIDGE_FRAME_MAX_SIZE) {
+                _bridge_vars.hdlc_errors++;
+                continue;
+            }
+            if (frame[0] == MARI_EDGE_GATEWAY_INFO && frame_len >= 1 + sizeof(uint64_t) + sizeof(uint16_t)) {
+                mr_uart_packet_gateway_info_t info = { 0 };
+                memcpy(&info, frame + 1, frame_len - 1 < sizeof(info) ? frame_len - 1 : sizeof(info));
+                if (info.device_id != _bridge_vars.gateway_id) {
+                    printf("Gateway %016llX, network %04X\n", (unsigned long long)info.device_id, info.net_id);
+                    fflush(stdout);
+                }
+                _bridge_vars.gateway_id = info.device_id;
+                _bridge_vars.network_id = info.net_id;
+            }
+            bridge_frame_t *entry = &_bridge_vars.batch[_bridge_vars.batch_len++];
+            entry->length         = frame_len;
+            memcpy(entry->buffer, frame, frame_len);
+            _bridge_vars.frames_up++;
+            if (_bridge_vars.batch_len == BRIDGE_BATCH_SIZE) {
+                _flush_batch();
+            }
+        }
+    }
+    _flush_batch();
+    if (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EIO) {
+        perror("read");
+    }
+}
+
+static void _flush_batch(void) {
+    for (size_t i = 0; i < BRIDGE_MAX_CLIENTS; i++) {
+        bridge_client_t *client = &_bridge_vars.clients[i];
+        for (size_t f = 0; f < _bridge_vars.batch_len && client->fd >= 0; f++) {
+            if (send(client->fd, _bridge_vars.batch[f].buffer, _bridge_vars.batch[f].length, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                // the application does not keep up, it misses this frame
+                client->dropped++;
+            } else {
+                _close_client(client);
+            }
+        }
+    }
+    _bridge_vars.batch_len = 0;
+}
+
+static void _read_client(bridge_client_t *client) {
+    uint8_t buffer[BRIDGE_FRAME_MAX_SIZE + 1];
+    ssize_t length;
+    while ((length = recv(client->fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        bool data         = buffer[0] == MARI_EDGE_DATA && length >= 1 + (ssize_t)sizeof(mr_packet_header_t);
+        bool probe_config = buffer[0] == MARI_EDGE_PROBE_CONFIG && length >= 1 + (ssize_t)sizeof(mr_uart_packet_probe_config_t);
+        bool profile      = buffer[0] == MARI_EDGE_PROFILE;
+        if (!(data || probe_config || profile) || length > BRIDGE_FRAME_MAX_SIZE) {
+            _bridge_vars.downlinks_invalid++;
+            continue;
+        }
+        if (_bridge_vars.downlinks_len == BRIDGE_DOWNLINK_QUEUE_SIZE) {
+            _bridge_vars.downlinks_dropped++;
+            continue;
+        }
+        bridge_frame_t *entry = &_bridge_vars.downlinks[(_bridge_vars.downlinks_head + _bridge_vars.downlinks_len++) % BRIDGE_DOWNLINK_QUEUE_SIZE];
+        entry->length         = length;
+        memcpy(entry->buffer, buffer, length);
+    }
+    if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        _close_client(client);
+    }
+}
+
+static void _close_client(bridge_client_t *client) {
+    if (client->fd < 0) {
+        return;
+    }
+    if (client->dropped && _bridge_vars.verbose) {
+        printf("Client disconnected, %u frames dropped\n", client->dropped);
+    }
+    close(client->fd);
+    client->fd = -1;
+}
+
+// finishes the downlink being written, or starts the next one once the gap since the previous one has passed
+static void _write_downlink(void) {
+    if (_bridge_vars.hdlc_written == _bridge_vars.hdlc_len) {
+        if (_bridge_vars.downlinks_len == 0 || _now_ns() < _bridge_vars.next_downlink_ns) {
+            return;
+        }
+        bridge_frame_t *entry       = &_bridge_vars.downlinks[_bridge_vars.downlinks_head];
+        _bridge_vars.hdlc_len       = mr_hdlc_encode(entry->buffer, entry->length, _bridge_vars.hdlc_buffer);
+        _bridge_vars.hdlc_written   = 0;
+        _bridge_vars.downlinks_head = (_bridge_vars.downlinks_head + 1) % BRIDGE_DOWNLINK_QUEUE_SIZE;
+        _bridge_vars.downlinks_len--;
+        _bridge_vars.next_downlink_ns = _now_ns() + _bridge_vars.downlink_gap_us * 1000ULL;
+        _bridge_vars.frames_down++;
+    }
+    ssize_t length = write(_bridge_vars.serial_fd, _bridge_vars.hdlc_buffer + _bridge_vars.hdlc_written, _bridge_vars.hdlc_len - _bridge_vars.hdlc_written);
+    if (length > 0) {
+        _bridge_vars.hdlc_written += length;
+    } else if (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("write");
+        _bridge_vars.hdlc_written = _bridge_vars.hdlc_len;  // give up on this frame
+    }
+}
+
+// wakes up in time for the next downlink, if any is waiting
+static int _poll_timeout_ms(void) {
+    int timeout_ms = _bridge_vars.verbose ? 1000 : -1;
+    if (_bridge_vars.downlinks_len > 0 && _bridge_vars.hdlc_written == _bridge_vars.hdlc_len) {
+        uint64_t now = _now_ns();
+        timeout_ms   = now >= _bridge_vars.next_downlink_ns ? 0 : (int)((_bridge_vars.next_downlink_ns - now + 999999) / 1000000);
+    }
+    return timeout_ms;
+}
+
+static void _print_stats(void) {
+    uint32_t dropped   = 0;
+    uint8_t  n_clients = 0;
+    for (size_t i = 0; i < BRIDGE_MAX_CLIENTS; i++) {
+        if (_bridge_vars.clients[i].fd >= 0) {
+            n_clients++;
+            dropped += _bridge_vars.clients[i].dropped;
+        }
+    }
+    printf("%llu frames up, %llu hdlc errors, %llu frames down (%llu invalid, %llu dropped), %u clients (%u frames dropped)\n",
+           (unsigned long long)_bridge_vars.frames_up,
+           (unsigned long long)_bridge_vars.hdlc_errors,
+           (unsigned long long)_bridge_vars.frames_down,
+           (unsigned long long)_bridge_vars.downlinks_invalid,
+           (unsigned long long)_bridge_vars.downlinks_dropped,
+           n_clients,
+           dropped);
+    fflush(stdout);
+}
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _handle_signal(int signal) {
+    (void)signal;
+    _stop = 1;
+}
+
+static void _usage(const char *name) {
+    fprintf(stderr, "Usage: %s -d <serial port> -s <socket path> [-g <downlink gap, us>] [-v]\n", name);
+}
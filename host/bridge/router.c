@@ -0,0 +1,574 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Routes the downlinks of applications to the gateway each node is joined to, over several bridges
+ *
+ * Connects to the socket of the bridge of each gateway, and serves applications on its own socket, with the same
+ * messages as a bridge: the frames of all the gateways go to every application, and applications send downlinks
+ * as MARI_EDGE_DATA followed by a mari frame, without caring about which gateway the node is joined to.
+ *
+ * The node -> gateway table is kept from the frames of all the gateways, in constant time per frame:
+ * - MARI_EDGE_NODE_JOINED points the node to the gateway that sent it.
+ * - MARI_EDGE_NODE_LEFT only removes the node if it still points to that gateway: during a handover, the new gateway
+ *   often reports the join before the old one times the node out.
+ * - data and keepalives from a node also point it to the gateway that heard them, which fixes the table if
+ *   events of different gateways were read out of order.
+ * A downlink for a node that is not in the table, e.g. in the middle of a handover, is held until the node joins a
+ * gateway, or dropped after a while. Downlinks to the broadcast or a group address go to all the gateways.
+ *
+ * Usage: mari_router -s <socket path> -b <bridge socket> [-b <bridge socket> ...] [-t <hold time, ms>] [-v]
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "models.h"
+#include "mari.h"
+
+//=========================== defines ==========================================
+
+#define ROUTER_MAX_BRIDGES         16
+#define ROUTER_MAX_CLIENTS         64
+#define ROUTER_MAX_NODES           4096
+#define ROUTER_INDEX_SIZE          (2 * ROUTER_MAX_NODES)  // at most half full, must be a power of 2
+#define ROUTER_HASH_MULTIPLY       0x9E3779B97F4A7C15ULL   // Fibonacci hashing
+#define ROUTER_HELD_SIZE           256                     // downlinks waiting for their node to join a gateway
+#define ROUTER_HOLD_MS_DEFAULT     3000                    // a few slotframes of the largest schedule, for the node to join again
+#define ROUTER_FRAME_MAX_SIZE      (1 + MARI_PACKET_MAX_SIZE)
+#define ROUTER_RECONNECT_PERIOD_MS 1000
+
+typedef struct {
+    uint8_t length;
+    uint8_t buffer[ROUTER_FRAME_MAX_SIZE];
+} router_frame_t;
+
+typedef struct {
+    uint64_t       node_id;
+    uint64_t       deadline_ns;
+    router_frame_t frame;
+} router_held_t;
+
+typedef struct {
+    const char *path;
+    int         fd;          ///< -1 while not connected
+    uint64_t    gateway_id;  ///< From the gateway info frames, 0 until the first one
+} router_bridge_t;
+
+typedef struct {
+    uint64_t node_id;  ///< 0 if the entry is free
+    uint8_t  bridge;   ///< Index of the bridge of the gateway the node is joined to
+} router_node_t;
+
+typedef struct {
+    int      listen_fd;
+    uint32_t hold_ms;
+    bool     verbose;
+
+    router_bridge_t bridges[ROUTER_MAX_BRIDGES];
+    size_t          n_bridges;
+    int             clients[ROUTER_MAX_CLIENTS];  ///< -1 if the entry is free
+
+    router_node_t nodes[ROUTER_INDEX_SIZE];  ///< Open addressing, linear probing
+    size_t        n_nodes;
+
+    router_held_t held[ROUTER_HELD_SIZE];  ///< In the order they were sent
+    size_t        held_len;
+
+    // statistics
+    uint64_t routed;
+    uint64_t broadcast;
+    uint64_t released;      ///< Held downlinks sent once their node joined
+    uint64_t expired;       ///< Held downlinks dropped
+    uint64_t handovers;
+    uint64_t stale_leaves;  ///< Leave events ignored, the node had joined another gateway already
+} router_vars_t;
+
+//=========================== variables ========================================
+
+static router_vars_t         _router_vars = { 0 };
+static volatile sig_atomic_t _stop        = 0;
+
+//=========================== prototypes =======================================
+
+static void _connect_bridges(void);
+static void _read_bridge(size_t bridge);
+static void _handle_frame(size_t bridge, const uint8_t *frame, size_t length);
+static void _node_joined(uint64_t node_id, size_t bridge);
+static void _read_client(size_t client);
+static void _route_downlink(const uint8_t *frame, size_t length);
+static void _send_to_bridge(size_t bridge, const uint8_t *frame, size_t length);
+static void _expire_held(void);
+static void _accept_clients(void);
+static void _close_client(size_t client);
+static void _print_stats(void);
+
+// node -> bridge table
+static size_t  _index_home(uint64_t node_id);
+static int32_t _index_find(uint64_t node_id);
+static bool    _index_set(uint64_t node_id, uint8_t bridge);
+static void    _index_remove(uint64_t node_id);
+
+static int      _open_socket(const char *path);
+static uint64_t _now_ns(void);
+static void     _handle_signal(int signal);
+static void     _usage(const char *name);
+
+//============================ main ============================================
+
+int main(int argc, char **argv) {
+    const char *socket_path = NULL;
+
+    _router_vars.hold_ms = ROUTER_HOLD_MS_DEFAULT;
+    int option;
+    while ((option = getopt(argc, argv, "s:b:t:v")) != -1) {
+        switch (option) {
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'b':
+                if (_router_vars.n_bridges == ROUTER_MAX_BRIDGES) {
+                    fprintf(stderr, "At most %d bridges\n", ROUTER_MAX_BRIDGES);
+                    return 1;
+                }
+                _router_vars.bridges[_router_vars.n_bridges++] = (router_bridge_t){ .path = optarg, .fd = -1 };
+                break;
+            case 't':
+                _router_vars.hold_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                _router_vars.verbose = true;
+                break;
+            default:
+                _usage(argv[0]);
+                return 1;
+        }
+    }
+    if (socket_path == NULL || _router_vars.n_bridges == 0) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    for (size_t i = 0; i < ROUTER_MAX_CLIENTS; i++) {
+        _router_vars.clients[i] = -1;
+    }
+    if ((_router_vars.listen_fd = _open_socket(socket_path)) < 0) {
+        return 1;
+    }
+
+    signal(SIGINT, _handle_signal);
+    signal(SIGTERM, _handle_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    uint64_t next_connect_ns = 0;
+    while (!_stop) {
+        if (_now_ns() >= next_connect_ns) {
+            _connect_bridges();
+            next_connect_ns = _now_ns() + ROUTER_RECONNECT_PERIOD_MS * 1000000ULL;
+        }
+
+        // listening socket, bridges, and the clients, in this order
+        struct pollfd fds[1 + ROUTER_MAX_BRIDGES + ROUTER_MAX_CLIENTS];
+        size_t        n_fds = 0;
+        fds[n_fds++]        = (struct pollfd){ .fd = _router_vars.listen_fd, .events = POLLIN };
+        for (size_t i = 0; i < ROUTER_MAX_BRIDGES; i++) {
+            fds[n_fds++] = (struct pollfd){ .fd = i < _router_vars.n_bridges ? _router_vars.bridges[i].fd : -1, .events = POLLIN };  // ignored if fd is -1
+        }
+        for (size_t i = 0; i < ROUTER_MAX_CLIENTS; i++) {
+            fds[n_fds++] = (struct pollfd){ .fd = _router_vars.clients[i], .events = POLLIN };
+        }
+
+        // wake up for the first held downlink to expire, and to reconnect the bridges
+        int timeout_ms = ROUTER_RECONNECT_PERIOD_MS;
+        if (_router_vars.held_len > 0) {
+            uint64_t now = _now_ns();
+            timeout_ms   = now >= _router_vars.held[0].deadline_ns ? 0 : (int)((_router_vars.held[0].deadline_ns - now + 999999) / 1000000);
+        }
+        if (poll(fds, n_fds, timeout_ms) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            _accept_clients();
+        }
+        for (size_t i = 0; i < _router_vars.n_bridges; i++) {
+            if (fds[1 + i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                _read_bridge(i);
+            }
+        }
+        for (size_t i = 0; i < ROUTER_MAX_CLIENTS; i++) {
+            if (fds[1 + ROUTER_MAX_BRIDGES + i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                _read_client(i);
+            }
+        }
+        _expire_held();
+    }
+
+    _print_stats();
+    for (size_t i = 0; i < ROUTER_MAX_CLIENTS; i++) {
+        _close_client(i);
+    }
+    for (size_t i = 0; i < _router_vars.n_bridges; i++) {
+        if (_router_vars.bridges[i].fd >= 0) {
+            close(_router_vars.bridges[i].fd);
+        }
+    }
+    close(_router_vars.listen_fd);
+    unlink(socket_path);
+    return 0;
+}
+
+//=========================== private ==========================================
+
+static void _connect_bridges(void) {
+    for (size_t i = 0; i < _router_vars.n_bridges; i++) {
+        router_bridge_t *bridge = &_router_vars.bridges[i];
+        if (bridge->fd >= 0) {
+            continue;
+        }
+        struct sockaddr_un address = { .sun_family = AF_UNIX };
+        strncpy(address.sun_path, bridge->path, sizeof(address.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            close(fd);
+            continue;
+        }
+        bridge->fd = fd;
+        if (_router_vars.verbose) {
+            printf("Connected to bridge %s\n", bridge->path);
+            fflush(stdout);
+        }
+    }
+}
+
+static void _read_bridge(size_t bridge) {
+    uint8_t buffer[ROUTER_FRAME_MAX_SIZE];
+    ssize_t length;
+    while ((length = recv(_router_vars.bridges[bridge].fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        _handle_frame(bridge, buffer, length);
+    }
+    if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        // the bridge is gone, its nodes can not be reached until they show up again
+        fprintf(stderr, "Lost bridge %s\n", _router_vars.bridges[bridge].path);
+        close(_router_vars.bridges[bridge].fd);
+        _router_vars.bridges[bridge].fd = -1;
+        for (size_t i = 0; i < ROUTER_INDEX_SIZE; i++) {
+            if (_router_vars.nodes[i].node_id != 0 && _router_vars.nodes[i].bridge == bridge) {
+                _index_remove(_router_vars.nodes[i].node_id);
+                i--;  // another entry may have moved into this slot
+            }
+        }
+    }
+}
+
+// updates the table, then sends the frame to the applications
+static void _handle_frame(size_t bridge, const uint8_t *frame, size_t length) {
+    uint64_t node_id = 0;
+    switch (frame[0]) {
+        case MARI_EDGE_NODE_JOINED:
+            if (length >= 1 + sizeof(uint64_t)) {
+                memcpy(&node_id, frame + 1, sizeof(uint64_t));
+                _node_joined(node_id, bridge);
+            }
+            break;
+        case MARI_EDGE_NODE_LEFT:
+            if (length >= 1 + sizeof(uint64_t)) {
+                memcpy(&node_id, frame + 1, sizeof(uint64_t));
+                int32_t idx = _index_find(node_id);
+                if (idx >= 0 && _router_vars.nodes[idx].bridge == bridge) {
+                    _index_remove(node_id);
+                } else if (idx >= 0) {
+                    // the node joined another gateway already
+                    _router_vars.stale_leaves++;
+                }
+            }
+            break;
+        case MARI_EDGE_KEEPALIVE:
+            if (length >= 1 + sizeof(uint64_t)) {
+                memcpy(&node_id, frame + 1, sizeof(uint64_t));
+                _node_joined(node_id, bridge);
+            }
+            break;
+        case MARI_EDGE_DATA:
+            if (length >= 1 + sizeof(mr_packet_header_t)) {
+                mr_packet_header_t header;
+                memcpy(&header, frame + 1, sizeof(mr_packet_header_t));
+                _node_joined(header.src, bridge);
+            }
+            break;
+        case MARI_EDGE_GATEWAY_INFO:
+            if (length >= 1 + sizeof(uint64_t)) {
+                uint64_t gateway_id;
+                memcpy(&gateway_id, frame + 1, sizeof(uint64_t));
+                if (_router_vars.verbose && gateway_id != _router_vars.bridges[bridge].gateway_id) {
+                    printf("Bridge %s is gateway %016llX\n", _router_vars.bridges[bridge].path, (unsigned long long)gateway_id);
+                    fflush(stdout);
+                }
+                _router_vars.bridges[bridge].gateway_id = gateway_id;
+            }
+            break;
+        default:
+            break;
+    }
+
+    for (size_t i = 0; i < ROUTER_MAX_CLIENTS; i++) {
+        if (_router_vars.clients[i] >= 0 && send(_router_vars.clients[i], frame, length, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+            _close_client(i);
+        }
+    }
+}
+
+// the node is joined to the gateway of this bridge: point it there, and send what was held for it
+static void _node_joined(uint64_t node_id, size_t bridge) {
+    int32_t idx = _index_find(node_id);
+    if (idx >= 0 && _router_vars.nodes[idx].bridge == bridge) {
+        return;
+    }
+    if (idx >= 0) {
+        _router_vars.handovers++;
+    }
+    if (!_index_set(node_id, bridge)) {
+        fprintf(stderr, "Node table full, %016llX not routed\n", (unsigned long long)node_id);
+        return;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < _router_vars.held_len; i++) {
+        router_held_t *held = &_router_vars.held[i];
+        if (held->node_id == node_id) {
+            _send_to_bridge(bridge, held->frame.buffer, held->frame.length);
+            _router_vars.released++;
+        } else {
+            _router_vars.held[kept++] = *held;
+        }
+    }
+    _router_vars.held_len = kept;
+}
+
+static void _read_client(size_t client) {
+    uint8_t buffer[ROUTER_FRAME_MAX_SIZE + 1];
+    ssize_t length;
+    while ((length = recv(_router_vars.clients[client], buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        if (length > ROUTER_FRAME_MAX_SIZE) {
+            continue;
+        }
+        if (buffer[0] == MARI_EDGE_PROBE_CONFIG && length >= 1 + (ssize_t)sizeof(mr_uart_packet_probe_config_t)) {
+            // nodes move between gateways, so every gateway probes them
+            for (size_t i = 0; i < _router_vars.n_bridges; i++) {
+                _send_to_bridge(i, buffer, length);
+            }
+        } else if (buffer[0] == MARI_EDGE_PROFILE) {
+            // every gateway answers with its own profile
+            for (size_t i = 0; i < _router_vars.n_bridges; i++) {
+                _send_to_bridge(i, buffer, length);
+            }
+        } else if (buffer[0] == MARI_EDGE_DATA && length >= 1 + (ssize_t)sizeof(mr_packet_header_t)) {
+            _route_downlink(buffer, length);
+        }  // the bridges would not forward anything else
+    }
+    if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        _close_client(client);
+    }
+}
+
+static void _route_downlink(const uint8_t *frame, size_t length) {
+    mr_packet_header_t header;
+    memcpy(&header, frame + 1, sizeof(mr_packet_header_t));
+
+    if ((header.dst & MARI_GROUP_ADDRESS_PREFIX) == MARI_GROUP_ADDRESS_PREFIX) {
+        // broadcast and groups, every gateway sends it
+        for (size_t i = 0; i < _router_vars.n_bridges; i++) {
+            _send_to_bridge(i, frame, length);
+        }
+        _router_vars.broadcast++;
+        return;
+    }
+
+    int32_t idx = _index_find(header.dst);
+    if (idx >= 0) {
+        _send_to_bridge(_router_vars.nodes[idx].bridge, frame, length);
+        _router_vars.routed++;
+        return;
+    }
+
+    // not joined to any gateway right now, wait for it to join one
+    if (_router_vars.held_len == ROUTER_HELD_SIZE) {
+        _router_vars.expired++;
+        return;
+    }
+    router_held_t *held = &_router_vars.held[_router_vars.held_len++];
+    held->node_id       = header.dst;
+    held->deadline_ns   = _now_ns() + _router_vars.hold_ms * 1000000ULL;
+    held->frame.length  = length;
+    memcpy(held->frame.buffer, frame, length);
+}
+
+static void _send_to_bridge(size_t bridge, const uint8_t *frame, size_t length) {
+    if (_router_vars.bridges[bridge].fd < 0) {
+        return;
+    }
+    send(_router_vars.bridges[bridge].fd, frame, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+// held downlinks are in the order they were sent, so the ones to expire are at the front
+static void _expire_held(void) {
+    uint64_t now     = _now_ns();
+    size_t   expired = 0;
+    while (expired < _router_vars.held_len && _router_vars.held[expired].deadline_ns <= now) {
+        expired++;
+    }
+    if (expired == 0) {
+        return;
+    }
+    memmove(_router_vars.held, _router_vars.held + expired, (_router_vars.held_len - expired) * sizeof(router_held_t));
+    _router_vars.held_len -= expired;
+    _router_vars.expired += expired;
+}
+
+static void _accept_clients(void) {
+    int fd;
+    while ((fd = accept(_router_vars.listen_fd, NULL, NULL)) >= 0) {  // clients are read and written with MSG_DONTWAIT
+        size_t i = 0;
+        while (i < ROUTER_MAX_CLIENTS && _router_vars.clients[i] >= 0) {
+            i++;
+        }
+        if (i == ROUTER_MAX_CLIENTS) {
+            fprintf(stderr, "Too many clients, connection refused\n");
+            close(fd);
+            continue;
+        }
+        _router_vars.clients[i] = fd;
+    }
+}
+
+static void _close_client(size_t client) {
+    if (_router_vars.clients[client] >= 0) {
+        close(_router_vars.clients[client]);
+        _router_vars.clients[client] = -1;
+    }
+}
+
+static void _print_stats(void) {
+    printf("%zu nodes, %llu downlinks routed, %llu broadcast, %llu released after a handover, %llu expired, %llu handovers, %llu stale leaves\n",
+           _router_vars.n_nodes,
+           (unsigned long long)_router_vars.routed,
+           (unsigned long long)_router_vars.broadcast,
+           (unsigned long long)_router_vars.released,
+           (unsigned long long)_router_vars.expired,
+           (unsigned long long)_router_vars.handovers,
+           (unsigned long long)_router_vars.stale_leaves);
+    fflush(stdout);
+}
+
+static size_t _index_home(uint64_t node_id) {
+    return (node_id * ROUTER_HASH_MULTIPLY) >> 32 & (ROUTER_INDEX_SIZE - 1);
+}
+
+// returns the slot of a node, or -1 if it is not in the table
+static int32_t _index_find(uint64_t node_id) {
+    for (size_t slot = _index_home(node_id); _router_vars.nodes[slot].node_id != 0; slot = (slot + 1) & (ROUTER_INDEX_SIZE - 1)) {
+        if (_router_vars.nodes[slot].node_id == node_id) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+static bool _index_set(uint64_t node_id, uint8_t bridge) {
+    size_t slot = _index_home(node_id);
+    while (_router_vars.nodes[slot].node_id != 0 && _router_vars.nodes[slot].node_id != node_id) {
+        slot = (slot + 1) & (ROUTER_INDEX_SIZE - 1);
+    }
+    if (_router_vars.nodes[slot].node_id == 0) {
+        if (_router_vars.n_nodes == ROUTER_MAX_NODES) {
+            return false;
+        }
+        _router_vars.n_nodes++;
+    }
+    _router_vars.nodes[slot] = (router_node_t){ .node_id = node_id, .bridge = bridge };
+    return true;
+}
+
+static void _index_remove(uint64_t node_id) {
+    int32_t found = _index_find(node_id);
+    if (found < 0) {
+        return;
+    }
+    _router_vars.n_nodes--;
+
+    // backward shift deletion: move up the entries that would not be found anymore once the slot is empty
+    size_t slot = found;
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) & (ROUTER_INDEX_SIZE - 1);
+        if (_router_vars.nodes[next].node_id == 0) {
+            break;
+        }
+        size_t home = _index_home(_router_vars.nodes[next].node_id);
+        bool   stays;  // true if home is cyclically in (slot, next]
+        if (slot <= next) {
+            stays = slot < home && home <= next;
+        } else {
+            stays = slot < home || home <= next;
+        }
+        if (!stays) {
+            _router_vars.nodes[slot] = _router_vars.nodes[next];
+            slot                     = next;
+        }
+    }
+    _router_vars.nodes[slot].node_id = 0;
+}
+
+static int _open_socket(const char *path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);  // left behind by a router that did not exit cleanly
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, ROUTER_MAX_CLIENTS) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _handle_signal(int signal) {
+    (void)signal;
+    _stop = 1;
+}
+
+static void _usage(const char *name) {
+    fprintf(stderr, "Usage: %s -s <socket path> -b <bridge socket> [-b <bridge socket> ...] [-t <hold time, ms>] [-v]\n", name);
+}
@@ -0,0 +1,332 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Test of the router, with a bridge and a stand-in gateway on a pty for each gateway
+ *
+ * Plays the gateways on the master side of the ptys and one application on the socket of the router, and walks
+ * a node through joins, handovers and leaves: checks that each downlink comes out of the gateway the node is joined
+ * to, and only there, that downlinks sent in the middle of a handover are held until the node joins again, or dropped
+ * after the hold time, and that broadcasts go out of every gateway.
+ *
+ * Usage: router_test <path to mari_bridge> <path to mari_router>
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#define _GNU_SOURCE  // pty functions
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "models.h"
+#include "mari.h"
+#include "hdlc.h"
+
+//=========================== defines ==========================================
+
+#define TEST_N_GATEWAYS   3
+#define TEST_GAP_US       200
+#define TEST_HOLD_MS      1000
+#define TEST_QUIET_MS     100                    // a gateway that gets nothing for this long will not get anything
+#define TEST_TIMEOUT_MS   5000
+#define TEST_HELLO_ID     0xF0F0F0F0F0F0F000ULL  // keepalive from each gateway, to know that the router is connected to all of them
+#define TEST_NODE_ID      0x1111
+#define TEST_OTHER_NODE   0x2222
+
+//=========================== variables ========================================
+
+static int   _master_fds[TEST_N_GATEWAYS];
+static pid_t _bridges[TEST_N_GATEWAYS];
+static int   _app;
+static int   _errors = 0;
+
+//=========================== prototypes =======================================
+
+static pid_t    _start(const char *path, char *const argv[]);
+static int      _connect(const char *socket_path);
+static void     _wait_for_hello(void);
+static void     _uplink(size_t gateway, uint8_t type, uint64_t node_id);
+static void     _downlink(uint64_t dst, uint8_t tag);
+static bool     _expect_downlink(size_t gateway, uint64_t dst, uint8_t tag);
+static bool     _expect_quiet(size_t gateway);
+static bool     _expect_only(size_t gateway, uint64_t dst, uint8_t tag);
+static void     _write_all(int fd, const uint8_t *buffer, size_t length);
+static uint64_t _now_ns(void);
+static void     _check(bool condition, const char *what);
+
+//============================ main ============================================
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <path to mari_bridge> <path to mari_router>\n", argv[0]);
+        return 1;
+    }
+
+    char bridge_sockets[TEST_N_GATEWAYS][64];
+    char router_socket[64];
+    char gap[16];
+    char hold[16];
+    snprintf(router_socket, sizeof(router_socket), "/tmp/mari_router_test_%d.sock", getpid());
+    snprintf(gap, sizeof(gap), "%d", TEST_GAP_US);
+    snprintf(hold, sizeof(hold), "%d", TEST_HOLD_MS);
+    char *router_argv[4 + 2 * TEST_N_GATEWAYS + 3] = { argv[2], "-s", router_socket, "-t", hold };
+    size_t router_argc = 5;
+
+    for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+        _master_fds[i] = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (_master_fds[i] < 0 || grantpt(_master_fds[i]) < 0 || unlockpt(_master_fds[i]) < 0) {
+            perror("pty");
+            return 1;
+        }
+        snprintf(bridge_sockets[i], sizeof(bridge_sockets[i]), "/tmp/mari_router_test_%d_%zu.sock", getpid(), i);
+        char *bridge_argv[] = { argv[1], "-d", ptsname(_master_fds[i]), "-s", bridge_sockets[i], "-g", gap, NULL };
+        _bridges[i]         = _start(argv[1], bridge_argv);
+        router_argv[router_argc++] = "-b";
+        router_argv[router_argc++] = bridge_sockets[i];
+    }
+    pid_t router = _start(argv[2], router_argv);
+
+    _app = _connect(router_socket);
+    if (_app < 0) {
+        fprintf(stderr, "Could not connect to the router\n");
+        kill(router, SIGTERM);
+        for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+            kill(_bridges[i], SIGTERM);
+        }
+        return 1;
+    }
+    _wait_for_hello();
+
+    // joined to gateway 0
+    _uplink(0, MARI_EDGE_NODE_JOINED, TEST_NODE_ID);
+    _downlink(TEST_NODE_ID, 1);
+    _check(_expect_only(0, TEST_NODE_ID, 1), "downlink sent to the gateway of the node");
+
+    // handover to gateway 1: the new gateway reports the join before the old one times the node out
+    _uplink(1, MARI_EDGE_NODE_JOINED, TEST_NODE_ID);
+    _uplink(0, MARI_EDGE_NODE_LEFT, TEST_NODE_ID);
+    _downlink(TEST_NODE_ID, 2);
+    _check(_expect_only(1, TEST_NODE_ID, 2), "late leave from the old gateway ignored");
+
+    // in the middle of a handover to gateway 2: downlinks wait for the join, then go out in order
+    _uplink(1, MARI_EDGE_NODE_LEFT, TEST_NODE_ID);
+    _downlink(TEST_NODE_ID, 3);
+    _downlink(TEST_NODE_ID, 4);
+    bool quiet = true;
+    for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+        quiet &= _expect_quiet(i);
+    }
+    _check(quiet, "downlinks held while the node is not joined");
+    _uplink(2, MARI_EDGE_NODE_JOINED, TEST_NODE_ID);
+    _check(_expect_downlink(2, TEST_NODE_ID, 3) && _expect_downlink(2, TEST_NODE_ID, 4), "held downlinks sent to the new gateway, in order");
+    _check(_expect_quiet(0) && _expect_quiet(1), "held downlinks sent to the new gateway only");
+
+    // data heard by gateway 0, e.g. its join event was read before the leave from gateway 2
+    _uplink(0, MARI_EDGE_DATA, TEST_NODE_ID);
+    _downlink(TEST_NODE_ID, 5);
+    _check(_expect_only(0, TEST_NODE_ID, 5), "data from the node points it to the gateway that heard it");
+
+    // a node that does not join in time
+    _downlink(TEST_OTHER_NODE, 6);
+    usleep(TEST_HOLD_MS * 1000 * 2);
+    _uplink(1, MARI_EDGE_NODE_JOINED, TEST_OTHER_NODE);
+    _check(_expect_quiet(1), "held downlink dropped after the hold time");
+    _downlink(TEST_OTHER_NODE, 7);
+    _check(_expect_only(1, TEST_OTHER_NODE, 7), "downlink sent once the node joined");
+
+    // broadcast and groups
+    _downlink(MARI_BROADCAST_ADDRESS, 8);
+    _downlink(MARI_GROUP_ADDRESS(3), 9);
+    for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+        _check(_expect_downlink(i, MARI_BROADCAST_ADDRESS, 8) && _expect_downlink(i, MARI_GROUP_ADDRESS(3), 9), "broadcast sent to every gateway");
+    }
+
+    kill(router, SIGTERM);
+    int status;
+    waitpid(router, &status, 0);
+    _check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "router exits cleanly");
+    for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+        kill(_bridges[i], SIGTERM);
+        waitpid(_bridges[i], &status, 0);
+    }
+
+    if (_errors) {
+        printf("%d checks failed\n", _errors);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+//=========================== private ==========================================
+
+static pid_t _start(const char *path, char *const argv[]) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);  // the statistics on exit
+        dup2(null, STDOUT_FILENO);
+        execv(path, argv);
+        perror(path);
+        _exit(1);
+    }
+    return pid;
+}
+
+// retries until the router listens
+static int _connect(const char *socket_path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+    for (int attempt = 0; attempt < 200; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+// the router connects to the bridges once they listen, so wait until the application hears from every gateway
+static void _wait_for_hello(void) {
+    bool got_hello[TEST_N_GATEWAYS] = { 0 };
+    for (int attempt = 0; attempt < 200; attempt++) {
+        for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+            uint8_t  frame[1 + sizeof(uint64_t)] = { MARI_EDGE_KEEPALIVE };
+            uint64_t hello_id                    = TEST_HELLO_ID + i;
+            uint8_t  hdlc[64];
+            memcpy(frame + 1, &hello_id, sizeof(uint64_t));
+            size_t hdlc_len = mr_hdlc_encode(frame, sizeof(frame), hdlc);
+            _write_all(_master_fds[i], hdlc, hdlc_len);
+        }
+        usleep(20000);
+        uint8_t buffer[512];
+        ssize_t length;
+        while ((length = recv(_app, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            uint64_t id;
+            memcpy(&id, buffer + 1, sizeof(uint64_t));
+            if (buffer[0] == MARI_EDGE_KEEPALIVE && id - TEST_HELLO_ID < TEST_N_GATEWAYS) {
+                got_hello[id - TEST_HELLO_ID] = true;
+            }
+        }
+        size_t n_ready = 0;
+        for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+            n_ready += got_hello[i];
+        }
+        if (n_ready == TEST_N_GATEWAYS) {
+            return;
+        }
+    }
+    _check(false, "router connected to every bridge");
+}
+
+// a gateway sends a frame about a node, and the application gets it: the router has seen it, in that order
+static void _uplink(size_t gateway, uint8_t type, uint64_t node_id) {
+    uint8_t frame[1 + MARI_PACKET_MAX_SIZE] = { type };
+    size_t  frame_len;
+    if (type == MARI_EDGE_DATA) {
+        mr_packet_header_t header = { .version = 3, .type = MARI_PACKET_DATA, .src = node_id, .dst = 0xABCDEF };
+        memcpy(frame + 1, &header, sizeof(header));
+        frame_len = 1 + sizeof(header) + 4;
+    } else {
+        memcpy(frame + 1, &node_id, sizeof(uint64_t));
+        frame_len = 1 + sizeof(uint64_t);
+    }
+    uint8_t hdlc[2 * sizeof(frame) + 8];
+    _write_all(_master_fds[gateway], hdlc, mr_hdlc_encode(frame, frame_len, hdlc));
+
+    uint64_t start = _now_ns();
+    while (_now_ns() - start < TEST_TIMEOUT_MS * 1000000ULL) {
+        struct pollfd fd = { .fd = _app, .events = POLLIN };
+        poll(&fd, 1, 100);
+        uint8_t buffer[512];
+        ssize_t length;
+        while ((length = recv(_app, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            if ((size_t)length == frame_len && memcmp(buffer, frame, frame_len) == 0) {
+                return;
+            }
+        }
+    }
+    _check(false, "uplink forwarded to the application");
+}
+
+static void _downlink(uint64_t dst, uint8_t tag) {
+    uint8_t            frame[1 + sizeof(mr_packet_header_t) + 8] = { MARI_EDGE_DATA };
+    mr_packet_header_t header                                    = { .version = 3, .type = MARI_PACKET_DATA, .dst = dst };
+    memcpy(frame + 1, &header, sizeof(header));
+    memset(frame + 1 + sizeof(header), tag, 8);
+    send(_app, frame, sizeof(frame), 0);
+}
+
+// waits for the next frame out of a gateway, and checks it is the given downlink
+static bool _expect_downlink(size_t gateway, uint64_t dst, uint8_t tag) {
+    mr_hdlc_reset();
+    uint64_t start = _now_ns();
+    while (_now_ns() - start < TEST_TIMEOUT_MS * 1000000ULL) {
+        struct pollfd fd = { .fd = _master_fds[gateway], .events = POLLIN };
+        poll(&fd, 1, 100);
+        uint8_t byte;
+        while (read(_master_fds[gateway], &byte, 1) == 1) {  // one byte at a time, to leave the next frame in the pty
+            if (mr_hdlc_rx_byte(byte) != MR_HDLC_STATE_READY) {
+                continue;
+            }
+            uint8_t            frame[1024];
+            size_t             frame_len = mr_hdlc_decode(frame);
+            mr_packet_header_t header;
+            memcpy(&header, frame + 1, sizeof(header));
+            return frame_len == 1 + sizeof(header) + 8 && frame[0] == MARI_EDGE_DATA && header.dst == dst && frame[1 + sizeof(header)] == tag;
+        }
+    }
+    return false;
+}
+
+static bool _expect_quiet(size_t gateway) {
+    struct pollfd fd = { .fd = _master_fds[gateway], .events = POLLIN };
+    return poll(&fd, 1, TEST_QUIET_MS) == 0;
+}
+
+static bool _expect_only(size_t gateway, uint64_t dst, uint8_t tag) {
+    bool ok = _expect_downlink(gateway, dst, tag);
+    for (size_t i = 0; i < TEST_N_GATEWAYS; i++) {
+        ok &= i == gateway || _expect_quiet(i);
+    }
+    return ok;
+}
+
+static void _write_all(int fd, const uint8_t *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, buffer, length);
+        if (written > 0) {
+            buffer += written;
+            length -= written;
+        } else {
+            usleep(1000);
+        }
+    }
+}
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _check(bool condition, const char *what) {
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        _errors++;
+    }
+}
@@ -0,0 +1,362 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Test of the gateway bridge, against a stand-in gateway on a pty
+ *
+ * Starts the bridge on the slave side of a pty, connects many applications to its socket, and plays the gateway on
+ * the master side: writes a burst of frames faster than the uart of the gateway, a few of them corrupted, and checks that
+ * every application gets every valid frame, in order. Then sends downlinks from one application, and checks that
+ * the gateway gets the valid ones, in order and paced by the gap.
+ *
+ * Usage: bridge_test <path to mari_bridge>
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#define _GNU_SOURCE  // pty functions
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "models.h"
+#include "hdlc.h"
+
+//=========================== defines ==========================================
+
+#define TEST_N_CLIENTS     16
+#define TEST_N_FRAMES      2000
+#define TEST_CORRUPT_EVERY 97      // a corrupted copy is written before these frames
+#define TEST_LINE_RATE     400000  // bytes per second written by the stand-in gateway, 4 times what the uart carries
+#define TEST_N_DOWNLINKS   20
+#define TEST_GAP_US        2000
+#define TEST_TIMEOUT_MS    10000
+#define TEST_HELLO_ID      0xFFFFFFFFFFFFFFFFULL  // keepalive used to know that all the applications are connected
+
+//=========================== variables ========================================
+
+static int    _master_fd;
+static int    _clients[TEST_N_CLIENTS];
+static size_t _received[TEST_N_CLIENTS];  // frames of the burst received by each application
+static bool   _failed[TEST_N_CLIENTS];    // a frame was missing or wrong, the rest is not checked
+static int    _errors = 0;
+
+//=========================== prototypes =======================================
+
+static pid_t    _start_bridge(const char *bridge_path, const char *serial_path, const char *socket_path);
+static int      _connect(const char *socket_path);
+static void     _wait_for_hello(void);
+static void     _test_uplink(void);
+static void     _test_downlink(void);
+static void     _read_clients(int timeout_ms);
+static size_t   _make_frame(uint32_t index, uint8_t *frame);
+static size_t   _make_downlink(uint32_t index, uint8_t *frame);
+static void     _write_all(const uint8_t *buffer, size_t length);
+static uint64_t _now_ns(void);
+static void     _check(bool condition, const char *what);
+
+//============================ main ============================================
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <path to mari_bridge>\n", argv[0]);
+        return 1;
+    }
+
+    _master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_master_fd < 0 || grantpt(_master_fd) < 0 || unlockpt(_master_fd) < 0) {
+        perror("pty");
+        return 1;
+    }
+    char socket_path[64];
+    snprintf(socket_path, sizeof(socket_path), "/tmp/mari_bridge_test_%d.sock", getpid());
+    pid_t bridge = _start_bridge(argv[1], ptsname(_master_fd), socket_path);
+
+    for (size_t i = 0; i < TEST_N_CLIENTS; i++) {
+        _clients[i] = _connect(socket_path);
+        if (_clients[i] < 0) {
+            fprintf(stderr, "Could not connect to the bridge\n");
+            kill(bridge, SIGTERM);
+            return 1;
+        }
+    }
+    _wait_for_hello();
+
+    _test_uplink();
+    _test_downlink();
+
+    kill(bridge, SIGTERM);
+    int status;
+    waitpid(bridge, &status, 0);
+    _check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "bridge exits cleanly");
+
+    if (_errors) {
+        printf("%d checks failed\n", _errors);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+//=========================== private ==========================================
+
+static pid_t _start_bridge(const char *bridge_path, const char *serial_path, const char *socket_path) {
+    char gap[16];
+    snprintf(gap, sizeof(gap), "%d", TEST_GAP_US);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(bridge_path, bridge_path, "-d", serial_path, "-s", socket_path, "-g", gap, (char *)NULL);
+        perror(bridge_path);
+        _exit(1);
+    }
+    return pid;
+}
+
+// retries until the bridge listens
+static int _connect(const char *socket_path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+    for (int attempt = 0; attempt < 200; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+// the bridge only sends frames to the applications it accepted, so wait until all of them got one
+static void _wait_for_hello(void) {
+    uint8_t frame[1 + sizeof(uint64_t)] = { MARI_EDGE_KEEPALIVE };
+    uint8_t hdlc[64];
+    memset(frame + 1, 0xFF, sizeof(uint64_t));
+    size_t hdlc_len = mr_hdlc_encode(frame, sizeof(frame), hdlc);
+
+    bool got_hello[TEST_N_CLIENTS] = { 0 };
+    for (int attempt = 0; attempt < 100; attempt++) {
+        _write_all(hdlc, hdlc_len);
+        usleep(20000);
+        size_t n_ready = 0;
+        for (size_t i = 0; i < TEST_N_CLIENTS; i++) {
+            uint8_t buffer[512];
+            while (recv(_clients[i], buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+                got_hello[i] = true;
+            }
+            n_ready += got_hello[i];
+        }
+        if (n_ready == TEST_N_CLIENTS) {
+            return;
+        }
+    }
+    _check(false, "all applications connected");
+}
+
+static void _test_uplink(void) {
+    // the whole burst, encoded in advance
+    uint8_t *stream     = malloc((size_t)TEST_N_FRAMES * 2 * 2 * (MARI_PACKET_MAX_SIZE + 8));
+    size_t   stream_len = 0;
+    for (uint32_t i = 0; i < TEST_N_FRAMES; i++) {
+        uint8_t frame[1 + MARI_PACKET_MAX_SIZE];
+        size_t  frame_len = _make_frame(i, frame);
+        if (i % TEST_CORRUPT_EVERY == 0) {
+            size_t corrupt_len = mr_hdlc_encode(frame, frame_len, stream + stream_len);
+            stream[stream_len + 2] ^= 0x01;  // the fcs does not match anymore
+            if (stream[stream_len + 2] == 0x7E || stream[stream_len + 2] == 0x7D) {
+                stream[stream_len + 2] ^= 0x03;
+            }
+            stream_len += corrupt_len;
+        }
+        stream_len += mr_hdlc_encode(frame, frame_len, stream + stream_len);
+    }
+
+    uint64_t start   = _now_ns();
+    size_t   written = 0;
+    while (_now_ns() - start < TEST_TIMEOUT_MS * 1000000ULL) {
+        size_t allowed = (_now_ns() - start) * TEST_LINE_RATE / 1000000000ULL;
+        if (written < stream_len && written < allowed) {
+            size_t  chunk  = allowed - written < stream_len - written ? allowed - written : stream_len - written;
+            ssize_t length = write(_master_fd, stream + written, chunk);
+            if (length > 0) {
+                written += length;
+            }
+        }
+        _read_clients(1);
+        size_t n_done = 0;
+        for (size_t i = 0; i < TEST_N_CLIENTS; i++) {
+            n_done += _received[i] == TEST_N_FRAMES || _failed[i];
+        }
+        if (n_done == TEST_N_CLIENTS) {
+            break;
+        }
+    }
+    double elapsed_s = (double)(_now_ns() - start) / 1e9;
+    printf("    %d frames (%zu bytes) to %d applications in %.1f ms, %.0f frames/s delivered\n", TEST_N_FRAMES, stream_len, TEST_N_CLIENTS, elapsed_s * 1000, TEST_N_FRAMES * TEST_N_CLIENTS / elapsed_s);
+    for (size_t i = 0; i < TEST_N_CLIENTS; i++) {
+        _check(!_failed[i] && _received[i] == TEST_N_FRAMES, "all frames received by every application, in order");
+    }
+    free(stream);
+}
+
+// reads what the applications got, and checks it against the burst
+static void _read_clients(int timeout_ms) {
+    struct pollfd fds[TEST_N_CLIENTS];
+    for (size_t i = 0; i < TEST_N_CLIENTS; i++) {
+        fds[i] = (struct pollfd){ .fd = _clients[i], .events = POLLIN };
+    }
+    if (poll(fds, TEST_N_CLIENTS, timeout_ms) <= 0) {
+        return;
+    }
+    for (size_t i = 0; i < TEST_N_CLIENTS; i++) {
+        uint8_t buffer[512];
+        ssize_t length;
+        while (!_failed[i] && (length = recv(_clients[i], buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            uint64_t id;
+            memcpy(&id, buffer + 1, sizeof(uint64_t));
+            if (buffer[0] == MARI_EDGE_KEEPALIVE && id == TEST_HELLO_ID) {
+                continue;
+            }
+            uint8_t expected[1 + MARI_PACKET_MAX_SIZE];
+            size_t  expected_len = _make_frame(_received[i], expected);
+            if ((size_t)length != expected_len || memcmp(buffer, expected, expected_len) != 0) {
+                _failed[i] = true;
+                break;
+            }
+            _received[i]++;
+        }
+    }
+}
+
+static void _test_downlink(void) {
+    // all at once, from one application so that their order is known, with invalid downlinks in between
+    for (uint32_t i = 0; i < TEST_N_DOWNLINKS; i++) {
+        uint8_t frame[1 + MARI_PACKET_MAX_SIZE];
+        size_t  frame_len = _make_downlink(i, frame);
+        send(_clients[0], frame, frame_len, 0);
+        if (i % 5 == 0) {
+            frame[0] = MARI_EDGE_KEEPALIVE;
+            send(_clients[0], frame, frame_len, 0);
+        }
+    }
+
+    uint64_t timestamps[TEST_N_DOWNLINKS];
+    uint32_t n_received = 0;
+    uint64_t start      = _now_ns();
+    mr_hdlc_reset();
+    while (_now_ns() - start < TEST_TIMEOUT_MS * 1000000ULL) {
+        struct pollfd fd = { .fd = _master_fd, .events = POLLIN };
+        // wait a bit after the last one, to catch any extra frame
+        if (poll(&fd, 1, n_received == TEST_N_DOWNLINKS ? 4 * TEST_GAP_US / 1000 : 100) == 0 && n_received == TEST_N_DOWNLINKS) {
+            break;
+        }
+        uint8_t buffer[4096];
+        ssize_t length = read(_master_fd, buffer, sizeof(buffer));
+        for (ssize_t i = 0; i < length; i++) {
+            if (mr_hdlc_rx_byte(buffer[i]) != MR_HDLC_STATE_READY) {
+                continue;
+            }
+            uint8_t frame[1024];
+            size_t  frame_len = mr_hdlc_decode(frame);
+            uint8_t expected[1 + MARI_PACKET_MAX_SIZE];
+            size_t  expected_len = _make_downlink(n_received, expected);
+            if (n_received == TEST_N_DOWNLINKS || frame_len != expected_len || memcmp(frame, expected, expected_len) != 0) {
+                _check(false, "only the valid downlinks, in order");
+                continue;
+            }
+            timestamps[n_received++] = _now_ns();
+        }
+    }
+    _check(n_received == TEST_N_DOWNLINKS, "all downlinks forwarded");
+
+    // frames are read in chunks, so only check the gaps on average, and that none is far too short
+    uint64_t min_gap_ns = UINT64_MAX;
+    for (uint32_t i = 1; i < n_received; i++) {
+        if (timestamps[i] - timestamps[i - 1] < min_gap_ns) {
+            min_gap_ns = timestamps[i] - timestamps[i - 1];
+        }
+    }
+    if (n_received > 1) {
+        double mean_gap_us = (double)(timestamps[n_received - 1] - timestamps[0]) / (n_received - 1) / 1000;
+        printf("    %u downlinks, %.0f us apart on average, at least %.0f us (gap %d us)\n", n_received, mean_gap_us, (double)min_gap_ns / 1000, TEST_GAP_US);
+        _check(mean_gap_us >= TEST_GAP_US * 0.9, "downlinks paced");
+        _check(min_gap_ns >= TEST_GAP_US * 1000ULL / 2, "no burst of downlinks");
+    }
+}
+
+// frames as the gateway sends them, of all types and sizes, with bytes that need escaping
+static size_t _make_frame(uint32_t index, uint8_t *frame) {
+    uint64_t node_id = 0x1000 + index % 100;
+    switch (index % 10) {
+        case 0:
+        {
+            frame[0]                           = MARI_EDGE_GATEWAY_INFO;
+            mr_uart_packet_gateway_info_t info = { .device_id = 0xABCDEF, .net_id = 0x12, .asn = index, .stats_len = MARI_STATS_CELLS_PER_INFO };
+            memcpy(frame + 1, &info, sizeof(info));
+            return 1 + sizeof(info);
+        }
+        case 1:
+        case 2:
+            frame[0] = index % 10 == 1 ? MARI_EDGE_NODE_JOINED : MARI_EDGE_KEEPALIVE;
+            memcpy(frame + 1, &node_id, sizeof(uint64_t));
+            return 1 + sizeof(uint64_t);
+        default:
+        {
+            frame[0]                  = MARI_EDGE_DATA;
+            mr_packet_header_t header = { .version = 3, .type = MARI_PACKET_DATA, .src = node_id, .dst = 0xABCDEF };
+            memcpy(frame + 1, &header, sizeof(header));
+            size_t payload_len = (index * 37) % (MARI_PACKET_MAX_SIZE - sizeof(header));
+            for (size_t i = 0; i < payload_len; i++) {
+                frame[1 + sizeof(header) + i] = (i % 3 == 0) ? 0x7E : (i % 3 == 1) ? 0x7D : index + i;
+            }
+            return 1 + sizeof(header) + payload_len;
+        }
+    }
+}
+
+static size_t _make_downlink(uint32_t index, uint8_t *frame) {
+    frame[0]                  = MARI_EDGE_DATA;
+    mr_packet_header_t header = { .version = 3, .type = MARI_PACKET_DATA, .dst = 0x1000 + index };
+    memcpy(frame + 1, &header, sizeof(header));
+    for (size_t i = 0; i < 16; i++) {
+        frame[1 + sizeof(header) + i] = index ^ 0x7E;
+    }
+    return 1 + sizeof(header) + 16;
+}
+
+static void _write_all(const uint8_t *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(_master_fd, buffer, length);
+        if (written > 0) {
+            buffer += written;
+            length -= written;
+        } else {
+            usleep(1000);
+        }
+    }
+}
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _check(bool condition, const char *what) {
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        _errors++;
+    }
+}
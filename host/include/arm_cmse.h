@@ -0,0 +1,6 @@
+#ifndef __ARM_CMSE_H
+#define __ARM_CMSE_H
+
+// see nrf.h
+
+#endif
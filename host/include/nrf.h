@@ -0,0 +1,44 @@
+#ifndef __NRF_H
+#define __NRF_H
+
+// Minimal stand-in for the nRF device headers, to build the mari sources on a computer.
+// Only what the mari sources and the driver headers they include actually use is defined here,
+// and the drivers themselves are replaced by stubs.
+
+#include <stdint.h>
+
+#define NRF52840_XXAA 1
+
+typedef struct {
+    uint32_t DEVICEID[2];
+    uint32_t DEVICEADDR[2];
+} NRF_FICR_Type;
+extern NRF_FICR_Type host_ficr;
+#define NRF_FICR (&host_ficr)
+
+typedef struct {
+    uint32_t OUT;
+} NRF_GPIO_Type;
+extern NRF_GPIO_Type host_p0, host_p1;
+#define NRF_P0 (&host_p0)
+#define NRF_P1 (&host_p1)
+
+#define GPIOTE_CONFIG_POLARITY_LoToHi 1
+#define GPIOTE_CONFIG_POLARITY_HiToLo 2
+#define GPIOTE_CONFIG_POLARITY_Toggle 3
+
+#define __WFE()         ((void)0)
+#define __SEV()         ((void)0)
+#define __NOP()         ((void)0)
+#define __DMB()         ((void)0)
+#define __disable_irq() ((void)0)
+#define __enable_irq()  ((void)0)
+
+static inline uint32_t __get_PRIMASK(void) {
+    return 0;
+}
+static inline void __set_PRIMASK(uint32_t primask) {
+    (void)primask;
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef __NRF_PERIPHERALS_H
+#define __NRF_PERIPHERALS_H
+
+// see nrf.h
+
+#endif
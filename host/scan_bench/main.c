@@ -0,0 +1,290 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Benchmark of the scan list, with up to 64 gateways in range
+ *
+ * Feeds beacons from more and more gateways into the scan list, and measures the time taken by each update
+ * (it runs in the radio interrupt, for every beacon heard while scanning) and by the gateway selection.
+ * The linear search used before the hash index, over a list of the same size, is measured for reference.
+ * Also checks the averaging and the ranking of the gateways.
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "scan.h"
+#include "mr_radio.h"
+
+//=========================== defines ==========================================
+
+#define BENCH_N_BEACONS     200000  // beacons fed into the scan list for each measurement
+#define BENCH_N_SELECTS     10000   // gateway selections
+#define BENCH_MAX_GATEWAYS  64      // more than the scan list holds, so that some are replaced
+#define BENCH_BEACON_GAP_US 10      // time between two beacons, any gateway
+
+// an entry of the scan list before the hash index
+typedef struct {
+    uint64_t          gateway_id;
+    mr_channel_info_t channel_info[MARI_N_BLE_ADVERTISING_CHANNELS];
+} legacy_scan_t;
+
+//=========================== variables ========================================
+
+static uint64_t          _gateway_ids[BENCH_MAX_GATEWAYS];
+static legacy_scan_t     _legacy[MARI_MAX_SCAN_LIST_SIZE];
+static uint64_t          _prng_state = 0x9E3779B97F4A7C15ULL;
+static uint32_t          _ts         = 1;  // microseconds, 0 means no reading
+static int               _errors     = 0;
+static volatile uint32_t _sink;  // keeps the compiler from optimizing the measured loops away
+
+//=========================== prototypes =======================================
+
+static void     _bench_gateways(uint8_t n_gateways);
+static void     _check_ranking(void);
+static void     _add(uint64_t gateway_id, int8_t rssi, uint16_t remaining_capacity, uint8_t join_backlog);
+static uint64_t _select(uint32_t ts_scan_started, int8_t *rssi);
+static void     _legacy_add(mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts);
+static void     _legacy_save(size_t idx, mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts);
+static uint32_t _legacy_ts_latest(legacy_scan_t scan);
+static uint64_t _prng(void);
+static uint64_t _now_ns(void);
+static void     _timing_print(const char *name, uint64_t start_ns, uint32_t count);
+static void     _check(bool condition, const char *what);
+
+//============================ main ============================================
+
+int main(void) {
+    for (size_t i = 0; i < BENCH_MAX_GATEWAYS; i++) {
+        _gateway_ids[i] = _prng();
+    }
+
+    _bench_gateways(5);
+    _bench_gateways(16);
+    _bench_gateways(32);
+    _bench_gateways(64);
+
+    _check_ranking();
+
+    if (_errors) {
+        printf("%d checks failed\n", _errors);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+//=========================== private ==========================================
+
+static void _bench_gateways(uint8_t n_gateways) {
+    printf("%d gateways in range, %d tracked\n", n_gateways, MARI_MAX_SCAN_LIST_SIZE);
+
+    // beacons from random gateways, with random rssi
+    _ts += MARI_SCAN_OLD_US + 1;
+    uint32_t ts_scan_started = _ts;
+    uint64_t start           = _now_ns();
+    for (uint32_t i = 0; i < BENCH_N_BEACONS; i++) {
+        uint64_t random = _prng();
+        _add(_gateway_ids[random % n_gateways], -40 - (int8_t)((random >> 32) % 50), 10, 0);
+    }
+    _timing_print("beacon (scan list update)", start, BENCH_N_BEACONS);
+
+    memset(_legacy, 0, sizeof(_legacy));
+    start = _now_ns();
+    for (uint32_t i = 0; i < BENCH_N_BEACONS; i++) {
+        uint64_t                  random = _prng();
+        mr_beacon_packet_header_t beacon = { .src = _gateway_ids[random % n_gateways] };
+        _legacy_add(beacon, -40 - (int8_t)((random >> 32) % 50), 37 + (random >> 40) % 3, _ts + i * BENCH_BEACON_GAP_US);
+    }
+    _timing_print("  linear search, for reference", start, BENCH_N_BEACONS);
+
+    int8_t rssi;
+    start = _now_ns();
+    for (uint32_t i = 0; i < BENCH_N_SELECTS; i++) {
+        _sink += _select(ts_scan_started, &rssi);
+    }
+    _timing_print("gateway selection", start, BENCH_N_SELECTS);
+
+    // the most recently heard gateways are all kept
+    _ts += MARI_SCAN_OLD_US + 1;
+    ts_scan_started = _ts;
+    for (uint8_t i = 0; i < n_gateways; i++) {
+        _add(_gateway_ids[i], -90, 10, 0);
+    }
+    uint8_t strongest = n_gateways - (n_gateways < MARI_MAX_SCAN_LIST_SIZE ? n_gateways : MARI_MAX_SCAN_LIST_SIZE);
+    _add(_gateway_ids[strongest], -30, 10, 0);
+    _add(_gateway_ids[strongest], -30, 10, 0);
+    // its average still includes the first reading
+    _check(_select(ts_scan_started, &rssi) == _gateway_ids[strongest] && rssi < -30, "recently heard gateway kept");
+    if (n_gateways > MARI_MAX_SCAN_LIST_SIZE) {
+        _add(_gateway_ids[0], -20, 10, 0);  // was replaced, comes back as a new gateway
+        _check(_select(ts_scan_started, &rssi) == _gateway_ids[0] && rssi == -20, "replaced gateway starts over");
+    }
+}
+
+static void _check_ranking(void) {
+    int8_t   rssi;
+    uint32_t ts_scan_started;
+
+    // the average of weak readings must not overflow
+    _ts += MARI_SCAN_OLD_US + 1;
+    ts_scan_started = _ts;
+    for (int i = 0; i < 3; i++) {
+        _add(1, -100, 10, 0);
+    }
+    _check(_select(ts_scan_started, &rssi) == 1 && rssi == -100, "average of weak readings");
+
+    // a stable link beats a slightly stronger, but fluctuating one
+    _ts += MARI_SCAN_OLD_US + 1;
+    ts_scan_started = _ts;
+    for (int i = 0; i < 20; i++) {
+        _add(1, -60, 10, 0);
+        _add(2, (i % 2) ? -44 : -72, 10, 0);
+    }
+    _check(_select(ts_scan_started, &rssi) == 1, "stable link preferred");
+
+    // with similar links, the gateway with room left wins
+    _ts += MARI_SCAN_OLD_US + 1;
+    ts_scan_started = _ts;
+    for (int i = 0; i < 10; i++) {
+        _add(1, -60, 2, 4);
+        _add(2, -62, 40, 0);
+    }
+    _check(_select(ts_scan_started, &rssi) == 2, "gateway with free cells preferred");
+
+    // but a much better link wins anyway
+    _ts += MARI_SCAN_OLD_US + 1;
+    ts_scan_started = _ts;
+    for (int i = 0; i < 10; i++) {
+        _add(1, -50, 2, 4);
+        _add(2, -80, 40, 0);
+    }
+    _check(_select(ts_scan_started, &rssi) == 1, "much better link preferred");
+
+    // full gateways are never selected
+    _ts += MARI_SCAN_OLD_US + 1;
+    ts_scan_started = _ts;
+    _add(1, -30, 0, 0);
+    _add(2, -90, 1, 0);
+    _check(_select(ts_scan_started, &rssi) == 2, "full gateway skipped");
+    _add(2, -90, 0, 0);
+    _check(_select(ts_scan_started, &rssi) == 0, "no gateway with room left");
+
+    // readings from before the scan started are ignored
+    _ts += MARI_SCAN_OLD_US + 1;
+    _add(1, -30, 10, 0);
+    ts_scan_started = _ts + 1;
+    _add(2, -90, 10, 0);
+    _check(_select(ts_scan_started, &rssi) == 2, "old reading ignored");
+
+    // an old reading that arrives last does not hide the recent ones
+    _ts += MARI_SCAN_OLD_US + 1;
+    ts_scan_started = _ts;
+    _add(2, -90, 10, 0);
+    mr_scan_add((mr_beacon_packet_header_t){ .version = 3, .type = MARI_PACKET_BEACON, .src = 1, .remaining_capacity = 10 }, -30, 37, ts_scan_started - 1, 0);
+    _check(_select(ts_scan_started, &rssi) == 2, "recent reading found past an old one");
+}
+
+static void _add(uint64_t gateway_id, int8_t rssi, uint16_t remaining_capacity, uint8_t join_backlog) {
+    mr_beacon_packet_header_t beacon = {
+        .version            = 3,
+        .type               = MARI_PACKET_BEACON,
+        .src                = gateway_id,
+        .remaining_capacity = remaining_capacity,
+        .join_backlog       = join_backlog,
+    };
+    _ts += BENCH_BEACON_GAP_US;
+    mr_scan_add(beacon, rssi, 37, _ts, 0);
+}
+
+// returns the selected gateway, 0 if none
+static uint64_t _select(uint32_t ts_scan_started, int8_t *rssi) {
+    mr_channel_info_t selected;
+    if (!mr_scan_select(&selected, ts_scan_started, _ts)) {
+        return 0;
+    }
+    *rssi = selected.rssi;
+    return selected.beacon.src;
+}
+
+// the update used before the hash index, with the list scaled up: one pass to look for the gateway, an empty entry and
+// the entry heard the longest time ago, keeping one reading per advertising channel
+static void _legacy_add(mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts) {
+    int32_t  empty_idx  = -1;
+    uint32_t oldest_ts  = ts;
+    uint32_t oldest_idx = 0;
+    for (size_t i = 0; i < MARI_MAX_SCAN_LIST_SIZE; i++) {
+        if (_legacy[i].gateway_id == beacon.src) {
+            _legacy_save(i, beacon, rssi, channel, ts);
+            return;
+        }
+        if (_legacy[i].gateway_id == 0 && empty_idx < 0) {
+            empty_idx = i;
+        }
+        uint32_t ts_latest = _legacy_ts_latest(_legacy[i]);
+        if (_legacy[i].gateway_id != 0 && ts_latest < oldest_ts) {
+            oldest_ts  = ts_latest;
+            oldest_idx = i;
+        }
+    }
+    size_t idx = empty_idx >= 0 ? (size_t)empty_idx : oldest_idx;
+    memset(&_legacy[idx], 0, sizeof(legacy_scan_t));
+    _legacy[idx].gateway_id = beacon.src;
+    _legacy_save(idx, beacon, rssi, channel, ts);
+}
+
+static void _legacy_save(size_t idx, mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts) {
+    mr_channel_info_t *info = &_legacy[idx].channel_info[channel % MARI_N_BLE_REGULAR_CHANNELS];
+    info->rssi              = rssi;
+    info->timestamp         = ts;
+    memcpy(&info->beacon, &beacon, sizeof(mr_beacon_scan_header_t));
+}
+
+// takes the entry by value, as it did
+static uint32_t _legacy_ts_latest(legacy_scan_t scan) {
+    uint32_t latest = 0;
+    for (size_t i = 0; i < MARI_N_BLE_ADVERTISING_CHANNELS; i++) {
+        if (scan.channel_info[i].timestamp > latest) {
+            latest = scan.channel_info[i].timestamp;
+        }
+    }
+    return latest;
+}
+
+static uint64_t _prng(void) {
+    // xorshift64
+    _prng_state ^= _prng_state << 13;
+    _prng_state ^= _prng_state >> 7;
+    _prng_state ^= _prng_state << 17;
+    return _prng_state;
+}
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _timing_print(const char *name, uint64_t start_ns, uint32_t count) {
+    printf("    %-30s %8.1f ns\n", name, (double)(_now_ns() - start_ns) / count);
+}
+
+static void _check(bool condition, const char *what) {
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        _errors++;
+    }
+}
+
+//=========================== stubs ============================================
+
+// scan.c counts the beacons in the stats block, which reads the counter of the radio driver
+uint32_t mr_radio_get_crc_errors(void) {
+    return 0;
+}
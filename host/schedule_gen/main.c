@@ -0,0 +1,226 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Generates, validates and prints Mari schedules
+ *
+ * Usage:
+ *   schedule_gen check                                         validates the pre-stored schedules
+ *   schedule_gen emit                                          prints the pre-stored schedules, i.e. mari/all_schedules.c
+ *   schedule_gen <id> <n_nodes> <shared_uplink_%> <downlink_%> generates and prints a custom schedule
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mari.h"
+#include "schedule_gen.h"
+#include "all_schedules.c"
+
+//=========================== defines ==========================================
+
+typedef struct {
+    const char *name;
+    schedule_t *stored;  // pre-stored version, compiled from all_schedules.c
+    uint8_t     id;
+    uint16_t    n_nodes;
+    uint8_t     shared_uplink_percent;
+    uint8_t     downlink_percent;
+    bool        wide;  // only available with MARI_WIDE_SCHEDULES
+} template_t;
+
+//=========================== variables ========================================
+
+// parameters of the pre-stored schedules, from smallest to largest
+static const template_t _templates[] = {
+    { "tiny", &schedule_tiny, 6, 10, 20, 20, false },
+    { "medium", &schedule_medium, 4, 44, 22, 22, false },
+    { "big", &schedule_big, 3, 66, 24, 24, false },
+    { "huge", &schedule_huge, 1, 102, 21, 21, false },
+    { "wide", &schedule_wide, 8, 500, 10, 10, true },
+};
+#define N_TEMPLATES (sizeof(_templates) / sizeof(_templates[0]))
+
+static schedule_t _schedule;
+static cell_t     _cells[MARI_N_CELLS_MAX];
+
+//=========================== prototypes =======================================
+
+static int  _check(void);
+static int  _emit(void);
+static int  _custom(char **argv);
+static void _print_report(const char *name, const schedule_t *schedule);
+static void _print_schedule(const char *name, const schedule_t *schedule);
+static bool _same_schedule(const schedule_t *a, const schedule_t *b);
+
+//============================ main ============================================
+
+int main(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "check") == 0) {
+        return _check();
+    }
+    if (argc == 2 && strcmp(argv[1], "emit") == 0) {
+        return _emit();
+    }
+    if (argc == 5) {
+        return _custom(argv);
+    }
+    fprintf(stderr, "usage: %s check | emit | <id> <n_nodes> <shared_uplink_%%> <downlink_%%>\n", argv[0]);
+    return 2;
+}
+
+//=========================== private ==========================================
+
+static int _check(void) {
+    int ret = 0;
+    for (size_t i = 0; i < N_TEMPLATES; i++) {
+        const template_t *template = &_templates[i];
+        if (!mr_schedule_gen_check(template->stored, NULL)) {
+            printf("%s: invalid schedule\n", template->name);
+            ret = 1;
+            continue;
+        }
+        if (!mr_schedule_gen_build(&_schedule, _cells, MARI_N_CELLS_MAX, template->id, template->n_nodes, template->shared_uplink_percent, template->downlink_percent) ||
+            !_same_schedule(&_schedule, template->stored)) {
+            printf("%s: out of date, run 'make emit'\n", template->name);
+            ret = 1;
+        }
+        if (template->stored->max_nodes > MARI_MAX_NODES) {
+            printf("%s: more nodes than MARI_MAX_NODES\n", template->name);
+            ret = 1;
+        }
+        _print_report(template->name, template->stored);
+    }
+    return ret;
+}
+
+static int _emit(void) {
+    printf("/**\n");
+    printf(" * @file\n");
+    printf(" * @ingroup     net_maclow\n");
+    printf(" *\n");
+    printf(" * @brief       Fixed schedules\n");
+    printf(" *\n");
+    printf(" * Generated by host/schedule_gen ('make emit'), do not edit by hand.\n");
+    printf(" *\n");
+    printf(" * @author Anonymous Anon <anonymous.anon@anon.org>\n");
+    printf(" *\n");
+    printf(" * @copyright Anon, 2024\n");
+    printf(" */\n");
+    printf("#include \"models.h\"\n");
+    printf("\n");
+    size_t n_regular = 0;
+    for (size_t i = 0; i < N_TEMPLATES; i++) {
+        n_regular += !_templates[i].wide;
+    }
+    printf("// account for:\n");
+    printf("// - the %zu schedules supporting up to", n_regular);
+    for (size_t i = 0; i < n_regular; i++) {
+        printf("%s %d", i == 0 ? "" : (i == n_regular - 1 ? " and" : ","), _templates[i].n_nodes);
+    }
+    printf(" nodes\n");
+    printf("// - with MARI_WIDE_SCHEDULES, %zu more supporting up to", N_TEMPLATES - n_regular);
+    for (size_t i = n_regular; i < N_TEMPLATES; i++) {
+        printf("%s %d", i == n_regular ? "" : ",", _templates[i].n_nodes);
+    }
+    printf(" nodes\n");
+    printf("// - the schedule that can be passed by the application during initialization\n");
+    printf("#if MARI_WIDE_SCHEDULES\n");
+    printf("#define MARI_N_SCHEDULES %zu + 1\n", N_TEMPLATES);
+    printf("#else\n");
+    printf("#define MARI_N_SCHEDULES %zu + 1\n", n_regular);
+    printf("#endif\n");
+    printf("\n");
+    printf("// clang-format off\n");
+    printf("/* Schedule used for tests only. Commented out by default. */\n");
+    printf("// schedule_t schedule_test = {\n");
+    printf("//     .id            = 0xFE,\n");
+    printf("//     .max_nodes     = 0,\n");
+    printf("//     .backoff_n_min = 5,\n");
+    printf("//     .backoff_n_max = 9,\n");
+    printf("//     .n_cells       = 1,\n");
+    printf("//     .cells         = (cell_t[]){\n");
+    printf("//         // the channel offset doesn't matter here\n");
+    printf("//         { 'U', 0, 0, 0, 0 },\n");
+    printf("//     }\n");
+    printf("// };\n");
+    for (size_t i = 0; i < N_TEMPLATES; i++) {
+        const template_t *template = &_templates[i];
+        if (!mr_schedule_gen_build(&_schedule, _cells, MARI_N_CELLS_MAX, template->id, template->n_nodes, template->shared_uplink_percent, template->downlink_percent)) {
+            fprintf(stderr, "%s: does not fit in %d cells\n", template->name, MARI_N_CELLS_MAX);
+            return 1;
+        }
+        printf("\n");
+        if (template->wide && (i == 0 || !_templates[i - 1].wide)) {
+            printf("#if MARI_WIDE_SCHEDULES\n");
+        }
+        _print_schedule(template->name, &_schedule);
+        if (template->wide && i == N_TEMPLATES - 1) {
+            printf("#endif\n");
+        }
+    }
+    printf("// clang-format on\n");
+    return 0;
+}
+
+static int _custom(char **argv) {
+    uint8_t  id                    = strtoul(argv[1], NULL, 0);
+    uint16_t n_nodes               = strtoul(argv[2], NULL, 0);
+    uint8_t  shared_uplink_percent = strtoul(argv[3], NULL, 0);
+    uint8_t  downlink_percent      = strtoul(argv[4], NULL, 0);
+    if (!mr_schedule_gen_build(&_schedule, _cells, MARI_N_CELLS_MAX, id, n_nodes, shared_uplink_percent, downlink_percent)) {
+        fprintf(stderr, "does not fit in %d cells\n", MARI_N_CELLS_MAX);
+        return 1;
+    }
+    if (!mr_schedule_gen_check(&_schedule, NULL)) {
+        fprintf(stderr, "invalid schedule\n");
+        return 1;
+    }
+    _print_schedule("custom", &_schedule);
+    _print_report("custom", &_schedule);
+    return 0;
+}
+
+static void _print_report(const char *name, const schedule_t *schedule) {
+    mr_schedule_report_t report = { 0 };
+    mr_schedule_gen_check(schedule, &report);
+    fprintf(stderr, "%s: id %d, %zu cells (%dB %dU %dS %dD), backoff %d..%d\n", name, schedule->id, schedule->n_cells, report.n_beacon, report.n_uplink, report.n_shared_uplink, report.n_downlink, schedule->backoff_n_min, schedule->backoff_n_max);
+    fprintf(stderr, "    worst-case latency: uplink %d us, downlink %d us, join %d us, beacon %d us\n", report.uplink_latency_us, report.downlink_latency_us, report.join_latency_us, report.beacon_latency_us);
+}
+
+static void _print_schedule(const char *name, const schedule_t *schedule) {
+    printf("/* Schedule with %zu slots, supporting up to %d nodes */\n", schedule->n_cells, schedule->max_nodes);
+    printf("schedule_t schedule_%s = {\n", name);
+    printf("    .id = %d,\n", schedule->id);
+    printf("    .max_nodes = %d,\n", schedule->max_nodes);
+    printf("    .backoff_n_min = %d,\n", schedule->backoff_n_min);
+    printf("    .backoff_n_max = %d,\n", schedule->backoff_n_max);
+    printf("    .n_cells = %zu,\n", schedule->n_cells);
+    printf("    .cells = (cell_t[]){\n");
+    for (size_t i = 0; i < schedule->n_cells; i++) {
+        if (i == 0) {
+            printf("        // Begin with beacon cells. They use their own channel offsets and frequencies.\n");
+        } else if (i == MARI_N_BEACON_CELLS) {
+            printf("        // Continue with regular cells.\n");
+        }
+        printf("        {'%c', %d, 0, 0, 0}%s\n", schedule->cells[i].type, schedule->cells[i].channel_offset, i == schedule->n_cells - 1 ? "" : ",");
+    }
+    printf("    }\n");
+    printf("};\n");
+}
+
+static bool _same_schedule(const schedule_t *a, const schedule_t *b) {
+    if (a->id != b->id || a->max_nodes != b->max_nodes || a->backoff_n_min != b->backoff_n_min || a->backoff_n_max != b->backoff_n_max || a->n_cells != b->n_cells) {
+        return false;
+    }
+    for (size_t i = 0; i < a->n_cells; i++) {
+        if (a->cells[i].type != b->cells[i].type || a->cells[i].channel_offset != b->cells[i].channel_offset) {
+            return false;
+        }
+    }
+    return true;
+}
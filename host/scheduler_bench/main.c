@@ -0,0 +1,483 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Benchmark of the gateway per-node lookups, with up to 500 nodes
+ *
+ * Fills the huge (102 nodes) and wide (500 nodes) schedules, and measures the time taken by the operations
+ * that run in the radio interrupt for each node: joining, looking up a node when a frame arrives, and the
+ * per-slot scheduler work. A linear scan over the cells, as used before the lookup tables, is measured for reference.
+ * Also checks that the lookup tables and the beacon occupancy stay consistent while nodes come and go, that the
+ * link of a node that left is reported once then forgotten, that the links follow the nodes when the schedule
+ * changes, and that the beacons announce exactly the nodes with downlinks, so that a downlink queued after them
+ * goes out in the same slotframe when its node was announced.
+ * Last, plays the interrupts of every uplink slot of a full schedule_wide, and measures the end of frame radio isr
+ * and the bottom half that handles the frame, for a data frame from the node of the slot.
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "mari.h"
+#include "scheduler.h"
+#include "association.h"
+#include "occupancy.h"
+#include "packet.h"
+#include "queue.h"
+#include "link.h"
+#include "mac.h"
+#include "mr_device.h"
+#include "mr_radio.h"
+#include "mr_swi.h"
+#include "mr_timer_hf.h"
+
+//=========================== defines ==========================================
+
+#define BENCH_N_PASSES           100     // each measurement is repeated, and averaged, over this many passes
+#define BENCH_N_SLOTFRAMES       3       // slotframes ticked for the per-slot measurement
+#define BENCH_N_MISSES           10000   // lookups of nodes that are not joined
+#define BENCH_N_OCCUPANCY_PROBES 100000  // nodes that are not joined, checked against the occupancy of a joined node's cell
+#define BENCH_CHURN_PERCENT      25      // share of the nodes that leave and join again
+#define BENCH_N_PENDING_ORDINALS 33      // uplink cells whose nodes get downlinks, one more than a 32-bit field
+#define BENCH_N_ISR_SLOTFRAMES   200     // slotframes played for the radio isr measurement, each uplink slot keeps its fastest run
+
+//=========================== variables ========================================
+
+extern schedule_t schedule_big, schedule_huge, schedule_wide;
+
+// driver stand-ins, see stubs.c
+extern timer_hf_cb_t     host_timer_callbacks[];
+extern radio_ts_packet_t host_radio_start_frame;
+extern radio_ts_packet_t host_radio_end_frame;
+extern mr_swi_cb_t       host_swi_callback;
+void                     host_radio_receive(const uint8_t *packet, uint8_t length);
+
+static uint64_t          _node_ids[MARI_MAX_NODES];
+static uint64_t          _unknown_ids[BENCH_N_MISSES];
+static uint16_t          _ordinals[MARI_MAX_NODES];  // position of the cell of each node among the uplink cells
+static uint8_t           _tags[MARI_MAX_NODES];
+static uint64_t          _prng_state = 0x9E3779B97F4A7C15ULL;
+static int               _errors     = 0;
+static volatile uint32_t _sink;  // keeps the compiler from optimizing the measured loops away
+
+//=========================== prototypes =======================================
+
+static void     _bench_schedule(schedule_t *schedule);
+static void     _event_callback(mr_event_t event, mr_event_data_t event_data);
+static uint64_t _prng(void);
+static uint64_t _now_ns(void);
+static void     _timing_print(const char *name, uint64_t start_ns, uint32_t count);
+static int16_t  _linear_scan(const schedule_t *schedule, uint64_t node_id);
+static uint16_t _ordinal(const schedule_t *schedule, uint16_t cell_index);
+static void     _check(bool condition, const char *what);
+static void     _check_link_release(uint64_t node_id);
+static void     _check_link_migration(void);
+static void     _check_pending_downlinks(const uint64_t *by_ordinal, uint16_t n_cells);
+static uint8_t  _aggregated_ordinals(uint8_t *packet, uint8_t len, uint16_t *ordinals, uint8_t max);
+static void     _bench_radio_isr(void);
+
+//============================ main ============================================
+
+int main(void) {
+    // the whole stack, so that the radio, timer and bottom half callbacks are those of the mac
+    mari_init(MARI_GATEWAY, MARI_NET_ID_DEFAULT, &schedule_huge, _event_callback);
+
+    _bench_schedule(&schedule_huge);
+    _bench_schedule(&schedule_wide);
+    _check_link_migration();
+    _bench_radio_isr();
+
+    if (_errors) {
+        printf("%d checks failed\n", _errors);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+//=========================== private ==========================================
+
+static void _bench_schedule(schedule_t *schedule) {
+    _check(mr_scheduler_set_schedule(schedule->id), "schedule available");
+    uint16_t n_nodes = schedule->max_nodes;
+    printf("Schedule %d: %d nodes, %zu cells\n", schedule->id, n_nodes, schedule->n_cells);
+
+    // join: fill the schedule
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        _node_ids[i] = _prng();
+    }
+    uint64_t start = _now_ns();
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        _sink += mr_scheduler_gateway_assign_next_available_uplink_cell(_node_ids[i], 0);
+    }
+    _timing_print("join (assign cell)", start, n_nodes);
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        _check(_linear_scan(schedule, _node_ids[i]) >= 0, "node assigned");
+    }
+    _check(mr_scheduler_gateway_assign_next_available_uplink_cell(_prng(), 0) < 0, "full schedule rejects nodes");
+    _check(mr_scheduler_gateway_get_nodes_count() == n_nodes, "node count");
+
+    // a frame arrives: is the node joined, and keep it alive
+    start = _now_ns();
+    for (uint32_t pass = 0; pass < BENCH_N_PASSES; pass++) {
+        for (uint16_t i = 0; i < n_nodes; i++) {
+            _sink += mr_assoc_gateway_node_is_joined(_node_ids[i]) && mr_assoc_gateway_keep_node_alive(_node_ids[i], 1);
+        }
+    }
+    _timing_print("frame from a joined node", start, BENCH_N_PASSES * n_nodes);
+
+    start = _now_ns();
+    for (uint32_t pass = 0; pass < BENCH_N_PASSES; pass++) {
+        for (uint16_t i = 0; i < n_nodes; i++) {
+            _sink += _linear_scan(schedule, _node_ids[i]);
+        }
+    }
+    _timing_print("  linear scan, for reference", start, BENCH_N_PASSES * n_nodes);
+
+    for (uint32_t i = 0; i < BENCH_N_MISSES; i++) {
+        _unknown_ids[i] = _prng();
+    }
+    start = _now_ns();
+    for (uint32_t i = 0; i < BENCH_N_MISSES; i++) {
+        _sink += mr_assoc_gateway_node_is_joined(_unknown_ids[i]);
+    }
+    _timing_print("frame from an unknown node", start, BENCH_N_MISSES);
+    for (uint32_t i = 0; i < BENCH_N_MISSES; i++) {
+        _check(!mr_assoc_gateway_node_is_joined(_unknown_ids[i]), "unknown node not found");
+    }
+
+    // per-slot work at the gateway: timeout check and scheduler tick
+    start = _now_ns();
+    for (uint64_t asn = 0; asn < BENCH_N_SLOTFRAMES * schedule->n_cells; asn++) {
+        mr_assoc_gateway_clear_old_nodes(asn);
+        _sink += mr_scheduler_tick(asn).channel;
+    }
+    _timing_print("slot (timeouts and tick)", start, BENCH_N_SLOTFRAMES * schedule->n_cells);
+    _check(mr_scheduler_gateway_get_nodes_count() == n_nodes, "no node timed out");
+
+    // churn: some nodes leave, others join, and the lookups must stay consistent
+    uint16_t n_churn = n_nodes * BENCH_CHURN_PERCENT / 100;
+    for (uint16_t i = 0; i < n_churn; i++) {
+        uint16_t victim  = _prng() % n_nodes;
+        int16_t  cell_id = mr_scheduler_gateway_get_node_cell(_node_ids[victim]);
+        mr_scheduler_gateway_release_cell(cell_id);
+        _check(!mr_assoc_gateway_node_is_joined(_node_ids[victim]), "released node not found");
+        _node_ids[victim] = _prng();
+        _check(mr_scheduler_gateway_assign_next_available_uplink_cell(_node_ids[victim], 0) == cell_id, "freed cell re-used");
+    }
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        _check(mr_scheduler_gateway_get_node_cell(_node_ids[i]) == _linear_scan(schedule, _node_ids[i]), "lookup matches the cells after churn");
+    }
+    _check_link_release(_node_ids[0]);
+
+    // occupancy: every joined node must be found at its ordinal, in its segment
+    start = _now_ns();
+    mr_occupancy_gateway_compute();
+    uint64_t occupancy_ns = _now_ns() - start;
+
+    uint8_t segments[MARI_OCCUPANCY_MAX_SEGMENTS][MARI_OCCUPANCY_MAX_LEN];
+    uint8_t lengths[MARI_OCCUPANCY_MAX_SEGMENTS];
+    uint8_t n_segments = 1;
+    uint8_t max_length = 0;
+    for (uint8_t i = 0; i < n_segments; i++) {
+        uint8_t occupancy[MARI_OCCUPANCY_MAX_LEN];
+        uint8_t length = mr_occupancy_gateway_copy(occupancy);
+        n_segments     = occupancy[1];
+        memcpy(segments[occupancy[0]], occupancy, length);
+        lengths[occupancy[0]] = length;
+        if (length > max_length) {
+            max_length = length;
+        }
+    }
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        _ordinals[i] = _ordinal(schedule, mr_scheduler_gateway_get_node_cell(_node_ids[i]));
+        _tags[i]     = mr_occupancy_tag(_node_ids[i]);
+    }
+    start = _now_ns();
+    for (uint32_t pass = 0; pass < BENCH_N_PASSES; pass++) {
+        for (uint16_t i = 0; i < n_nodes; i++) {
+            uint8_t segment = _ordinals[i] / MARI_OCCUPANCY_SEGMENT_CELLS;
+            _sink += mr_occupancy_node_contains(_ordinals[i], _tags[i], segments[segment], lengths[segment]);
+        }
+    }
+    _timing_print("beacon check at a node", start, BENCH_N_PASSES * n_nodes);
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        uint8_t segment = _ordinals[i] / MARI_OCCUPANCY_SEGMENT_CELLS;
+        _check(mr_occupancy_node_contains(_ordinals[i], _tags[i], segments[segment], lengths[segment]), "joined node in the occupancy");
+    }
+
+    // a node that was dropped, and whose cell was given to another node, is only kept by a tag collision
+    uint32_t false_positives = 0;
+    for (uint32_t i = 0; i < BENCH_N_OCCUPANCY_PROBES; i++) {
+        uint16_t victim  = i % n_nodes;
+        uint8_t  segment = _ordinals[victim] / MARI_OCCUPANCY_SEGMENT_CELLS;
+        false_positives += mr_occupancy_node_contains(_ordinals[victim], mr_occupancy_tag(_prng()), segments[segment], lengths[segment]);
+    }
+    printf("    %-30s %8.1f ns, %d segment(s), up to %d bytes per beacon, %.2f%% false positives\n", "occupancy", (double)occupancy_ns, n_segments, max_length, 100.0 * false_positives / BENCH_N_OCCUPANCY_PROBES);
+
+    // downlinks for the nodes of the first uplink cells
+    uint64_t by_ordinal[BENCH_N_PENDING_ORDINALS] = { 0 };
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        if (_ordinals[i] < BENCH_N_PENDING_ORDINALS) {
+            by_ordinal[_ordinals[i]] = _node_ids[i];
+        }
+    }
+    _check_pending_downlinks(by_ordinal, schedule->n_cells);
+
+    // leave the schedule empty for the next run
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        mr_scheduler_gateway_release_cell(mr_scheduler_gateway_get_node_cell(_node_ids[i]));
+    }
+    _check(mr_scheduler_gateway_get_nodes_count() == 0, "all nodes released");
+}
+
+static void _event_callback(mr_event_t event, mr_event_data_t event_data) {
+    (void)event;
+    (void)event_data;
+}
+
+static uint64_t _prng(void) {
+    // xorshift64
+    _prng_state ^= _prng_state << 13;
+    _prng_state ^= _prng_state >> 7;
+    _prng_state ^= _prng_state << 17;
+    return _prng_state;
+}
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _timing_print(const char *name, uint64_t start_ns, uint32_t count) {
+    printf("    %-30s %8.1f ns\n", name, (double)(_now_ns() - start_ns) / count);
+}
+
+static int16_t _linear_scan(const schedule_t *schedule, uint64_t node_id) {
+    for (size_t i = 0; i < schedule->n_cells; i++) {
+        if (schedule->cells[i].type == SLOT_TYPE_UPLINK && schedule->cells[i].assigned_node_id == node_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// position of an uplink cell among the uplink cells of the schedule
+static uint16_t _ordinal(const schedule_t *schedule, uint16_t cell_index) {
+    uint16_t ordinal = 0;
+    for (uint16_t i = 0; i < cell_index; i++) {
+        ordinal += schedule->cells[i].type == SLOT_TYPE_UPLINK;
+    }
+    return ordinal;
+}
+
+static void _check(bool condition, const char *what) {
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        _errors++;
+    }
+}
+
+// the node leaves its cell and joins again
+static void _check_link_release(uint64_t node_id) {
+    int16_t         cell_id = mr_scheduler_gateway_get_node_cell(node_id);
+    mr_link_delta_t deltas[MARI_LINK_DELTAS_PER_FRAME];
+    uint8_t         count;
+
+    mr_link_gateway_init();
+    mr_link_gateway_register_rx(cell_id, node_id, -60, 1);
+    count = mr_link_gateway_get_deltas(deltas, MARI_LINK_DELTAS_PER_FRAME);
+    _check(count == 1 && deltas[0].node_id == node_id && deltas[0].pdr == 100, "link of a joined node reported");
+
+    mr_scheduler_gateway_release_cell(cell_id);
+    count = mr_link_gateway_get_deltas(deltas, MARI_LINK_DELTAS_PER_FRAME);
+    _check(count == 1 && deltas[0].node_id == node_id && deltas[0].cell_id == cell_id && deltas[0].pdr == MARI_LINK_PDR_NODE_LEFT, "node that left reported");
+    _check(mr_link_gateway_get_deltas(deltas, MARI_LINK_DELTAS_PER_FRAME) == 0, "link of the node that left forgotten");
+
+    _check(mr_scheduler_gateway_assign_next_available_uplink_cell(node_id, 0) == cell_id, "node joins again");
+}
+
+// the gateway shrinks to a smaller schedule, then grows back, each node must keep its link history
+static void _check_link_migration(void) {
+    const uint8_t   schedule_ids[2] = { schedule_big.id, schedule_huge.id };
+    const uint16_t  n_nodes         = 40;
+    mr_link_delta_t deltas[MARI_LINK_DELTAS_PER_FRAME];
+    uint8_t         count;
+
+    _check(mr_scheduler_set_schedule(schedule_huge.id), "schedule available");
+    mr_link_gateway_init();
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        _node_ids[i] = _prng();
+        mr_link_gateway_register_rx(mr_scheduler_gateway_assign_next_available_uplink_cell(_node_ids[i], 0), _node_ids[i], -60, 1);
+    }
+    while (mr_link_gateway_get_deltas(deltas, MARI_LINK_DELTAS_PER_FRAME) > 0) {}
+
+    for (size_t s = 0; s < 2; s++) {
+        // switch in the middle of a slotframe, away from the migration planning
+        _check(mr_scheduler_set_next_schedule(schedule_ids[s], s + 1), "next schedule available");
+        mr_scheduler_tick(s + 1);
+        for (uint16_t i = 0; i < n_nodes; i++) {
+            mr_link_gateway_register_miss(mr_scheduler_gateway_get_node_cell(_node_ids[i]), _node_ids[i]);
+        }
+
+        // one frame, then one miss per schedule since
+        uint8_t  expected_pdr = 100 / (s + 2);
+        uint16_t n_reported   = 0;
+        bool     consistent   = true;
+        while ((count = mr_link_gateway_get_deltas(deltas, MARI_LINK_DELTAS_PER_FRAME)) > 0) {
+            for (uint8_t i = 0; i < count; i++) {
+                consistent &= deltas[i].cell_id == mr_scheduler_gateway_get_node_cell(deltas[i].node_id) && deltas[i].pdr == expected_pdr;
+            }
+            n_reported += count;
+        }
+        _check(consistent && n_reported == n_nodes, "links follow the nodes to the next schedule");
+    }
+
+    for (uint16_t i = 0; i < n_nodes; i++) {
+        mr_scheduler_gateway_release_cell(mr_scheduler_gateway_get_node_cell(_node_ids[i]));
+    }
+    while (mr_link_gateway_get_deltas(deltas, MARI_LINK_DELTAS_PER_FRAME) > 0) {}
+}
+
+// nodes 0 and 2 have downlinks when the beacon is sent, node 1 gets one right after, with a higher priority,
+// node 32, that would share a bit with node 0 in a 32-bit field, too, then node 0 gets another one
+static void _check_pending_downlinks(const uint64_t *by_ordinal, uint16_t n_cells) {
+    uint8_t payload[4] = { 1, 2, 3, 4 };
+    uint8_t packet[MARI_PACKET_MAX_SIZE];
+    uint8_t len;
+
+    mr_queue_init();
+    len = mr_build_packet_data(packet, by_ordinal[0], payload, sizeof(payload));
+    mr_queue_add(packet, len);
+    len = mr_build_packet_data(packet, by_ordinal[2], payload, sizeof(payload));
+    mr_queue_add(packet, len);
+
+    mr_scheduler_tick(0);
+    mr_queue_next_packet(SLOT_TYPE_BEACON, packet);
+    mr_beacon_packet_header_t *beacon = (mr_beacon_packet_header_t *)packet;
+    _check(beacon->downlink_pending_len == 1 && beacon->payload[0] == ((1 << 0) | (1 << 2)), "beacon announces the queued downlinks");
+
+    len = mr_build_packet_data(packet, by_ordinal[1], payload, sizeof(payload));
+    mr_queue_add_with_priority(packet, len, MARI_PRIORITY_HIGH, 0);
+    len = mr_build_packet_data(packet, by_ordinal[32], payload, sizeof(payload));
+    mr_queue_add(packet, len);
+
+    // the announced downlinks go out together, past the ones queued after the beacon
+    len = mr_queue_next_packet(SLOT_TYPE_DOWNLINK, packet);
+    _check(len > 0 && ((mr_packet_header_t *)packet)->type == MARI_PACKET_DATA_AGGREGATED, "announced downlinks sent past a late one");
+    uint16_t ordinals[2] = { 0 };
+    _check(_aggregated_ordinals(packet, len, ordinals, 2) == 2 && ordinals[0] == 0 && ordinals[1] == 2, "announced downlinks packed in queue order");
+
+    len = mr_build_packet_data(packet, by_ordinal[0], payload, sizeof(payload));
+    mr_queue_add(packet, len);
+    len = mr_queue_next_packet(SLOT_TYPE_DOWNLINK, packet);
+    _check(len > 0 && _aggregated_ordinals(packet, len, ordinals, 2) == 1 && ordinals[0] == 0, "late downlink of an announced node sent in the same slotframe");
+    _check(mr_queue_next_packet(SLOT_TYPE_DOWNLINK, packet) == 0, "late downlinks of the other nodes held until the next beacons");
+
+    mr_scheduler_tick(n_cells);
+    mr_queue_next_packet(SLOT_TYPE_BEACON, packet);
+    _check(beacon->downlink_pending_len == 5 && beacon->payload[0] == (1 << 1) && beacon->payload[1] == 0 && beacon->payload[4] == (1 << 0), "next beacon announces the late downlinks");
+    len = mr_queue_next_packet(SLOT_TYPE_DOWNLINK, packet);
+    _check(len > 0 && _aggregated_ordinals(packet, len, ordinals, 2) == 2 && ordinals[0] == 1 && ordinals[1] == 32, "late downlinks sent in the next slotframe");
+}
+
+// ordinals of the destinations of a downlink frame, aggregated or not. returns how many there are
+static uint8_t _aggregated_ordinals(uint8_t *packet, uint8_t len, uint16_t *ordinals, uint8_t max) {
+    if (((mr_packet_header_t *)packet)->type != MARI_PACKET_DATA_AGGREGATED) {
+        ordinals[0] = mr_scheduler_gateway_get_node_ordinal(((mr_packet_header_t *)packet)->dst);
+        return 1;
+    }
+    size_t   offset    = 0;
+    uint16_t ordinal   = 0;
+    uint8_t  n_records = 0;
+    uint8_t  record_len;
+    while (mr_packet_aggregated_next_record(packet, len, &offset, &ordinal, &record_len) != NULL) {
+        if (n_records < max) {
+            ordinals[n_records] = ordinal;
+        }
+        n_records++;
+    }
+    return n_records;
+}
+
+// each uplink slot of a full schedule_wide receives a data frame from its node. a full schedule, and the biggest one,
+// so that the gateway does not migrate to another one meanwhile
+static void _bench_radio_isr(void) {
+    static uint64_t isr_ns[MARI_N_CELLS_MAX];
+    static uint64_t bottom_half_ns[MARI_N_CELLS_MAX];
+    uint8_t         payload[20] = { 0 };
+    uint8_t         packet[MARI_PACKET_MAX_SIZE];
+
+    _check(mr_scheduler_set_schedule(schedule_wide.id), "schedule available");
+    schedule_t *schedule = mr_scheduler_get_active_schedule_ptr();
+    for (uint16_t i = 0; i < schedule->max_nodes; i++) {
+        _check(mr_scheduler_gateway_assign_next_available_uplink_cell(_prng(), 0) >= 0, "node joins for the isr measurement");
+    }
+    for (size_t i = 0; i < schedule->n_cells; i++) {
+        isr_ns[i]         = UINT64_MAX;
+        bottom_half_ns[i] = UINT64_MAX;
+    }
+
+    for (uint32_t slotframe = 0; slotframe < BENCH_N_ISR_SLOTFRAMES; slotframe++) {
+        for (size_t slot = 0; slot < schedule->n_cells; slot++) {
+            host_timer_callbacks[MARI_TIMER_INTER_SLOT_CHANNEL]();
+            uint16_t cell_index = mr_scheduler_get_current_cell_index();
+            uint64_t node_id    = schedule->cells[cell_index].assigned_node_id;
+            if (schedule->cells[cell_index].type != SLOT_TYPE_UPLINK || node_id == 0) {
+                continue;
+            }
+            host_timer_callbacks[MARI_TIMER_CHANNEL_1]();  // the radio starts listening
+            host_radio_start_frame(0);
+            uint8_t len                         = mr_build_packet_data(packet, mr_device_id(), payload, sizeof(payload));
+            ((mr_packet_header_t *)packet)->src = node_id;
+            host_radio_receive(packet, len);
+
+            uint64_t start = _now_ns();
+            host_radio_end_frame(0);
+            uint64_t isr = _now_ns() - start;
+            start        = _now_ns();
+            host_swi_callback();
+            uint64_t bottom_half = _now_ns() - start;
+
+            isr_ns[cell_index]         = isr < isr_ns[cell_index] ? isr : isr_ns[cell_index];
+            bottom_half_ns[cell_index] = bottom_half < bottom_half_ns[cell_index] ? bottom_half : bottom_half_ns[cell_index];
+        }
+    }
+
+    // reading the clock twice costs about as much as the isr on a computer, it is taken out of the measurements
+    uint64_t clock_ns = UINT64_MAX;
+    for (uint32_t i = 0; i < BENCH_N_PASSES * BENCH_N_PASSES; i++) {
+        uint64_t start   = _now_ns();
+        uint64_t elapsed = _now_ns() - start;
+        clock_ns         = elapsed < clock_ns ? elapsed : clock_ns;
+    }
+
+    // the noise of the computer is filtered out by keeping the fastest run of each slot
+    uint64_t isr_worst = 0, bottom_half_worst = 0, isr_sum = 0, bottom_half_sum = 0;
+    uint16_t n_slots = 0;
+    for (size_t i = 0; i < schedule->n_cells; i++) {
+        if (isr_ns[i] == UINT64_MAX) {
+            continue;
+        }
+        isr_worst         = isr_ns[i] > isr_worst ? isr_ns[i] : isr_worst;
+        bottom_half_worst = bottom_half_ns[i] > bottom_half_worst ? bottom_half_ns[i] : bottom_half_worst;
+        isr_sum += isr_ns[i];
+        bottom_half_sum += bottom_half_ns[i];
+        n_slots++;
+    }
+    _check(n_slots == schedule->max_nodes, "uplink frames received");
+    _check(mr_scheduler_gateway_get_nodes_count() == schedule->max_nodes, "nodes kept alive by their frames");
+    mr_link_delta_t deltas[MARI_LINK_DELTAS_PER_FRAME];
+    uint8_t         count = mr_link_gateway_get_deltas(deltas, MARI_LINK_DELTAS_PER_FRAME);
+    _check(count > 0 && deltas[0].pdr == 100, "frames counted in the links by the bottom half");
+    printf("schedule_wide, %d nodes, uplink data frames, without the %d ns of the clock reads\n", schedule->max_nodes, (int)clock_ns);
+    printf("    %-30s %8.1f ns, %5.1f ns in the worst slot\n", "end of frame radio isr", (double)isr_sum / n_slots - clock_ns, (double)(isr_worst - clock_ns));
+    printf("    %-30s %8.1f ns, %5.1f ns in the worst slot\n", "rx bottom half", (double)bottom_half_sum / n_slots - clock_ns, (double)(bottom_half_worst - clock_ns));
+}
@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @ingroup     host
+ *
+ * @brief       Stand-ins for the drivers used by the mari sources
+ *
+ * The callbacks given to the timer, radio and software interrupt drivers are kept, so that a benchmark can play
+ * the interrupts of a slot in order, and a received frame can be put in the buffer the radio was given.
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nrf.h>
+#include "mr_timer_hf.h"
+#include "mr_radio.h"
+#include "mr_rng.h"
+#include "mr_gpio.h"
+#include "mr_swi.h"
+
+//=========================== defines ==========================================
+
+#define HOST_TIMER_N_CHANNELS 4
+
+//=========================== variables ========================================
+
+NRF_FICR_Type host_ficr = { .DEVICEID = { 0x1234, 0x5678 } };
+NRF_GPIO_Type host_p0, host_p1;
+
+timer_hf_cb_t     host_timer_callbacks[HOST_TIMER_N_CHANNELS];  // last callback set on each channel, NULL once cancelled
+radio_ts_packet_t host_radio_start_frame;
+radio_ts_packet_t host_radio_end_frame;
+mr_swi_cb_t       host_swi_callback;
+
+static uint8_t  _radio_pdu[MR_RADIO_PDU_HEADER_LENGTH + UINT8_MAX];  // internal buffer of the radio
+static uint8_t *_radio_rx_pdu = _radio_pdu;
+static bool     _radio_pending_rx_read;
+
+//=========================== prototypes =======================================
+
+static void _timer_set(uint8_t channel, timer_hf_cb_t cb);
+
+//=========================== public ===========================================
+
+void mr_timer_hf_init(timer_hf_t timer) {
+    (void)timer;
+}
+
+uint32_t mr_timer_hf_now(timer_hf_t timer) {
+    (void)timer;
+    return 0;
+}
+
+void mr_timer_hf_set_periodic_us(timer_hf_t timer, uint8_t channel, uint32_t us, timer_hf_cb_t cb) {
+    (void)timer;
+    (void)us;
+    _timer_set(channel, cb);
+}
+
+void mr_timer_hf_adjust_periodic_us(timer_hf_t timer, uint8_t channel, int32_t us) {
+    (void)timer;
+    (void)channel;
+    (void)us;
+}
+
+void mr_timer_hf_set_oneshot_us(timer_hf_t timer, uint8_t channel, uint32_t us, timer_hf_cb_t cb) {
+    (void)timer;
+    (void)us;
+    _timer_set(channel, cb);
+}
+
+void mr_timer_hf_set_oneshot_with_ref_us(timer_hf_t timer, uint8_t channel, uint32_t base_us, uint32_t us, timer_hf_cb_t cb) {
+    (void)timer;
+    (void)base_us;
+    (void)us;
+    _timer_set(channel, cb);
+}
+
+void mr_timer_hf_set_oneshot_with_ref_diff_us(timer_hf_t timer, uint8_t channel, uint32_t base_us, uint32_t us, timer_hf_cb_t cb) {
+    (void)timer;
+    (void)base_us;
+    (void)us;
+    _timer_set(channel, cb);
+}
+
+void mr_timer_hf_delay_us(timer_hf_t timer, uint32_t us) {
+    (void)timer;
+    (void)us;
+}
+
+void mr_timer_hf_cancel(timer_hf_t timer, uint8_t channel) {
+    (void)timer;
+    _timer_set(channel, NULL);
+}
+
+void mr_radio_init(radio_ts_packet_t start_pac_cb, radio_ts_packet_t end_pac_cb, mr_radio_mode_t mode) {
+    (void)mode;
+    host_radio_start_frame = start_pac_cb;
+    host_radio_end_frame   = end_pac_cb;
+}
+
+void mr_radio_set_channel(uint8_t channel) {
+    (void)channel;
+}
+
+void mr_radio_rx(void) {}
+
+int8_t mr_radio_rssi(void) {
+    return -50;
+}
+
+void mr_radio_disable(void) {}
+
+bool mr_radio_pending_rx_read(void) {
+    return _radio_pending_rx_read;
+}
+
+void mr_radio_get_rx_packet(uint8_t *packet, uint8_t *length) {
+    (void)packet;
+    *length = 0;
+}
+
+void mr_radio_set_rx_buffer(uint8_t *pdu) {
+    _radio_rx_pdu = pdu ? pdu : _radio_pdu;
+}
+
+uint8_t *mr_radio_get_rx_packet_ptr(uint8_t *length) {
+    *length                = _radio_rx_pdu[1];
+    _radio_pending_rx_read = false;
+    return &_radio_rx_pdu[MR_RADIO_PDU_HEADER_LENGTH];
+}
+
+uint32_t mr_radio_get_crc_errors(void) {
+    return 0;
+}
+
+void mr_radio_tx_prepare(const uint8_t *buffer, uint8_t length) {
+    (void)buffer;
+    (void)length;
+}
+
+void mr_radio_tx_dispatch(void) {}
+
+void mr_rng_init(void) {}
+
+void mr_rng_read_u8(uint8_t *value) {
+    *value = rand();
+}
+
+void mr_rng_read_u8_fast(uint8_t *value) {
+    *value = rand();
+}
+
+void mr_rng_read_u16(uint16_t *value) {
+    *value = rand();
+}
+
+void mr_gpio_init(const mr_gpio_t *gpio, mr_gpio_mode_t mode) {
+    (void)gpio;
+    (void)mode;
+}
+
+void mr_gpio_set(const mr_gpio_t *gpio) {
+    (void)gpio;
+}
+
+void mr_gpio_clear(const mr_gpio_t *gpio) {
+    (void)gpio;
+}
+
+void mr_gpio_toggle(const mr_gpio_t *gpio) {
+    (void)gpio;
+}
+
+void mr_swi_init(mr_swi_cb_t callback) {
+    host_swi_callback = callback;
+}
+
+void mr_swi_trigger(void) {}
+
+// puts a frame in the buffer the radio receives in, as if it had just been received
+void host_radio_receive(const uint8_t *packet, uint8_t length) {
+    _radio_rx_pdu[1] = length;
+    memcpy(&_radio_rx_pdu[MR_RADIO_PDU_HEADER_LENGTH], packet, length);
+    _radio_pending_rx_read = true;
+}
+
+//=========================== private ==========================================
+
+static void _timer_set(uint8_t channel, timer_hf_cb_t cb) {
+    if (channel < HOST_TIMER_N_CHANNELS) {
+        host_timer_callbacks[channel] = cb;
+    }
+}
@@ -4,6 +4,8 @@
  *
  * @brief       Fixed schedules
  *
+ * Generated by host/schedule_gen ('make emit'), do not edit by hand.
+ *
  * @author Anonymous Anon <anonymous.anon@anon.org>
  *
  * @copyright Anon, 2024
@@ -12,8 +14,13 @@
 
 // account for:
 // - the 4 schedules supporting up to 10, 44, 66 and 102 nodes
+// - with MARI_WIDE_SCHEDULES, 1 more supporting up to 500 nodes
 // - the schedule that can be passed by the application during initialization
+#if MARI_WIDE_SCHEDULES
+#define MARI_N_SCHEDULES 5 + 1
+#else
 #define MARI_N_SCHEDULES 4 + 1
+#endif
 
 // clang-format off
 /* Schedule used for tests only. Commented out by default. */
@@ -23,9 +30,9 @@
 //     .backoff_n_min = 5,
 //     .backoff_n_max = 9,
 //     .n_cells       = 1,
-//     .cells         = {
+//     .cells         = (cell_t[]){
 //         // the channel offset doesn't matter here
-//         { 'U', 0, 0, 0, 0, 0 },
+//         { 'U', 0, 0, 0, 0 },
 //     }
 // };
 
@@ -33,29 +40,29 @@
 schedule_t schedule_tiny = {
     .id = 6,
     .max_nodes = 10,
-    .backoff_n_min = 5,
-    .backoff_n_max = 9,
+    .backoff_n_min = 4,
+    .backoff_n_max = 5,
     .n_cells = 17,
-    .cells = {
+    .cells = (cell_t[]){
         // Begin with beacon cells. They use their own channel offsets and frequencies.
-        {'B', 0, 0, 0, 0, 0},
-        {'B', 1, 0, 0, 0, 0},
-        {'B', 2, 0, 0, 0, 0},
+        {'B', 0, 0, 0, 0},
+        {'B', 1, 0, 0, 0},
+        {'B', 2, 0, 0, 0},
         // Continue with regular cells.
-        {'U', 0, 0, 0, 0, 0},
-        {'U', 9, 0, 0, 0, 0},
-        {'S', 5, 0, 0, 0, 0},
-        {'D', 3, 0, 0, 0, 0},
-        {'U', 10, 0, 0, 0, 0},
-        {'U', 8, 0, 0, 0, 0},
-        {'U', 1, 0, 0, 0, 0},
-        {'U', 12, 0, 0, 0, 0},
-        {'S', 11, 0, 0, 0, 0},
-        {'D', 2, 0, 0, 0, 0},
-        {'U', 7, 0, 0, 0, 0},
-        {'U', 4, 0, 0, 0, 0},
-        {'U', 13, 0, 0, 0, 0},
-        {'U', 6, 0, 0, 0, 0}
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'S', 6, 0, 0, 0},
+        {'D', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0}
     }
 };
 
@@ -63,79 +70,79 @@ schedule_t schedule_tiny = {
 schedule_t schedule_medium = {
     .id = 4,
     .max_nodes = 44,
-    .backoff_n_min = 5,
-    .backoff_n_max = 9,
+    .backoff_n_min = 4,
+    .backoff_n_max = 7,
     .n_cells = 67,
-    .cells = {
+    .cells = (cell_t[]){
         // Begin with beacon cells. They use their own channel offsets and frequencies.
-        {'B', 0, 0, 0, 0, 0},
-        {'B', 1, 0, 0, 0, 0},
-        {'B', 2, 0, 0, 0, 0},
+        {'B', 0, 0, 0, 0},
+        {'B', 1, 0, 0, 0},
+        {'B', 2, 0, 0, 0},
         // Continue with regular cells.
-        {'U', 14, 0, 0, 0, 0},
-        {'U', 53, 0, 0, 0, 0},
-        {'S', 59, 0, 0, 0, 0},
-        {'D', 30, 0, 0, 0, 0},
-        {'U', 27, 0, 0, 0, 0},
-        {'U', 11, 0, 0, 0, 0},
-        {'U', 1, 0, 0, 0, 0},
-        {'U', 34, 0, 0, 0, 0},
-        {'S', 43, 0, 0, 0, 0},
-        {'D', 6, 0, 0, 0, 0},
-        {'U', 16, 0, 0, 0, 0},
-        {'U', 63, 0, 0, 0, 0},
-        {'U', 8, 0, 0, 0, 0},
-        {'U', 42, 0, 0, 0, 0},
-        {'S', 54, 0, 0, 0, 0},
-        {'D', 50, 0, 0, 0, 0},
-        {'U', 62, 0, 0, 0, 0},
-        {'U', 36, 0, 0, 0, 0},
-        {'U', 9, 0, 0, 0, 0},
-        {'U', 48, 0, 0, 0, 0},
-        {'S', 0, 0, 0, 0, 0},
-        {'D', 24, 0, 0, 0, 0},
-        {'U', 17, 0, 0, 0, 0},
-        {'U', 60, 0, 0, 0, 0},
-        {'U', 45, 0, 0, 0, 0},
-        {'U', 57, 0, 0, 0, 0},
-        {'S', 25, 0, 0, 0, 0},
-        {'D', 61, 0, 0, 0, 0},
-        {'U', 10, 0, 0, 0, 0},
-        {'U', 15, 0, 0, 0, 0},
-        {'U', 40, 0, 0, 0, 0},
-        {'U', 21, 0, 0, 0, 0},
-        {'S', 39, 0, 0, 0, 0},
-        {'D', 49, 0, 0, 0, 0},
-        {'U', 47, 0, 0, 0, 0},
-        {'U', 22, 0, 0, 0, 0},
-        {'U', 38, 0, 0, 0, 0},
-        {'U', 44, 0, 0, 0, 0},
-        {'S', 28, 0, 0, 0, 0},
-        {'D', 33, 0, 0, 0, 0},
-        {'U', 35, 0, 0, 0, 0},
-        {'U', 31, 0, 0, 0, 0},
-        {'U', 20, 0, 0, 0, 0},
-        {'U', 29, 0, 0, 0, 0},
-        {'S', 7, 0, 0, 0, 0},
-        {'D', 3, 0, 0, 0, 0},
-        {'U', 18, 0, 0, 0, 0},
-        {'U', 5, 0, 0, 0, 0},
-        {'U', 19, 0, 0, 0, 0},
-        {'U', 58, 0, 0, 0, 0},
-        {'S', 37, 0, 0, 0, 0},
-        {'D', 32, 0, 0, 0, 0},
-        {'U', 13, 0, 0, 0, 0},
-        {'U', 2, 0, 0, 0, 0},
-        {'U', 52, 0, 0, 0, 0},
-        {'U', 4, 0, 0, 0, 0},
-        {'S', 41, 0, 0, 0, 0},
-        {'D', 12, 0, 0, 0, 0},
-        {'U', 56, 0, 0, 0, 0},
-        {'U', 46, 0, 0, 0, 0},
-        {'U', 55, 0, 0, 0, 0},
-        {'U', 51, 0, 0, 0, 0},
-        {'U', 23, 0, 0, 0, 0},
-        {'U', 26, 0, 0, 0, 0}
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'S', 6, 0, 0, 0},
+        {'D', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'S', 10, 0, 0, 0},
+        {'D', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'S', 14, 0, 0, 0},
+        {'D', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'S', 31, 0, 0, 0},
+        {'D', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'S', 35, 0, 0, 0},
+        {'D', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'S', 15, 0, 0, 0},
+        {'D', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'S', 19, 0, 0, 0},
+        {'D', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'S', 23, 0, 0, 0},
+        {'D', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'S', 3, 0, 0, 0},
+        {'D', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0}
     }
 };
 
@@ -143,113 +150,113 @@ schedule_t schedule_medium = {
 schedule_t schedule_big = {
     .id = 3,
     .max_nodes = 66,
-    .backoff_n_min = 5,
-    .backoff_n_max = 9,
+    .backoff_n_min = 4,
+    .backoff_n_max = 8,
     .n_cells = 101,
-    .cells = {
+    .cells = (cell_t[]){
         // Begin with beacon cells. They use their own channel offsets and frequencies.
-        {'B', 0, 0, 0, 0, 0},
-        {'B', 1, 0, 0, 0, 0},
-        {'B', 2, 0, 0, 0, 0},
+        {'B', 0, 0, 0, 0},
+        {'B', 1, 0, 0, 0},
+        {'B', 2, 0, 0, 0},
         // Continue with regular cells.
-        {'U', 23, 0, 0, 0, 0},
-        {'U', 35, 0, 0, 0, 0},
-        {'S', 44, 0, 0, 0, 0},
-        {'D', 55, 0, 0, 0, 0},
-        {'U', 46, 0, 0, 0, 0},
-        {'U', 2, 0, 0, 0, 0},
-        {'U', 36, 0, 0, 0, 0},
-        {'U', 75, 0, 0, 0, 0},
-        {'S', 90, 0, 0, 0, 0},
-        {'D', 88, 0, 0, 0, 0},
-        {'U', 66, 0, 0, 0, 0},
-        {'U', 70, 0, 0, 0, 0},
-        {'U', 12, 0, 0, 0, 0},
-        {'U', 11, 0, 0, 0, 0},
-        {'S', 32, 0, 0, 0, 0},
-        {'D', 80, 0, 0, 0, 0},
-        {'U', 24, 0, 0, 0, 0},
-        {'U', 67, 0, 0, 0, 0},
-        {'U', 77, 0, 0, 0, 0},
-        {'U', 94, 0, 0, 0, 0},
-        {'S', 95, 0, 0, 0, 0},
-        {'D', 14, 0, 0, 0, 0},
-        {'U', 93, 0, 0, 0, 0},
-        {'U', 82, 0, 0, 0, 0},
-        {'U', 1, 0, 0, 0, 0},
-        {'U', 37, 0, 0, 0, 0},
-        {'S', 57, 0, 0, 0, 0},
-        {'D', 49, 0, 0, 0, 0},
-        {'U', 34, 0, 0, 0, 0},
-        {'U', 26, 0, 0, 0, 0},
-        {'U', 71, 0, 0, 0, 0},
-        {'U', 5, 0, 0, 0, 0},
-        {'S', 13, 0, 0, 0, 0},
-        {'D', 33, 0, 0, 0, 0},
-        {'U', 17, 0, 0, 0, 0},
-        {'U', 41, 0, 0, 0, 0},
-        {'U', 42, 0, 0, 0, 0},
-        {'U', 30, 0, 0, 0, 0},
-        {'S', 64, 0, 0, 0, 0},
-        {'D', 73, 0, 0, 0, 0},
-        {'U', 8, 0, 0, 0, 0},
-        {'U', 85, 0, 0, 0, 0},
-        {'U', 40, 0, 0, 0, 0},
-        {'U', 91, 0, 0, 0, 0},
-        {'S', 7, 0, 0, 0, 0},
-        {'D', 56, 0, 0, 0, 0},
-        {'U', 10, 0, 0, 0, 0},
-        {'U', 19, 0, 0, 0, 0},
-        {'U', 53, 0, 0, 0, 0},
-        {'U', 22, 0, 0, 0, 0},
-        {'S', 52, 0, 0, 0, 0},
-        {'D', 47, 0, 0, 0, 0},
-        {'U', 6, 0, 0, 0, 0},
-        {'U', 25, 0, 0, 0, 0},
-        {'U', 81, 0, 0, 0, 0},
-        {'U', 97, 0, 0, 0, 0},
-        {'S', 21, 0, 0, 0, 0},
-        {'D', 76, 0, 0, 0, 0},
-        {'U', 20, 0, 0, 0, 0},
-        {'U', 74, 0, 0, 0, 0},
-        {'U', 89, 0, 0, 0, 0},
-        {'U', 61, 0, 0, 0, 0},
-        {'S', 96, 0, 0, 0, 0},
-        {'D', 79, 0, 0, 0, 0},
-        {'U', 39, 0, 0, 0, 0},
-        {'U', 72, 0, 0, 0, 0},
-        {'U', 43, 0, 0, 0, 0},
-        {'U', 9, 0, 0, 0, 0},
-        {'S', 60, 0, 0, 0, 0},
-        {'D', 4, 0, 0, 0, 0},
-        {'U', 83, 0, 0, 0, 0},
-        {'U', 15, 0, 0, 0, 0},
-        {'U', 51, 0, 0, 0, 0},
-        {'U', 0, 0, 0, 0, 0},
-        {'S', 62, 0, 0, 0, 0},
-        {'D', 54, 0, 0, 0, 0},
-        {'U', 38, 0, 0, 0, 0},
-        {'U', 59, 0, 0, 0, 0},
-        {'U', 31, 0, 0, 0, 0},
-        {'U', 69, 0, 0, 0, 0},
-        {'S', 48, 0, 0, 0, 0},
-        {'D', 28, 0, 0, 0, 0},
-        {'U', 78, 0, 0, 0, 0},
-        {'U', 87, 0, 0, 0, 0},
-        {'U', 50, 0, 0, 0, 0},
-        {'U', 65, 0, 0, 0, 0},
-        {'S', 45, 0, 0, 0, 0},
-        {'D', 63, 0, 0, 0, 0},
-        {'U', 29, 0, 0, 0, 0},
-        {'U', 18, 0, 0, 0, 0},
-        {'U', 92, 0, 0, 0, 0},
-        {'U', 86, 0, 0, 0, 0},
-        {'S', 58, 0, 0, 0, 0},
-        {'D', 84, 0, 0, 0, 0},
-        {'U', 16, 0, 0, 0, 0},
-        {'U', 3, 0, 0, 0, 0},
-        {'U', 68, 0, 0, 0, 0},
-        {'U', 27, 0, 0, 0, 0}
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'S', 30, 0, 0, 0},
+        {'D', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'S', 34, 0, 0, 0},
+        {'D', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'S', 1, 0, 0, 0},
+        {'D', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'S', 18, 0, 0, 0},
+        {'D', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'S', 22, 0, 0, 0},
+        {'D', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'S', 30, 0, 0, 0},
+        {'D', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'S', 34, 0, 0, 0},
+        {'D', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'S', 1, 0, 0, 0},
+        {'D', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'S', 5, 0, 0, 0},
+        {'D', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'S', 9, 0, 0, 0},
+        {'D', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'S', 30, 0, 0, 0},
+        {'D', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'S', 34, 0, 0, 0},
+        {'D', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'S', 1, 0, 0, 0},
+        {'D', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0}
     }
 };
 
@@ -257,161 +264,779 @@ schedule_t schedule_big = {
 schedule_t schedule_huge = {
     .id = 1,
     .max_nodes = 102,
-    .backoff_n_min = 5,
-    .backoff_n_max = 9,
+    .backoff_n_min = 4,
+    .backoff_n_max = 8,
     .n_cells = 149,
-    .cells = {
+    .cells = (cell_t[]){
+        // Begin with beacon cells. They use their own channel offsets and frequencies.
+        {'B', 0, 0, 0, 0},
+        {'B', 1, 0, 0, 0},
+        {'B', 2, 0, 0, 0},
+        // Continue with regular cells.
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'S', 6, 0, 0, 0},
+        {'D', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'S', 23, 0, 0, 0},
+        {'D', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'S', 27, 0, 0, 0},
+        {'D', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'S', 7, 0, 0, 0},
+        {'D', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'S', 11, 0, 0, 0},
+        {'D', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'S', 28, 0, 0, 0},
+        {'D', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'S', 8, 0, 0, 0},
+        {'D', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'S', 12, 0, 0, 0},
+        {'D', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'S', 29, 0, 0, 0},
+        {'D', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'S', 9, 0, 0, 0},
+        {'D', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'S', 13, 0, 0, 0},
+        {'D', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'S', 30, 0, 0, 0},
+        {'D', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'S', 10, 0, 0, 0},
+        {'D', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'S', 14, 0, 0, 0},
+        {'D', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'S', 31, 0, 0, 0},
+        {'D', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'S', 35, 0, 0, 0},
+        {'D', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'S', 15, 0, 0, 0},
+        {'D', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'S', 32, 0, 0, 0},
+        {'D', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'S', 36, 0, 0, 0},
+        {'D', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'S', 16, 0, 0, 0},
+        {'D', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'S', 33, 0, 0, 0},
+        {'D', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0}
+    }
+};
+
+#if MARI_WIDE_SCHEDULES
+/* Schedule with 603 slots, supporting up to 500 nodes */
+schedule_t schedule_wide = {
+    .id = 8,
+    .max_nodes = 500,
+    .backoff_n_min = 4,
+    .backoff_n_max = 7,
+    .n_cells = 603,
+    .cells = (cell_t[]){
         // Begin with beacon cells. They use their own channel offsets and frequencies.
-        {'B', 0, 0, 0, 0, 0},
-        {'B', 1, 0, 0, 0, 0},
-        {'B', 2, 0, 0, 0, 0},
+        {'B', 0, 0, 0, 0},
+        {'B', 1, 0, 0, 0},
+        {'B', 2, 0, 0, 0},
         // Continue with regular cells.
-        {'U', 54, 0, 0, 0, 0},
-        {'U', 9, 0, 0, 0, 0},
-        {'S', 138, 0, 0, 0, 0},
-        {'D', 117, 0, 0, 0, 0},
-        {'U', 34, 0, 0, 0, 0},
-        {'U', 77, 0, 0, 0, 0},
-        {'U', 130, 0, 0, 0, 0},
-        {'U', 129, 0, 0, 0, 0},
-        {'S', 87, 0, 0, 0, 0},
-        {'D', 120, 0, 0, 0, 0},
-        {'U', 97, 0, 0, 0, 0},
-        {'U', 65, 0, 0, 0, 0},
-        {'U', 21, 0, 0, 0, 0},
-        {'U', 113, 0, 0, 0, 0},
-        {'U', 1, 0, 0, 0, 0},
-        {'S', 91, 0, 0, 0, 0},
-        {'D', 135, 0, 0, 0, 0},
-        {'U', 96, 0, 0, 0, 0},
-        {'U', 132, 0, 0, 0, 0},
-        {'U', 101, 0, 0, 0, 0},
-        {'U', 74, 0, 0, 0, 0},
-        {'S', 15, 0, 0, 0, 0},
-        {'D', 73, 0, 0, 0, 0},
-        {'U', 84, 0, 0, 0, 0},
-        {'U', 55, 0, 0, 0, 0},
-        {'U', 58, 0, 0, 0, 0},
-        {'U', 105, 0, 0, 0, 0},
-        {'U', 49, 0, 0, 0, 0},
-        {'S', 3, 0, 0, 0, 0},
-        {'D', 122, 0, 0, 0, 0},
-        {'U', 40, 0, 0, 0, 0},
-        {'U', 0, 0, 0, 0, 0},
-        {'U', 47, 0, 0, 0, 0},
-        {'U', 51, 0, 0, 0, 0},
-        {'S', 14, 0, 0, 0, 0},
-        {'D', 35, 0, 0, 0, 0},
-        {'U', 5, 0, 0, 0, 0},
-        {'U', 10, 0, 0, 0, 0},
-        {'U', 53, 0, 0, 0, 0},
-        {'U', 80, 0, 0, 0, 0},
-        {'U', 59, 0, 0, 0, 0},
-        {'S', 139, 0, 0, 0, 0},
-        {'D', 104, 0, 0, 0, 0},
-        {'U', 134, 0, 0, 0, 0},
-        {'U', 66, 0, 0, 0, 0},
-        {'U', 11, 0, 0, 0, 0},
-        {'U', 121, 0, 0, 0, 0},
-        {'S', 95, 0, 0, 0, 0},
-        {'D', 7, 0, 0, 0, 0},
-        {'U', 108, 0, 0, 0, 0},
-        {'U', 23, 0, 0, 0, 0},
-        {'U', 72, 0, 0, 0, 0},
-        {'U', 8, 0, 0, 0, 0},
-        {'U', 28, 0, 0, 0, 0},
-        {'S', 18, 0, 0, 0, 0},
-        {'D', 94, 0, 0, 0, 0},
-        {'U', 17, 0, 0, 0, 0},
-        {'U', 125, 0, 0, 0, 0},
-        {'U', 22, 0, 0, 0, 0},
-        {'U', 143, 0, 0, 0, 0},
-        {'S', 111, 0, 0, 0, 0},
-        {'D', 16, 0, 0, 0, 0},
-        {'U', 56, 0, 0, 0, 0},
-        {'U', 20, 0, 0, 0, 0},
-        {'U', 131, 0, 0, 0, 0},
-        {'U', 61, 0, 0, 0, 0},
-        {'U', 142, 0, 0, 0, 0},
-        {'S', 83, 0, 0, 0, 0},
-        {'D', 71, 0, 0, 0, 0},
-        {'U', 110, 0, 0, 0, 0},
-        {'U', 6, 0, 0, 0, 0},
-        {'U', 98, 0, 0, 0, 0},
-        {'U', 86, 0, 0, 0, 0},
-        {'S', 42, 0, 0, 0, 0},
-        {'D', 60, 0, 0, 0, 0},
-        {'U', 137, 0, 0, 0, 0},
-        {'U', 127, 0, 0, 0, 0},
-        {'U', 141, 0, 0, 0, 0},
-        {'U', 48, 0, 0, 0, 0},
-        {'U', 92, 0, 0, 0, 0},
-        {'S', 128, 0, 0, 0, 0},
-        {'D', 19, 0, 0, 0, 0},
-        {'U', 4, 0, 0, 0, 0},
-        {'U', 115, 0, 0, 0, 0},
-        {'U', 102, 0, 0, 0, 0},
-        {'U', 81, 0, 0, 0, 0},
-        {'S', 112, 0, 0, 0, 0},
-        {'D', 133, 0, 0, 0, 0},
-        {'U', 93, 0, 0, 0, 0},
-        {'U', 62, 0, 0, 0, 0},
-        {'U', 67, 0, 0, 0, 0},
-        {'U', 89, 0, 0, 0, 0},
-        {'U', 52, 0, 0, 0, 0},
-        {'S', 114, 0, 0, 0, 0},
-        {'D', 29, 0, 0, 0, 0},
-        {'U', 100, 0, 0, 0, 0},
-        {'U', 63, 0, 0, 0, 0},
-        {'U', 99, 0, 0, 0, 0},
-        {'U', 145, 0, 0, 0, 0},
-        {'S', 31, 0, 0, 0, 0},
-        {'D', 82, 0, 0, 0, 0},
-        {'U', 37, 0, 0, 0, 0},
-        {'U', 103, 0, 0, 0, 0},
-        {'U', 39, 0, 0, 0, 0},
-        {'U', 33, 0, 0, 0, 0},
-        {'U', 24, 0, 0, 0, 0},
-        {'S', 32, 0, 0, 0, 0},
-        {'D', 140, 0, 0, 0, 0},
-        {'U', 41, 0, 0, 0, 0},
-        {'U', 85, 0, 0, 0, 0},
-        {'U', 50, 0, 0, 0, 0},
-        {'U', 25, 0, 0, 0, 0},
-        {'S', 46, 0, 0, 0, 0},
-        {'D', 26, 0, 0, 0, 0},
-        {'U', 44, 0, 0, 0, 0},
-        {'U', 68, 0, 0, 0, 0},
-        {'U', 36, 0, 0, 0, 0},
-        {'U', 12, 0, 0, 0, 0},
-        {'U', 78, 0, 0, 0, 0},
-        {'S', 90, 0, 0, 0, 0},
-        {'D', 13, 0, 0, 0, 0},
-        {'U', 75, 0, 0, 0, 0},
-        {'U', 57, 0, 0, 0, 0},
-        {'U', 116, 0, 0, 0, 0},
-        {'U', 136, 0, 0, 0, 0},
-        {'S', 124, 0, 0, 0, 0},
-        {'D', 69, 0, 0, 0, 0},
-        {'U', 30, 0, 0, 0, 0},
-        {'U', 119, 0, 0, 0, 0},
-        {'U', 70, 0, 0, 0, 0},
-        {'U', 76, 0, 0, 0, 0},
-        {'U', 123, 0, 0, 0, 0},
-        {'S', 45, 0, 0, 0, 0},
-        {'D', 118, 0, 0, 0, 0},
-        {'U', 79, 0, 0, 0, 0},
-        {'U', 107, 0, 0, 0, 0},
-        {'U', 106, 0, 0, 0, 0},
-        {'U', 144, 0, 0, 0, 0},
-        {'S', 88, 0, 0, 0, 0},
-        {'D', 64, 0, 0, 0, 0},
-        {'U', 2, 0, 0, 0, 0},
-        {'U', 43, 0, 0, 0, 0},
-        {'U', 109, 0, 0, 0, 0},
-        {'U', 27, 0, 0, 0, 0},
-        {'U', 126, 0, 0, 0, 0},
-        {'U', 38, 0, 0, 0, 0}
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'S', 28, 0, 0, 0},
+        {'D', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'S', 36, 0, 0, 0},
+        {'D', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'S', 7, 0, 0, 0},
+        {'D', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'S', 15, 0, 0, 0},
+        {'D', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'S', 23, 0, 0, 0},
+        {'D', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'S', 31, 0, 0, 0},
+        {'D', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'S', 2, 0, 0, 0},
+        {'D', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'S', 10, 0, 0, 0},
+        {'D', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'S', 18, 0, 0, 0},
+        {'D', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'S', 34, 0, 0, 0},
+        {'D', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'S', 5, 0, 0, 0},
+        {'D', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'S', 13, 0, 0, 0},
+        {'D', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'S', 21, 0, 0, 0},
+        {'D', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'S', 29, 0, 0, 0},
+        {'D', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'S', 0, 0, 0, 0},
+        {'D', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'S', 8, 0, 0, 0},
+        {'D', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'S', 16, 0, 0, 0},
+        {'D', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'S', 24, 0, 0, 0},
+        {'D', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'S', 32, 0, 0, 0},
+        {'D', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'S', 3, 0, 0, 0},
+        {'D', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'S', 11, 0, 0, 0},
+        {'D', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'S', 19, 0, 0, 0},
+        {'D', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'S', 27, 0, 0, 0},
+        {'D', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'S', 35, 0, 0, 0},
+        {'D', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'S', 6, 0, 0, 0},
+        {'D', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'S', 14, 0, 0, 0},
+        {'D', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'S', 22, 0, 0, 0},
+        {'D', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'S', 30, 0, 0, 0},
+        {'D', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'S', 1, 0, 0, 0},
+        {'D', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'S', 9, 0, 0, 0},
+        {'D', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'S', 17, 0, 0, 0},
+        {'D', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'S', 25, 0, 0, 0},
+        {'D', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'S', 33, 0, 0, 0},
+        {'D', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'S', 4, 0, 0, 0},
+        {'D', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'S', 12, 0, 0, 0},
+        {'D', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'S', 20, 0, 0, 0},
+        {'D', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'S', 28, 0, 0, 0},
+        {'D', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'S', 36, 0, 0, 0},
+        {'D', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'S', 7, 0, 0, 0},
+        {'D', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'S', 15, 0, 0, 0},
+        {'D', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'U', 10, 0, 0, 0},
+        {'S', 23, 0, 0, 0},
+        {'D', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'U', 18, 0, 0, 0},
+        {'S', 31, 0, 0, 0},
+        {'D', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'U', 26, 0, 0, 0},
+        {'S', 2, 0, 0, 0},
+        {'D', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'U', 34, 0, 0, 0},
+        {'S', 10, 0, 0, 0},
+        {'D', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'U', 5, 0, 0, 0},
+        {'S', 18, 0, 0, 0},
+        {'D', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'U', 13, 0, 0, 0},
+        {'S', 26, 0, 0, 0},
+        {'D', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0},
+        {'U', 30, 0, 0, 0},
+        {'U', 6, 0, 0, 0},
+        {'U', 19, 0, 0, 0},
+        {'U', 32, 0, 0, 0},
+        {'U', 8, 0, 0, 0},
+        {'U', 21, 0, 0, 0},
+        {'S', 34, 0, 0, 0},
+        {'D', 10, 0, 0, 0},
+        {'U', 23, 0, 0, 0},
+        {'U', 36, 0, 0, 0},
+        {'U', 12, 0, 0, 0},
+        {'U', 25, 0, 0, 0},
+        {'U', 1, 0, 0, 0},
+        {'U', 14, 0, 0, 0},
+        {'U', 27, 0, 0, 0},
+        {'U', 3, 0, 0, 0},
+        {'U', 16, 0, 0, 0},
+        {'U', 29, 0, 0, 0},
+        {'S', 5, 0, 0, 0},
+        {'D', 18, 0, 0, 0},
+        {'U', 31, 0, 0, 0},
+        {'U', 7, 0, 0, 0},
+        {'U', 20, 0, 0, 0},
+        {'U', 33, 0, 0, 0},
+        {'U', 9, 0, 0, 0},
+        {'U', 22, 0, 0, 0},
+        {'U', 35, 0, 0, 0},
+        {'U', 11, 0, 0, 0},
+        {'U', 24, 0, 0, 0},
+        {'U', 0, 0, 0, 0},
+        {'S', 13, 0, 0, 0},
+        {'D', 26, 0, 0, 0},
+        {'U', 2, 0, 0, 0},
+        {'U', 15, 0, 0, 0},
+        {'U', 28, 0, 0, 0},
+        {'U', 4, 0, 0, 0},
+        {'U', 17, 0, 0, 0}
     }
 };
+#endif
 // clang-format on
@@ -15,7 +15,6 @@
 #include <stdbool.h>
 
 #include "mr_device.h"
-#include "mr_radio.h"
 #include "mr_timer_hf.h"
 #include "mr_rng.h"
 #include "association.h"
@@ -24,8 +23,9 @@
 #include "packet.h"
 #include "mari.h"
 #include "scheduler.h"
-#include "bloom.h"
+#include "occupancy.h"
 #include "queue.h"
+#include "stats.h"
 
 //=========================== debug ============================================
 
@@ -59,8 +59,13 @@ mr_gpio_t led3 = { .port = 0, .pin = 31 };
 
 //=========================== defines =========================================
 
-#define MARI_BACKOFF_N_MIN 4
-#define MARI_BACKOFF_N_MAX 6
+// pseudo-Bayesian backlog estimation (Rivest), in Q8 fixed point:
+//   idle or success: backlog = max(1, backlog - 1)
+//   collision:       backlog = backlog + 1 / (e - 2)
+// the arrival rate term is left out, as join requests come in bursts (e.g. after a gateway reboot)
+#define MARI_JOIN_BACKLOG_Q8_ONE       (1 << 8)
+#define MARI_JOIN_BACKLOG_Q8_COLLISION (356)  // 1 / (e - 2) ~= 1.392
+#define MARI_JOIN_BACKLOG_Q8_MAX       (UINT8_MAX << 8)
 
 #define MARI_JOIN_TIMEOUT_SINCE_SYNCED (1000 * 1000 * 5)  // 5 seconds. after this time, go back to scanning. NOTE: have it be based on slotframe size?
 
@@ -78,10 +83,20 @@ typedef struct {
     // node
     uint32_t       last_received_from_gateway_asn;  ///< Last received packet when in joined state
     int16_t        backoff_n;
-    uint8_t        backoff_random_time;                ///< Number of slots to wait before re-trying to join
+    uint8_t        backoff_random_time;                ///< Number of shared uplink slots to wait before re-trying to join
+    uint8_t        synced_gateway_join_backlog;        ///< Number of nodes that my gateway thinks are trying to join
+    uint64_t       backoff_redraw_asn;                 ///< Last time the backoff was re-drawn from the join backlog
     uint32_t       join_response_timeout_ts;           ///< Time when the node will give up joining
     uint16_t       synced_gateway_remaining_capacity;  ///< Number of nodes that my gateway can still accept
     mr_event_tag_t is_pending_disconnect;              ///< Whether the node is pending a disconnect
+    uint8_t        occupancy_tag;                      ///< Tag of this node in the beacon occupancy, computed once
+    uint32_t       groups;                             ///< Groups the node is in, one bit per group. Kept across gateways
+    bool           downlink_pending;                   ///< Whether the last beacon of my gateway announced a downlink for me
+    uint64_t       downlink_pending_asn;               ///< When that beacon was handled, 0 if none since the node joined
+
+    // gateway
+    uint16_t join_backlog_q8;  ///< Estimated number of nodes contending in the shared uplink slots, in Q8
+    uint32_t join_groups;      ///< Groups every node that joins is added to, sent in the join responses
 } assoc_vars_t;
 
 //=========================== variables =======================================
@@ -106,6 +121,8 @@ void mr_assoc_init(uint16_t net_id, mr_event_cb_t event_callback) {
 
     assoc_vars.network_id          = net_id;
     assoc_vars.mari_event_callback = event_callback;
+    assoc_vars.join_backlog_q8     = MARI_JOIN_BACKLOG_Q8_ONE;
+    assoc_vars.occupancy_tag       = mr_occupancy_tag(mr_device_id());
     mr_assoc_set_state(JOIN_STATE_IDLE);
 
     // init backoff things
@@ -164,7 +181,8 @@ uint16_t mr_assoc_get_network_id(void) {
 
 // ------------ node functions ------------
 
-void mr_assoc_node_handle_synced(void) {
+void mr_assoc_node_handle_synced(uint8_t join_backlog) {
+    assoc_vars.synced_gateway_join_backlog = join_backlog;
     mr_assoc_set_state(JOIN_STATE_SYNCED);
     mr_assoc_node_init_backoff();  // ensure we start the joining procedure already with a backoff
     mr_queue_set_join_request(mr_mac_get_synced_gateway());
@@ -177,6 +195,7 @@ bool mr_assoc_node_ready_to_join(void) {
 void mr_assoc_node_start_joining(void) {
     uint32_t now_ts                     = mr_timer_hf_now(MARI_TIMER_DEV);
     assoc_vars.join_response_timeout_ts = now_ts + MARI_JOINING_STATE_TIMEOUT;
+    mr_stats_inc(MARI_STATS_JOIN_REQUESTS);
     mr_assoc_set_state(JOIN_STATE_JOINING);
 }
 
@@ -186,14 +205,30 @@ void mr_assoc_node_handle_joined(uint64_t gateway_id) {
     mr_event_data_t event_data = { .data.gateway_info.gateway_id = gateway_id };
     assoc_vars.mari_event_callback(MARI_CONNECTED, event_data);
     assoc_vars.is_pending_disconnect = MARI_NONE;        // reset the pending disconnect flag
+    assoc_vars.downlink_pending_asn  = 0;                // listen to every downlink slot until the next beacon
     mr_assoc_node_keep_gateway_alive(mr_mac_get_asn());  // initialize the gateway's keep-alive
     mr_assoc_node_reset_backoff();
 }
 
+// to be called when the node switches to a gateway it joined before leaving the previous one
+void mr_assoc_node_handle_handover(uint64_t old_gateway_id, uint64_t new_gateway_id) {
+    mr_event_data_t event_data = { .data.gateway_info.gateway_id = old_gateway_id, .tag = MARI_HANDOVER };
+    assoc_vars.mari_event_callback(MARI_DISCONNECTED, event_data);
+    mr_assoc_set_state(JOIN_STATE_JOINED);
+    mr_queue_node_redirect(old_gateway_id, new_gateway_id);  // unlike a fresh join, keep the packets waiting to be sent
+    event_data = (mr_event_data_t){ .data.gateway_info.gateway_id = new_gateway_id };
+    assoc_vars.mari_event_callback(MARI_CONNECTED, event_data);
+    assoc_vars.is_pending_disconnect = MARI_NONE;
+    assoc_vars.downlink_pending_asn  = 0;  // the asn of the previous gateway means nothing here
+    mr_assoc_node_keep_gateway_alive(mr_mac_get_asn());
+    mr_assoc_node_reset_backoff();
+}
+
 bool mr_assoc_node_handle_failed_join(void) {
     if (assoc_vars.synced_gateway_remaining_capacity > 0) {
         mr_assoc_set_state(JOIN_STATE_SYNCED);
         mr_assoc_node_register_collision_backoff();
+        mr_stats_inc(MARI_STATS_JOIN_RETRIES);
         mr_queue_set_join_request(mr_mac_get_synced_gateway());  // put a join request packet back on queue
         return true;
     } else {
@@ -204,6 +239,7 @@ bool mr_assoc_node_handle_failed_join(void) {
 }
 
 void mr_assoc_node_handle_give_up_joining(void) {
+    mr_stats_inc(MARI_STATS_JOIN_GIVE_UPS);
     mr_assoc_set_state(JOIN_STATE_IDLE);
     mr_assoc_node_reset_backoff();
 }
@@ -234,7 +270,7 @@ bool mr_assoc_node_too_long_synced_without_joining(void) {
 
 // to be called when the node is ready to join, i.e., when it gets synced with the gateway
 void mr_assoc_node_init_backoff(void) {
-    assoc_vars.backoff_n           = MARI_BACKOFF_N_MIN;
+    assoc_vars.backoff_n           = mr_assoc_node_compute_backoff_n(assoc_vars.synced_gateway_join_backlog, -1);
     assoc_vars.backoff_random_time = mr_assoc_node_compute_backoff_random_time(assoc_vars.backoff_n);
 }
 
@@ -254,21 +290,39 @@ void mr_assoc_node_tick_backoff(void) {
 // to be called when the node experiences a collision during joining
 // this will increment the backoff n, and compute a new random time
 void mr_assoc_node_register_collision_backoff(void) {
-    if (assoc_vars.backoff_n == -1) {
-        // initialize backoff, just in case
-        assoc_vars.backoff_n = MARI_BACKOFF_N_MIN;
-    } else {
-        // increment the n in [0, 2^n - 1], but only if n is less than the max
-        uint8_t new_n        = assoc_vars.backoff_n + 1;
-        assoc_vars.backoff_n = new_n < MARI_BACKOFF_N_MAX ? new_n : MARI_BACKOFF_N_MAX;
+    assoc_vars.backoff_n           = mr_assoc_node_compute_backoff_n(assoc_vars.synced_gateway_join_backlog, assoc_vars.backoff_n);
+    assoc_vars.backoff_random_time = mr_assoc_node_compute_backoff_random_time(assoc_vars.backoff_n);
+}
+
+// compute the backoff exponent n, so that the node picks a shared uplink slot in [0, 2^n - 1]
+// current_n is -1 for the first attempt, otherwise it is doubled after each collision,
+// up to twice the window sized from the backlog (the gateway already accounts for collisions in the backlog)
+uint8_t mr_assoc_node_compute_backoff_n(uint8_t join_backlog, int16_t current_n) {
+    schedule_t *schedule = mr_scheduler_get_active_schedule_ptr();
+
+    // with B contending nodes, slotted ALOHA is most efficient when each one transmits with probability 1/B,
+    // i.e., when the window is about as large as the backlog advertised by the gateway
+    uint8_t n = 0;
+    while ((1 << n) < join_backlog && n < 8) {
+        n++;
+    }
+    if (n < schedule->backoff_n_min) {
+        n = schedule->backoff_n_min;
+    }
+    if (current_n >= n) {
+        // collided with a window at least as large as the backlog, double it once
+        n++;
     }
 
-    assoc_vars.backoff_random_time = mr_assoc_node_compute_backoff_random_time(assoc_vars.backoff_n);
+    if (n > schedule->backoff_n_max) {
+        n = schedule->backoff_n_max;
+    }
+    return n;
 }
 
 uint8_t mr_assoc_node_compute_backoff_random_time(uint8_t backoff_n) {
     // first, compute the maximum value for the random number
-    uint8_t max = (1 << backoff_n) - 1;
+    uint8_t max = (1 << backoff_n) - 1;  // NOTE: backoff_n is at most 8
 
     // then, read a random number from the RNG
     // NOTE: the RNG call to read 1 byte in fast mode takes about 160 us
@@ -296,6 +350,7 @@ bool mr_assoc_node_should_leave(uint32_t asn) {
     if (gateway_is_lost) {
         // too long since last received from the gateway, consider it lost
         assoc_vars.is_pending_disconnect = MARI_PEER_LOST_TIMEOUT;
+        mr_stats_inc(MARI_STATS_TIMEOUT_DISCONNECTS);
         return true;
     }
 
@@ -306,6 +361,31 @@ void mr_assoc_node_keep_gateway_alive(uint64_t asn) {
     assoc_vars.last_received_from_gateway_asn = asn;
 }
 
+void mr_assoc_node_set_groups(uint32_t groups) {
+    assoc_vars.groups = groups;
+}
+
+uint32_t mr_assoc_node_get_groups(void) {
+    return assoc_vars.groups;
+}
+
+// returns true if dst is the address of a group the node is in
+bool mr_assoc_node_is_in_group(uint64_t dst) {
+    if (dst < MARI_GROUP_ADDRESS_PREFIX || dst >= MARI_GROUP_ADDRESS(MARI_N_GROUPS)) {
+        return false;
+    }
+    return (assoc_vars.groups >> (dst - MARI_GROUP_ADDRESS_PREFIX)) & 1;
+}
+
+// returns false if the beacons of the slotframe starting at slotframe_asn announced no downlink for the node
+// without such a beacon, e.g. it was missed or the node is not joined yet, the node listens to every downlink slot
+bool mr_assoc_node_expects_downlink(uint64_t slotframe_asn) {
+    if (!mr_assoc_is_joined() || assoc_vars.downlink_pending_asn <= slotframe_asn) {
+        return true;
+    }
+    return assoc_vars.downlink_pending;
+}
+
 void mr_assoc_node_handle_pending_disconnect(void) {
     mr_assoc_set_state(JOIN_STATE_IDLE);
     mr_scheduler_node_deassign_myself_from_schedule();
@@ -317,6 +397,9 @@ void mr_assoc_node_handle_pending_disconnect(void) {
 }
 
 void mr_assoc_node_handle_immediate_disconnect(mr_event_tag_t tag) {
+    if (tag == MARI_HANDOVER_FAILED) {
+        mr_stats_inc(MARI_STATS_HANDOVERS_FAILED);
+    }
     mr_assoc_set_state(JOIN_STATE_IDLE);
     mr_scheduler_node_deassign_myself_from_schedule();
     mr_event_data_t event_data = {
@@ -338,68 +421,69 @@ bool mr_assoc_node_matches_network_id(uint16_t network_id) {
 // ------------ gateway functions ---------
 
 bool mr_assoc_gateway_node_is_joined(uint64_t node_id) {
-    schedule_t *schedule = mr_scheduler_get_active_schedule_ptr();
-    for (size_t i = 0; i < schedule->n_cells; i++) {
-        if (schedule->cells[i].type != SLOT_TYPE_UPLINK) {
-            // we only care about uplink cells
-            continue;
-        }
-        if (schedule->cells[i].assigned_node_id == node_id) {
-            // this node is assigned to a cell, so it is joined
-            return true;
-        }
-    }
-    return false;
+    // a node is joined if it is assigned to a cell
+    return mr_scheduler_gateway_get_node_cell(node_id) >= 0;
 }
 
 bool mr_assoc_gateway_keep_node_alive(uint64_t node_id, uint64_t asn) {
-    // save the asn of the last packet received from a certain node_id
-    schedule_t *schedule = mr_scheduler_get_active_schedule_ptr();
-    for (size_t i = 0; i < schedule->n_cells; i++) {
-        if (schedule->cells[i].type != SLOT_TYPE_UPLINK) {
-            // we only care about uplink cells
-            continue;
-        }
-        if (schedule->cells[i].assigned_node_id == node_id) {
-            // save the asn so we know this node is alive
-            schedule->cells[i].last_received_asn = asn;
-        }
-    }
-    // should never reach here
-    return false;
+    // save the asn of the last packet received from a certain node_id, so we know this node is alive
+    return mr_scheduler_gateway_keep_node_alive(node_id, asn);
 }
 
 void mr_assoc_gateway_clear_old_nodes(uint64_t asn) {
-    // clear all nodes that have not been heard from in the last N asn
-    // also deassign the cells from the scheduler
+    // clear the node of the current cell if it has not been heard from in the last N asn
+    // also deassign the cell from the scheduler
+    // NOTE: only the current cell is checked, so every cell is checked once per slotframe whatever the number of nodes
     uint64_t max_asn_old = mr_scheduler_get_active_schedule_slot_count() * MARI_MAX_SLOTFRAMES_NO_RX_LEAVE;
 
-    schedule_t *schedule = mr_scheduler_get_active_schedule_ptr();
-    for (size_t i = 0; i < schedule->n_cells; i++) {
-        if (schedule->cells[i].type != SLOT_TYPE_UPLINK) {
-            // we only care about uplink cells
-            continue;
-        }
-        cell_t *cell = &schedule->cells[i];
-        if (cell->assigned_node_id != 0 && asn - cell->last_received_asn > max_asn_old) {
-            mr_event_data_t event_data = (mr_event_data_t){ .data.node_info.node_id = cell->assigned_node_id, .tag = MARI_PEER_LOST_TIMEOUT };
-            // inform the scheduler
-            mr_scheduler_gateway_decrease_nodes_counter();
-            // clear the cell
-            cell->assigned_node_id  = NULL;
-            cell->last_received_asn = 0;
-            // inform the application
-            assoc_vars.mari_event_callback(MARI_NODE_LEFT, event_data);
-        }
+    schedule_t *schedule   = mr_scheduler_get_active_schedule_ptr();
+    uint16_t    cell_index = asn % schedule->n_cells;
+    cell_t     *cell       = &schedule->cells[cell_index];
+    if (cell->type != SLOT_TYPE_UPLINK) {
+        // we only care about uplink cells
+        return;
+    }
+    if (cell->assigned_node_id != 0 && asn - cell->last_received_asn > max_asn_old) {
+        mr_event_data_t event_data = (mr_event_data_t){ .data.node_info.node_id = cell->assigned_node_id, .tag = MARI_PEER_LOST_TIMEOUT };
+        mr_stats_inc(MARI_STATS_TIMEOUT_DISCONNECTS);
+        // inform the scheduler, which clears the cell
+        mr_scheduler_gateway_release_cell(cell_index);
+        // inform the application
+        assoc_vars.mari_event_callback(MARI_NODE_LEFT, event_data);
     }
 }
 
-// ------------ packet handlers -------
+// to be called at the GATEWAY at the end of every shared uplink slot
+void mr_assoc_gateway_register_shared_slot(mr_shared_slot_outcome_t outcome) {
+    if (outcome == MARI_SHARED_SLOT_COLLISION) {
+        mr_stats_inc(MARI_STATS_JOIN_COLLISIONS);
+        uint32_t backlog_q8        = assoc_vars.join_backlog_q8 + MARI_JOIN_BACKLOG_Q8_COLLISION;
+        assoc_vars.join_backlog_q8 = backlog_q8 < MARI_JOIN_BACKLOG_Q8_MAX ? backlog_q8 : MARI_JOIN_BACKLOG_Q8_MAX;
+    } else if (assoc_vars.join_backlog_q8 >= 2 * MARI_JOIN_BACKLOG_Q8_ONE) {
+        assoc_vars.join_backlog_q8 -= MARI_JOIN_BACKLOG_Q8_ONE;
+    } else {
+        assoc_vars.join_backlog_q8 = MARI_JOIN_BACKLOG_Q8_ONE;
+    }
+}
+
+// to be called at the GATEWAY to build a beacon
+uint8_t mr_assoc_gateway_get_join_backlog(void) {
+    // round to the nearest integer
+    return (assoc_vars.join_backlog_q8 + (MARI_JOIN_BACKLOG_Q8_ONE / 2)) >> 8;
+}
+
+void mr_assoc_gateway_set_join_groups(uint32_t groups) {
+    assoc_vars.join_groups = groups;
+}
+
+uint32_t mr_assoc_gateway_get_join_groups(void) {
+    return assoc_vars.join_groups;
+}
 
-void mr_assoc_handle_beacon(uint8_t *packet, uint8_t length, uint8_t channel, uint32_t ts) {
-    (void)length;
+// ------------ packet handlers -------
 
-    if (packet[1] != MARI_PACKET_BEACON) {
+void mr_assoc_handle_beacon(uint8_t *packet, uint8_t length, uint8_t channel, uint32_t ts, int8_t rssi) {
+    if (length < sizeof(mr_beacon_packet_header_t) || packet[1] != MARI_PACKET_BEACON) {
         return;
     }
 
@@ -416,30 +500,61 @@ void mr_assoc_handle_beacon(uint8_t *packet, uint8_t length, uint8_t channel, ui
         return;
     }
 
+    // the downlink pending bitmap comes first, then the occupancy
+    const uint8_t *downlink_pending = beacon->payload;
+    uint8_t        pending_len      = beacon->downlink_pending_len == MARI_DOWNLINK_PENDING_ALL ? 0 : beacon->downlink_pending_len;
+    if (length < sizeof(mr_beacon_packet_header_t) + pending_len) {
+        return;
+    }
+    const uint8_t *occupancy     = beacon->payload + pending_len;
+    uint8_t        occupancy_len = length - sizeof(mr_beacon_packet_header_t) - pending_len;
+
     bool from_my_gateway = beacon->src == mr_mac_get_synced_gateway();
     if (from_my_gateway && mr_assoc_is_joined()) {
-        bool still_joined = mr_bloom_node_contains(mr_device_id(), beacon->bloom_filter);
+        int16_t ordinal      = mr_scheduler_node_get_uplink_ordinal();
+        bool    still_joined = ordinal >= 0 && mr_occupancy_node_contains(ordinal, assoc_vars.occupancy_tag, occupancy, occupancy_len);
         if (!still_joined) {
             // node no longer joined to this gateway, so need to leave
             assoc_vars.is_pending_disconnect = MARI_PEER_LOST_BLOOM;
+            mr_stats_inc(MARI_STATS_BLOOM_DISCONNECTS);
             return;
         }
 
         mr_assoc_node_keep_gateway_alive(mr_mac_get_asn());
+        if (beacon->downlink_pending_len == MARI_DOWNLINK_PENDING_ALL) {
+            assoc_vars.downlink_pending = true;
+        } else {
+            // ordinals past the end of the bitmap have nothing pending
+            assoc_vars.downlink_pending = ordinal / 8 < pending_len && (downlink_pending[ordinal / 8] & (1 << (ordinal % 8)));
+        }
+        assoc_vars.downlink_pending_asn = mr_mac_get_asn();
     }
 
     if (from_my_gateway && assoc_vars.state >= JOIN_STATE_SYNCED) {
-        // save the remaining capacity of my gateway
+        // save the remaining capacity and join contention of my gateway
         assoc_vars.synced_gateway_remaining_capacity = beacon->remaining_capacity;
+        assoc_vars.synced_gateway_join_backlog       = beacon->join_backlog;
+        if (beacon->next_schedule_id != 0) {
+            // my gateway is about to switch schedules, follow it (keeping my uplink cell, if any)
+            mr_scheduler_set_next_schedule(beacon->next_schedule_id, beacon->switch_asn);
+        }
     }
 
-    if (beacon->remaining_capacity == 0) {  // TODO: what if I am joined to this gateway? add a check for it.
-        // this gateway is full, ignore it
-        return;
+    uint64_t asn = mr_mac_get_asn();
+    if (from_my_gateway && assoc_vars.state == JOIN_STATE_SYNCED && asn - assoc_vars.backoff_redraw_asn >= mr_scheduler_get_active_schedule_slot_count()) {
+        // once per slotframe, re-draw the backoff if the contention measured by the gateway calls for a larger window
+        // (with a window close to the backlog, each node transmits with a probability close to 1/backlog)
+        // otherwise the exponent grown by the collisions of this node, and the slots already waited, are kept
+        int16_t backlog_n             = mr_assoc_node_compute_backoff_n(assoc_vars.synced_gateway_join_backlog, -1);
+        assoc_vars.backoff_redraw_asn = asn;
+        if (backlog_n > assoc_vars.backoff_n) {
+            assoc_vars.backoff_n           = backlog_n;
+            assoc_vars.backoff_random_time = mr_assoc_node_compute_backoff_random_time(assoc_vars.backoff_n);
+        }
     }
 
-    // save this scan info
-    mr_scan_add(*beacon, mr_radio_rssi(), channel, ts, 0);  // asn not used anymore during scan
+    // save this scan info, full gateways are kept up to date too, but never selected
+    mr_scan_add(*beacon, rssi, channel, ts, 0);  // asn not used anymore during scan
 
     return;
 }
@@ -27,6 +27,13 @@ typedef enum {
     JOIN_STATE_JOINED   = 16,
 } mr_assoc_state_t;
 
+// what the gateway observed in a shared uplink slot
+typedef enum {
+    MARI_SHARED_SLOT_IDLE,       // nothing received
+    MARI_SHARED_SLOT_SUCCESS,    // a frame was decoded
+    MARI_SHARED_SLOT_COLLISION,  // the channel was busy, but nothing could be decoded
+} mr_shared_slot_outcome_t;
+
 //=========================== variables ========================================
 
 //=========================== prototypes =======================================
@@ -35,14 +42,15 @@ void             mr_assoc_init(uint16_t net_id, mr_event_cb_t event_callback);
 void             mr_assoc_set_state(mr_assoc_state_t join_state);
 mr_assoc_state_t mr_assoc_get_state(void);
 bool             mr_assoc_is_joined(void);
-void             mr_assoc_handle_beacon(uint8_t *packet, uint8_t length, uint8_t channel, uint32_t ts);
+void             mr_assoc_handle_beacon(uint8_t *packet, uint8_t length, uint8_t channel, uint32_t ts, int8_t rssi);
 void             mr_assoc_handle_packet(uint8_t *packet, uint8_t length);
 uint16_t         mr_assoc_get_network_id(void);
 
-void mr_assoc_node_handle_synced(void);
+void mr_assoc_node_handle_synced(uint8_t join_backlog);
 bool mr_assoc_node_ready_to_join(void);
 void mr_assoc_node_start_joining(void);
 void mr_assoc_node_handle_joined(uint64_t gateway_id);
+void mr_assoc_node_handle_handover(uint64_t old_gateway_id, uint64_t new_gateway_id);
 bool mr_assoc_node_handle_failed_join(void);
 bool mr_assoc_node_too_long_waiting_for_join_response(void);
 bool mr_assoc_node_too_long_synced_without_joining(void);
@@ -51,15 +59,28 @@ void mr_assoc_node_handle_pending_disconnect(void);
 void mr_assoc_node_handle_immediate_disconnect(mr_event_tag_t tag);
 bool mr_assoc_node_matches_network_id(uint16_t network_id);
 
-void mr_assoc_node_register_collision_backoff(void);
-void mr_assoc_node_reset_backoff(void);
+void    mr_assoc_node_register_collision_backoff(void);
+void    mr_assoc_node_reset_backoff(void);
+uint8_t mr_assoc_node_compute_backoff_n(uint8_t join_backlog, int16_t current_n);
 
 bool mr_assoc_node_should_leave(uint32_t asn);
 void mr_assoc_node_keep_gateway_alive(uint64_t asn);
 
+void     mr_assoc_node_set_groups(uint32_t groups);
+uint32_t mr_assoc_node_get_groups(void);
+bool     mr_assoc_node_is_in_group(uint64_t dst);
+
+bool mr_assoc_node_expects_downlink(uint64_t slotframe_asn);
+
 bool mr_assoc_gateway_node_is_joined(uint64_t node_id);
 
 bool mr_assoc_gateway_keep_node_alive(uint64_t node_id, uint64_t asn);
 void mr_assoc_gateway_clear_old_nodes(uint64_t asn);
 
+void    mr_assoc_gateway_register_shared_slot(mr_shared_slot_outcome_t outcome);
+uint8_t mr_assoc_gateway_get_join_backlog(void);
+
+void     mr_assoc_gateway_set_join_groups(uint32_t groups);
+uint32_t mr_assoc_gateway_get_join_groups(void);
+
 #endif  // __ASSOCIATION_H
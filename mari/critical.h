@@ -0,0 +1,35 @@
+#ifndef __CRITICAL_H
+#define __CRITICAL_H
+
+/**
+ * @ingroup     mari
+ * @brief       Short critical sections around the state shared by the interrupt levels
+ *
+ * The timer interrupt (priority 0) preempts both the radio interrupt and the bottom half that handles the received
+ * frames (software interrupt), and all of them read and write the schedule indexes, the cells and the join responses.
+ * Changes to these are done with the interrupts masked, for a few instructions. Critical sections can be nested:
+ * leaving one restores the mask found when entering it.
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025-now
+ * @}
+ */
+
+#include <stdint.h>
+#include <nrf.h>
+
+//=========================== prototypes =======================================
+
+static inline uint32_t mr_critical_enter(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static inline void mr_critical_exit(uint32_t primask) {
+    __set_PRIMASK(primask);
+}
+
+#endif  // __CRITICAL_H
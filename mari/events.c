@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @ingroup     events
+ *
+ * @brief       Ring of the events waiting for the application
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+
+#include <nrf.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "events.h"
+#include "rx_pool.h"
+
+//=========================== defines ==========================================
+
+typedef struct {
+    bool         ready;  // set by the producer once the entry is filled, cleared by the consumer
+    mari_event_t entry;
+} events_slot_t;
+
+typedef struct {
+    events_slot_t slots[MARI_EVENT_RING_SIZE];
+    uint32_t      head;     // next entry to be reserved by a producer
+    uint32_t      tail;     // next entry to be read by the consumer
+    uint32_t      dropped;  // events lost because the ring was full
+} events_vars_t;
+
+//=========================== variables ========================================
+
+static events_vars_t events_vars = { 0 };
+
+//=========================== prototypes =======================================
+
+//=========================== public ===========================================
+
+void mr_events_init(void) {
+    memset(&events_vars, 0, sizeof(events_vars));
+}
+
+// called from interrupt context
+bool mr_events_push(mr_event_t event, mr_event_data_t event_data) {
+    // reserve an entry
+    uint32_t head = __atomic_load_n(&events_vars.head, __ATOMIC_RELAXED);
+    do {
+        if (head - __atomic_load_n(&events_vars.tail, __ATOMIC_ACQUIRE) >= MARI_EVENT_RING_SIZE) {
+            __atomic_fetch_add(&events_vars.dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&events_vars.head, &head, head + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    // fill it, the packet stays in its receive buffer until the application releases the event
+    events_slot_t *slot = &events_vars.slots[head % MARI_EVENT_RING_SIZE];
+    slot->entry.event      = event;
+    slot->entry.event_data = event_data;
+    if (event == MARI_NEW_PACKET) {
+        mr_rx_pool_hold(event_data.data.new_packet.header);
+    }
+
+    // and publish it
+    __atomic_store_n(&slot->ready, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+// called from the main loop
+size_t mr_events_poll(mari_event_t *batch, size_t max_events) {
+    size_t   count = 0;
+    uint32_t tail  = events_vars.tail;
+    while (count < max_events) {
+        events_slot_t *slot = &events_vars.slots[tail % MARI_EVENT_RING_SIZE];
+        if (!__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE)) {
+            // empty, or the next entry is still being filled
+            break;
+        }
+        batch[count++] = slot->entry;
+        __atomic_store_n(&slot->ready, false, __ATOMIC_RELAXED);
+        tail++;
+        __atomic_store_n(&events_vars.tail, tail, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+void mr_events_release(const mari_event_t *event) {
+    if (event->event == MARI_NEW_PACKET) {
+        mr_rx_pool_release(event->event_data.data.new_packet.header);
+    }
+}
+
+uint32_t mr_events_get_dropped(void) {
+    return __atomic_load_n(&events_vars.dropped, __ATOMIC_RELAXED);
+}
+
+//=========================== private ==========================================
@@ -0,0 +1,68 @@
+#ifndef __EVENTS_H
+#define __EVENTS_H
+
+/**
+ * @ingroup     mari
+ * @brief       Ring of the events waiting for the application
+ *
+ * Events are pushed from the radio and timer interrupts, and drained from the main loop with mari_poll_events.
+ * A MARI_NEW_PACKET entry holds a reference to the receive buffer of its packet (see rx_pool.h), so the packet
+ * is not copied, and stays valid until the application releases the event with mari_release_event.
+ *
+ * The ring takes no lock: a producer reserves an entry by moving the head forward, fills it, then marks it as ready.
+ * As the timer interrupt can preempt the radio interrupt, entries may become ready out of order; the consumer
+ * stops at the first entry that is not ready yet, and gets it at the next poll.
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025-now
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "models.h"
+
+//=========================== defines =========================================
+
+#ifndef MARI_EVENT_RING_SIZE
+#define MARI_EVENT_RING_SIZE (16)  // must be a power of 2
+#endif
+
+//=========================== prototypes ======================================
+
+void mr_events_init(void);
+
+/**
+ * @brief Adds an event to the ring, holding the receive buffer of the packet it refers to, if any.
+ *
+ * @param[in] event         Event
+ * @param[in] event_data    Event data
+ *
+ * @return false if the ring is full, and the event was dropped
+ */
+bool mr_events_push(mr_event_t event, mr_event_data_t event_data);
+
+/**
+ * @brief Moves the oldest events of the ring to a batch.
+ *
+ * @param[out] batch        Buffer receiving up to max_events events
+ * @param[in]  max_events   Maximum number of events to move
+ *
+ * @return Number of events moved
+ */
+size_t mr_events_poll(mari_event_t *batch, size_t max_events);
+
+/**
+ * @brief Releases the receive buffer held by an event, once the application is done with it.
+ *
+ * @param[in] event         Event returned by mr_events_poll
+ */
+void mr_events_release(const mari_event_t *event);
+
+uint32_t mr_events_get_dropped(void);
+
+#endif  // __EVENTS_H
@@ -0,0 +1,256 @@
+/**
+ * @file
+ * @ingroup     link
+ *
+ * @brief       Link quality: of each node at the gateway, and of the serving gateway at a node
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+
+#include <nrf.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "link.h"
+#include "scheduler.h"
+#include "critical.h"
+
+//=========================== defines ==========================================
+
+typedef struct {
+    uint64_t node_id;        // node the entry refers to, 0 if unused
+    int16_t  rssi_q4;        // RSSI EWMA, in 1/16 dBm
+    uint32_t rx_history;     // bit 0 is the most recent slotframe, set if a frame was received
+    uint8_t  history_len;    // number of valid bits in rx_history
+    uint64_t last_seen_asn;  // ASN of the last frame received from the node
+    uint8_t  miss_streak;    // consecutive slotframes without a frame from the node
+    bool     dirty;          // true if the entry must be reported to the host
+    bool     left;           // true if the node left the cell, the entry is cleared once reported
+    int8_t   reported_rssi;  // values sent in the last report
+    uint8_t  reported_pdr;
+} link_entry_t;
+
+typedef struct {
+    bool     has_rssi;  // false until a first frame is received from the gateway
+    int16_t  rssi_q4;   // RSSI EWMA, in 1/16 dBm
+    uint16_t miss_q8;   // EWMA of the beacon slots without a beacon, in 1/256
+} link_serving_t;
+
+typedef struct {
+    link_entry_t   links[MARI_N_CELLS_MAX];  // indexed by uplink cell, used by the gateway
+    uint16_t       report_cursor;            // where the next search for dirty entries starts
+    link_serving_t serving;                  // link to the serving gateway, used by the node
+} link_vars_t;
+
+// share of missed beacons, in 1/256, from which each scan level applies
+static const uint16_t _scan_miss_thresholds_q8[MARI_LINK_SCAN_LEVEL_MAX] = { 13, 26, 51, 102 };  // 5%, 10%, 20%, 40%
+
+//=========================== variables ========================================
+
+static link_vars_t link_vars = { 0 };
+
+//=========================== prototypes =======================================
+
+static link_entry_t *_get_entry(uint16_t cell_id, uint64_t node_id);
+static uint8_t       _pdr_percent(const link_entry_t *link);
+static void          _update_dirty(link_entry_t *link);
+
+//=========================== public ===========================================
+
+// -------- gateway ---------
+
+void mr_link_gateway_init(void) {
+    memset(&link_vars, 0, sizeof(link_vars));
+}
+
+void mr_link_gateway_register_rx(uint16_t cell_id, uint64_t node_id, int8_t rssi, uint64_t asn) {
+    link_entry_t *link = _get_entry(cell_id, node_id);
+    if (link == NULL) {
+        return;
+    }
+
+    if (link->history_len == 0) {
+        // first sample, seed the average
+        link->rssi_q4 = rssi * 16;
+    } else {
+        link->rssi_q4 += ((rssi * 16) - link->rssi_q4) >> MARI_LINK_RSSI_EWMA_SHIFT;
+    }
+    link->rx_history = (link->rx_history << 1) | 1;
+    if (link->history_len < MARI_LINK_PDR_SLOTFRAMES) {
+        link->history_len++;
+    }
+    link->last_seen_asn = asn;
+    if (link->miss_streak != 0) {
+        link->miss_streak = 0;
+        link->dirty       = true;
+    }
+    _update_dirty(link);
+}
+
+void mr_link_gateway_register_miss(uint16_t cell_id, uint64_t node_id) {
+    link_entry_t *link = _get_entry(cell_id, node_id);
+    if (link == NULL) {
+        return;
+    }
+
+    link->rx_history <<= 1;
+    if (link->history_len < MARI_LINK_PDR_SLOTFRAMES) {
+        link->history_len++;
+    }
+    if (link->miss_streak < UINT8_MAX) {
+        link->miss_streak++;
+        link->dirty = true;
+    }
+    _update_dirty(link);
+}
+
+void mr_link_gateway_release(uint16_t cell_id) {
+    if (cell_id >= MARI_N_CELLS_MAX || link_vars.links[cell_id].node_id == 0) {
+        return;
+    }
+    link_vars.links[cell_id].left  = true;
+    link_vars.links[cell_id].dirty = true;
+}
+
+void mr_link_gateway_remap(uint16_t from, uint16_t to) {
+    if (from == to || from >= MARI_N_CELLS_MAX || to >= MARI_N_CELLS_MAX) {
+        return;
+    }
+    link_vars.links[to] = link_vars.links[from];
+    memset(&link_vars.links[from], 0, sizeof(link_entry_t));
+}
+
+void mr_link_gateway_clear(uint16_t cell_id) {
+    if (cell_id < MARI_N_CELLS_MAX) {
+        memset(&link_vars.links[cell_id], 0, sizeof(link_entry_t));
+    }
+}
+
+uint8_t mr_link_gateway_get_deltas(mr_link_delta_t *deltas, uint8_t max_len) {
+    uint8_t  count   = 0;
+    uint16_t n_cells = mr_scheduler_get_active_schedule_slot_count();
+    if (link_vars.report_cursor >= n_cells) {
+        link_vars.report_cursor = 0;
+    }
+
+    // resume where the previous report stopped, so that all links get their turn
+    for (uint16_t i = 0; i < n_cells && count < max_len; i++) {
+        uint16_t      cell_id = (link_vars.report_cursor + i) % n_cells;
+        link_entry_t *link    = &link_vars.links[cell_id];
+        if (!link->dirty || link->node_id == 0) {
+            continue;
+        }
+        // the entry is updated in the radio isr, and released in the timer isr
+        uint32_t primask    = mr_critical_enter();
+        link->dirty         = false;
+        link->reported_rssi = link->rssi_q4 / 16;
+        link->reported_pdr  = link->left ? MARI_LINK_PDR_NODE_LEFT : _pdr_percent(link);
+
+        deltas[count++] = (mr_link_delta_t){
+            .node_id       = link->node_id,
+            .cell_id       = cell_id,
+            .rssi          = link->reported_rssi,
+            .pdr           = link->reported_pdr,
+            .miss_streak   = link->miss_streak,
+            .last_seen_asn = link->last_seen_asn,
+        };
+        if (link->left) {
+            // the host has been told, the cell is free for the next node
+            memset(link, 0, sizeof(link_entry_t));
+        }
+        mr_critical_exit(primask);
+        link_vars.report_cursor = cell_id + 1;
+    }
+    return count;
+}
+
+// -------- node ---------
+
+void mr_link_node_reset(void) {
+    memset(&link_vars.serving, 0, sizeof(link_serving_t));
+}
+
+void mr_link_node_register_rx(bool is_beacon, int8_t rssi) {
+    link_serving_t *link = &link_vars.serving;
+    if (!link->has_rssi) {
+        link->rssi_q4  = rssi * 16;
+        link->has_rssi = true;
+    } else {
+        link->rssi_q4 += ((rssi * 16) - link->rssi_q4) >> MARI_LINK_RSSI_EWMA_SHIFT;
+    }
+    if (is_beacon) {
+        link->miss_q8 -= link->miss_q8 >> MARI_LINK_NODE_MISS_EWMA_SHIFT;
+    }
+}
+
+void mr_link_node_register_miss(void) {
+    link_serving_t *link = &link_vars.serving;
+    link->miss_q8 += (256 - link->miss_q8) >> MARI_LINK_NODE_MISS_EWMA_SHIFT;
+}
+
+int8_t mr_link_node_get_rssi(void) {
+    if (!link_vars.serving.has_rssi) {
+        return INT8_MIN;
+    }
+    return link_vars.serving.rssi_q4 / 16;
+}
+
+uint8_t mr_link_node_get_scan_level(void) {
+    link_serving_t *link = &link_vars.serving;
+
+    // the level is set by whichever of the rssi and the beacon losses looks worse
+    uint8_t level = 0;
+    while (level < MARI_LINK_SCAN_LEVEL_MAX && link->miss_q8 >= _scan_miss_thresholds_q8[level]) {
+        level++;
+    }
+    if (link->has_rssi) {
+        int16_t below_good = MARI_LINK_SCAN_RSSI_GOOD * 16 - link->rssi_q4;
+        if (below_good > 0) {
+            int16_t rssi_level = 1 + below_good / (MARI_LINK_SCAN_RSSI_STEP * 16);
+            if (rssi_level > level) {
+                level = rssi_level < MARI_LINK_SCAN_LEVEL_MAX ? rssi_level : MARI_LINK_SCAN_LEVEL_MAX;
+            }
+        }
+    }
+    return level;
+}
+
+//=========================== private ==========================================
+
+static link_entry_t *_get_entry(uint16_t cell_id, uint64_t node_id) {
+    if (cell_id >= MARI_N_CELLS_MAX || node_id == 0) {
+        return NULL;
+    }
+
+    link_entry_t *link = &link_vars.links[cell_id];
+    if (link->node_id != node_id || link->left) {
+        // the cell was handed to another node, start over
+        // NOTE: if the previous node left and was not reported yet, the host learns of it from the new node in its cell
+        memset(link, 0, sizeof(link_entry_t));
+        link->node_id = node_id;
+        link->dirty   = true;
+    }
+    return link;
+}
+
+static uint8_t _pdr_percent(const link_entry_t *link) {
+    if (link->history_len == 0) {
+        return 0;
+    }
+    uint32_t mask     = (link->history_len == 32) ? UINT32_MAX : (((uint32_t)1 << link->history_len) - 1);
+    uint32_t received = __builtin_popcount(link->rx_history & mask);
+    return (received * 100) / link->history_len;
+}
+
+static void _update_dirty(link_entry_t *link) {
+    int16_t rssi      = link->rssi_q4 / 16;
+    int16_t rssi_diff = rssi - link->reported_rssi;
+    int16_t pdr_diff  = (int16_t)_pdr_percent(link) - link->reported_pdr;
+
+    if (abs(rssi_diff) >= MARI_LINK_REPORT_RSSI_DB || abs(pdr_diff) >= MARI_LINK_REPORT_PDR_PERCENT) {
+        link->dirty = true;
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef __LINK_H
+#define __LINK_H
+
+/**
+ * @ingroup     mari
+ * @brief       Link quality: of each node at the gateway, and of the serving gateway at a node
+ *
+ * A node tracks the beacons of the gateway it is joined to, and only scans for other gateways in the background
+ * once that link degrades: the weaker the link, the more often it scans.
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025-now
+ * @}
+ */
+
+#include <nrf.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "models.h"
+
+//=========================== defines =========================================
+
+#define MARI_LINK_RSSI_EWMA_SHIFT 3   // EWMA weight of a new sample is 1 / 2^shift
+#define MARI_LINK_PDR_SLOTFRAMES  32  // number of slotframes used to compute the PDR (max 32)
+
+// a link is reported again once one of its values moves by at least this much
+#define MARI_LINK_REPORT_RSSI_DB     2
+#define MARI_LINK_REPORT_PDR_PERCENT 5
+
+#define MARI_LINK_DELTAS_PER_FRAME ((MARI_PACKET_MAX_SIZE - 2) / sizeof(mr_link_delta_t))
+
+// serving link at the node, and how often it scans in the background
+#define MARI_LINK_NODE_MISS_EWMA_SHIFT 4    // EWMA weight of a beacon slot is 1 / 2^shift
+#define MARI_LINK_SCAN_LEVEL_MAX       4    // at this level, the node scans every slotframe, each level below halves it
+#define MARI_LINK_SCAN_RSSI_GOOD       -70  // dBm, no background scan above this
+#define MARI_LINK_SCAN_RSSI_STEP       6    // dB, one scan level more every time the rssi drops by this much
+
+//=========================== prototypes ======================================
+
+void mr_link_gateway_init(void);
+
+/**
+ * @brief Records a frame received from a node in its uplink cell.
+ *
+ * @param[in] cell_id       Uplink cell the frame was received in
+ * @param[in] node_id       Source of the frame
+ * @param[in] rssi          RSSI of the frame, in dBm
+ * @param[in] asn           ASN at which the frame was received
+ */
+void mr_link_gateway_register_rx(uint16_t cell_id, uint64_t node_id, int8_t rssi, uint64_t asn);
+
+/**
+ * @brief Records that nothing valid was received in an assigned uplink cell.
+ *
+ * @param[in] cell_id       Uplink cell that stayed silent
+ * @param[in] node_id       Node assigned to that cell
+ */
+void mr_link_gateway_register_miss(uint16_t cell_id, uint64_t node_id);
+
+/**
+ * @brief Forgets the link of a node that left its uplink cell, once the host has been told.
+ *
+ * @param[in] cell_id       Uplink cell that was released
+ */
+void mr_link_gateway_release(uint16_t cell_id);
+
+/**
+ * @brief Moves the link of a node to the cell it was given in the next schedule.
+ *
+ * @param[in] from          Uplink cell of the node in the current schedule
+ * @param[in] to            Uplink cell of the node in the next schedule
+ */
+void mr_link_gateway_remap(uint16_t from, uint16_t to);
+
+/**
+ * @brief Forgets whatever is left in a cell, e.g. one that has no counterpart in the next schedule.
+ *
+ * @param[in] cell_id       Cell to be cleared
+ */
+void mr_link_gateway_clear(uint16_t cell_id);
+
+/**
+ * @brief Copies the links that changed since they were last reported, and marks them as reported.
+ *
+ * @param[out] deltas       Buffer receiving up to max_len entries
+ * @param[in]  max_len      Maximum number of entries to copy
+ *
+ * @return Number of entries copied
+ */
+uint8_t mr_link_gateway_get_deltas(mr_link_delta_t *deltas, uint8_t max_len);
+
+/**
+ * @brief Starts tracking a new serving gateway.
+ */
+void mr_link_node_reset(void);
+
+/**
+ * @brief Records a frame received from the serving gateway.
+ *
+ * @param[in] is_beacon     Whether the frame was received in a beacon slot
+ * @param[in] rssi          RSSI of the frame, in dBm
+ */
+void mr_link_node_register_rx(bool is_beacon, int8_t rssi);
+
+/**
+ * @brief Records a beacon slot in which nothing was received from the serving gateway.
+ */
+void mr_link_node_register_miss(void);
+
+/**
+ * @brief Gets the average RSSI of the serving gateway.
+ *
+ * @return RSSI in dBm, or INT8_MIN if nothing was received yet
+ */
+int8_t mr_link_node_get_rssi(void);
+
+/**
+ * @brief Gets how often the node should scan for other gateways.
+ *
+ * @return 0 if the serving link is healthy, up to MARI_LINK_SCAN_LEVEL_MAX as it degrades
+ */
+uint8_t mr_link_node_get_scan_level(void);
+
+#endif  // __LINK_H
@@ -21,8 +21,14 @@
 #include "scan.h"
 #include "scheduler.h"
 #include "association.h"
+#include "link.h"
+#include "rx_pool.h"
+#include "critical.h"
+#include "stats.h"
+#include "profile.h"
 #include "mr_radio.h"
 #include "mr_timer_hf.h"
+#include "mr_swi.h"
 #include "packet.h"
 #include "mr_device.h"
 
@@ -55,6 +61,15 @@ mr_gpio_t pin3 = { .port = 1, .pin = 5 };
 
 //=========================== defines ==========================================
 
+#define MARI_RX_START_FRAME_DELAY_US 59  // from tx_offset at the transmitter to the start of frame at the receiver, measured with a logic analyzer
+
+#define MARI_HANDOVER_RESERVED_SLOTS 3  // a shared uplink and a downlink slot of the target gateway overlap at most 3 slots of the current one
+
+#define MARI_CLOCK_DRIFT_PPM            80                                                         // worst-case drift between the clocks of two devices, each within 40 ppm
+#define MARI_HANDOVER_MAX_BEACON_AGE_US (MARI_RX_GUARD_TIME * 1000 * 1000 / MARI_CLOCK_DRIFT_PPM)  // past this, the slots of a gateway guessed from its beacon may be off by more than the rx guard
+
+#define MARI_RX_DEFERRED_QUEUE_SIZE 4  // frames received in the radio isr and waiting for the bottom half, must be a power of 2
+
 typedef enum {
     // common
     STATE_SLEEP,
@@ -68,6 +83,13 @@ typedef enum {
     STATE_RX_DATA_LISTEN = 32,
     STATE_RX_DATA        = 33,
 
+    // pre-joining the target gateway of a handover
+    STATE_HANDOVER_TX_OFFSET      = 41,
+    STATE_HANDOVER_TX_DATA        = 42,
+    STATE_HANDOVER_RX_OFFSET      = 43,
+    STATE_HANDOVER_RX_DATA_LISTEN = 44,
+    STATE_HANDOVER_RX_DATA        = 45,
+
 } mr_mac_state_t;
 
 typedef struct {
@@ -81,6 +103,15 @@ typedef struct {
     mr_event_cb_t mari_event_callback;  ///< Function pointer, stores the application callback
 
     mr_received_packet_t received_packet;  ///< Last received packet
+    mr_rx_buffer_t      *rx_buffer;        ///< Pool buffer the radio receives in, NULL if the pool was exhausted
+
+    ///< Frames are only timestamped in the radio isr, and processed later in a software interrupt (the bottom half)
+    mr_received_packet_t rx_deferred[MARI_RX_DEFERRED_QUEUE_SIZE];  ///< Frames waiting for the bottom half, each owns its pool buffer
+    volatile uint8_t     rx_deferred_head;                          ///< Next entry to write, only written by the radio isr
+    volatile uint8_t     rx_deferred_tail;                          ///< Next entry to process, only written by the bottom half
+    uint32_t             rx_deferred_dropped;                       ///< Frames dropped because the bottom half was late
+    uint32_t             radio_isr_max_us;                          ///< Worst-case duration of the end of frame radio isr
+    uint32_t             rx_bottom_half_max_us;                     ///< Worst-case duration of the bottom half
 
     bool     is_scanning;           ///< Whether the node is scanning for gateways
     uint32_t scan_started_ts;       ///< Timestamp of the start of the scan
@@ -95,6 +126,13 @@ typedef struct {
     uint32_t full_bg_scan_started_ts;
     uint32_t full_bg_scan_expected_end_ts;  ///< Timestamp of the expected end of the full handover scan
 
+    ///< Make-before-break handover: the node sends its join request to the target gateway, and gets the response,
+    ///< in slots of the current gateway that are reserved for it, and only switches once it has a cell at the target
+    mr_channel_info_t handover_target;      ///< Beacon of the target gateway, as heard in the background scan
+    uint64_t          handover_first_asn;   ///< First reserved slot of the current gateway, 0 if no pre-join is planned
+    uint64_t          handover_target_asn;  ///< ASN, at the target gateway, of the shared uplink slot used to pre-join
+    uint32_t          handover_target_ts;   ///< Timestamp of the start of that slot
+
     uint64_t synced_gateway;     ///< ID of the gateway the node is synchronized with
     uint16_t synced_network_id;  ///< Network ID of the gateway the node is synchronized with
     uint32_t synced_ts;          ///< Timestamp of the last synchronization
@@ -138,7 +176,15 @@ static void activity_rie1(void);
 static void activity_ri4(uint32_t ts);
 static void activity_rie2(void);
 
+static void arm_rx_buffer(void);
+static bool defer_received_packet(void);
+static void isr_mac_rx_bottom_half(void);
+
 static void fix_drift(uint32_t ts);
+static void register_reception(const mr_received_packet_t *received);
+static void update_link_stats(slot_type_t slot_type, uint16_t cell_id, const mr_received_packet_t *received);
+static void update_serving_link(slot_type_t slot_type, const mr_received_packet_t *received);
+static void update_join_contention(slot_type_t slot_type, mr_shared_slot_outcome_t outcome);
 
 static void start_scan(void);
 static void end_scan(void);
@@ -147,10 +193,23 @@ static void activity_scan_start_frame(uint32_t ts);
 static void activity_scan_end_frame(uint32_t ts);
 static bool sync_to_gateway(uint32_t now_ts, mr_channel_info_t *selected_gateway, uint32_t handover_time_correction_us);
 
+static bool node_should_background_scan(void);
 static void start_or_continue_background_scan(void);
 static void end_background_scan(void);
 static void handle_bg_scan_and_trigger_handover(uint32_t now_ts);
 
+static bool handover_plan_pre_join(mr_channel_info_t *target);
+static bool handover_slot_is_reserved(uint64_t asn);
+static void handover_switch(int16_t cell_id, uint32_t ts);
+static void activity_hi1(void);
+static void activity_hi2(void);
+static void activity_hi3(void);
+static void activity_hi4(void);
+static void activity_hi5(void);
+static void activity_hi6(uint32_t ts);
+static void activity_hi7(void);
+static void activity_hie1(void);
+
 static void isr_mac_radio_start_frame(uint32_t ts);
 static void isr_mac_radio_end_frame(uint32_t ts);
 
@@ -167,6 +226,13 @@ void mr_mac_init(mr_event_cb_t event_callback) {
     // initialize the radio
     mr_radio_init(&isr_mac_radio_start_frame, &isr_mac_radio_end_frame, MR_RADIO_BLE_2MBit);
 
+    // received frames are processed out of the radio isr, in the buffer the radio wrote them to
+    mr_rx_pool_init();
+    mac_vars.rx_buffer        = NULL;
+    mac_vars.rx_deferred_head = 0;
+    mac_vars.rx_deferred_tail = 0;
+    mr_swi_init(&isr_mac_rx_bottom_half);
+
     // node stuff
     mac_vars.device_id = mr_device_id();
 
@@ -216,6 +282,18 @@ inline bool mr_mac_node_is_synced(void) {
     return mac_vars.synced_gateway != 0;
 }
 
+uint32_t mr_mac_get_radio_isr_max_us(void) {
+    return mac_vars.radio_isr_max_us;
+}
+
+uint32_t mr_mac_get_rx_bottom_half_max_us(void) {
+    return mac_vars.rx_bottom_half_max_us;
+}
+
+uint32_t mr_mac_get_rx_deferred_dropped(void) {
+    return mac_vars.rx_deferred_dropped;
+}
+
 //=========================== private ==========================================
 
 static void set_slot_state(mr_mac_state_t state) {
@@ -239,6 +317,7 @@ static void set_slot_state(mr_mac_state_t state) {
 // --------------------- start/end synced slots -----------
 
 static void new_slot_synced(void) {
+    MR_PROFILE_SCOPE(MARI_PROFILE_NEW_SLOT);
     mac_vars.start_slot_ts = mr_timer_hf_now(MARI_TIMER_DEV);
     DEBUG_GPIO_SET(&pin0);
     DEBUG_GPIO_CLEAR(&pin0);  // debug: show that a new slot started
@@ -270,6 +349,20 @@ static void new_slot_synced(void) {
         }
     }
 
+    if (handover_slot_is_reserved(mac_vars.asn)) {
+        // the radio is lent to the pre-join of the target gateway, only keep the schedule ticking
+        bool is_first_reserved_slot = mac_vars.asn == mac_vars.handover_first_asn;
+        mac_vars.current_slot_info  = mr_scheduler_tick(mac_vars.asn++);
+        if (is_first_reserved_slot) {
+            activity_hi1();
+        }
+        return;
+    }
+    if (mac_vars.handover_first_asn != 0) {
+        // the reserved slots are over and the node did not switch: the pre-join failed, stay with the current gateway
+        mac_vars.handover_first_asn = 0;
+    }
+
     mac_vars.current_slot_info = mr_scheduler_tick(mac_vars.asn++);
 
     if (mac_vars.current_slot_info.radio_action == MARI_RADIO_ACTION_TX) {
@@ -277,9 +370,8 @@ static void new_slot_synced(void) {
     } else if (mac_vars.current_slot_info.radio_action == MARI_RADIO_ACTION_RX) {
         activity_ri1();
     } else if (mac_vars.current_slot_info.radio_action == MARI_RADIO_ACTION_SLEEP) {
-        mr_scheduler_stats_register_used_slot(false);
         // check if we should use this slot for background scan
-        if (MARI_ENABLE_BACKGROUND_SCAN && mari_get_node_type() == MARI_NODE && mr_assoc_is_joined()) {
+        if (node_should_background_scan()) {
             start_or_continue_background_scan();
         } else {
             set_slot_state(STATE_SLEEP);
@@ -297,6 +389,7 @@ static void node_clear_synced_info(void) {
     mac_vars.is_bg_scanning               = false;
     mac_vars.full_bg_scan_started_ts      = 0;
     mac_vars.full_bg_scan_expected_end_ts = 0;
+    mac_vars.handover_first_asn           = 0;
 }
 
 static void node_back_to_scanning(void) {
@@ -365,6 +458,23 @@ static void end_scan(void) {
 
 // --------------------- start/end background scan --------
 
+static bool node_should_background_scan(void) {
+    if (!MARI_ENABLE_BACKGROUND_SCAN || mari_get_node_type() != MARI_NODE || !mr_assoc_is_joined()) {
+        return false;
+    }
+    if (mac_vars.full_bg_scan_started_ts != 0) {
+        // finish the full scan that is running
+        return true;
+    }
+    // start a full scan only as often as the serving link requires
+    uint8_t level = mr_link_node_get_scan_level();
+    if (level == 0) {
+        return false;
+    }
+    uint64_t slotframe = mac_vars.asn / mr_scheduler_get_active_schedule_slot_count();
+    return slotframe % (1 << (MARI_LINK_SCAN_LEVEL_MAX - level)) == 0;
+}
+
 static void start_or_continue_background_scan(void) {
     // 1. prepare timestamps and and arm timer
     if (!mac_vars.is_bg_scanning) {
@@ -382,7 +492,8 @@ static void start_or_continue_background_scan(void) {
     cell_t next_slot                  = mr_scheduler_node_peek_slot(mac_vars.asn);  // remember: the asn was already incremented at new_slot_synced
     bool   next_uplink_is_sleep_slot  = next_slot.type == SLOT_TYPE_UPLINK && next_slot.assigned_node_id != mr_device_id();
     bool   next_slot_is_shared_uplink = next_slot.type == SLOT_TYPE_SHARED_UPLINK;
-    mac_vars.bg_scan_sleep_next_slot  = next_uplink_is_sleep_slot || next_slot_is_shared_uplink;
+    bool   next_slot_is_reserved      = handover_slot_is_reserved(mac_vars.asn);
+    mac_vars.bg_scan_sleep_next_slot  = (next_uplink_is_sleep_slot || next_slot_is_shared_uplink) && !next_slot_is_reserved;
 
     // end_background_scan will be called to check if the background scan should be stopped
     mr_timer_hf_set_oneshot_with_ref_us(
@@ -431,6 +542,7 @@ static void end_background_scan(void) {
 static void activity_ti1(void) {
     // ti1: arm tx timers and prepare the radio for tx
     // called by: function new_slot_synced
+    MR_PROFILE_SCOPE(MARI_PROFILE_TI1);
     set_slot_state(STATE_TX_OFFSET);
 
     // before arming the timers, check if there is a packet to send
@@ -439,10 +551,8 @@ static void activity_ti1(void) {
 
     if (packet_len == 0) {
         // nothing to tx
-        mr_scheduler_stats_register_used_slot(false);
-
         // check if we should use this slot for background scan
-        if (MARI_ENABLE_BACKGROUND_SCAN && mari_get_node_type() == MARI_NODE && mr_assoc_is_joined()) {
+        if (node_should_background_scan()) {
             start_or_continue_background_scan();
             return;
         }
@@ -452,7 +562,7 @@ static void activity_ti1(void) {
         end_slot();
         return;
     }
-    mr_scheduler_stats_register_used_slot(true);
+    mr_scheduler_stats_register(MARI_CELL_STATS_TX);
 
     // arm the timers
     mr_timer_hf_set_oneshot_with_ref_diff_us(  // TODO: use PPI instead
@@ -478,6 +588,7 @@ static void activity_ti1(void) {
 static void activity_ti2(void) {
     // ti2: tx actually begins
     // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_TI2);
     set_slot_state(STATE_TX_DATA);
 
     // FIXME: replace this call with a direct PPI connection, i.e., TsTxOffset expires -> radio tx
@@ -487,6 +598,7 @@ static void activity_ti2(void) {
 static void activity_tie1(void) {
     // tte1: something went wrong, stayed in tx for too long, abort
     // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_TIE1);
     set_slot_state(STATE_SLEEP);
 
     end_slot();
@@ -495,6 +607,7 @@ static void activity_tie1(void) {
 static void activity_ti3(void) {
     // ti3: all fine, finished tx, cancel error timers and go to sleep
     // called by: radio isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_TI3);
     set_slot_state(STATE_SLEEP);
 
     // cancel tte1 timer
@@ -510,6 +623,7 @@ static void activity_ti3(void) {
 static void activity_ri1(void) {
     // ri1: arm rx timers and prepare the radio for rx
     // called by: function new_slot_synced
+    MR_PROFILE_SCOPE(MARI_PROFILE_RI1);
     set_slot_state(STATE_RX_OFFSET);
 
     mr_timer_hf_set_oneshot_with_ref_diff_us(  // TODO: use PPI instead
@@ -537,20 +651,21 @@ static void activity_ri1(void) {
 static void activity_ri2(void) {
     // ri2: rx actually begins
     // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_RI2);
     set_slot_state(STATE_RX_DATA_LISTEN);
 
     mr_radio_disable();
     mr_radio_set_channel(mac_vars.current_slot_info.channel);
+    arm_rx_buffer();
     mr_radio_rx();
 }
 
 static void activity_ri3(uint32_t ts) {
     // ri3: a packet started to arrive
     // called by: radio isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_RI3);
     set_slot_state(STATE_RX_DATA);
 
-    mr_scheduler_stats_register_used_slot(true);
-
     // cancel timer for rx_guard
     mr_timer_hf_cancel(MARI_TIMER_DEV, MARI_TIMER_CHANNEL_2);
 
@@ -560,9 +675,14 @@ static void activity_ri3(uint32_t ts) {
 static void activity_rie1(void) {
     // rie1: didn't receive start of packet before rx_guard, abort
     // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_RIE1);
     set_slot_state(STATE_SLEEP);
 
-    mr_scheduler_stats_register_used_slot(false);
+    mr_stats_inc(MARI_STATS_RX_NO_FRAME);
+    mr_scheduler_stats_register(MARI_CELL_STATS_RX_TIMEOUT);
+    update_link_stats(mac_vars.current_slot_info.type, mr_scheduler_get_current_cell_index(), NULL);
+    update_serving_link(mac_vars.current_slot_info.type, NULL);
+    update_join_contention(mac_vars.current_slot_info.type, MARI_SHARED_SLOT_IDLE);
 
     // cancel timer for rx_max (rie2)
     mr_timer_hf_cancel(MARI_TIMER_DEV, MARI_TIMER_CHANNEL_3);
@@ -573,59 +693,193 @@ static void activity_rie1(void) {
 static void activity_ri4(uint32_t ts) {
     // ri4: all fine, finished rx, cancel error timers and go to sleep
     // called by: radio isr
+    // only takes what the next frame would overwrite, and fixes the drift: the stats and the packet itself are handled in the bottom half
+    MR_PROFILE_SCOPE(MARI_PROFILE_RI4);
     set_slot_state(STATE_SLEEP);
 
     // cancel timer for rx_max (rie2)
     mr_timer_hf_cancel(MARI_TIMER_DEV, MARI_TIMER_CHANNEL_3);
 
-    if (!mr_radio_pending_rx_read()) {
-        // no packet received
-        end_slot();
-        return;
+    mr_received_packet_t *received = &mac_vars.received_packet;
+    received->status               = MARI_RX_NO_FRAME;
+    received->slot_type            = mac_vars.current_slot_info.type;
+    received->cell_index           = mr_scheduler_get_current_cell_index();
+    received->channel              = mac_vars.current_slot_info.channel;
+    received->rssi                 = mr_radio_rssi();
+    received->end_ts               = ts;
+    received->asn                  = mac_vars.asn;
+    received->src                  = 0;
+    received->packet               = NULL;
+    received->packet_len           = 0;
+
+    if (mr_radio_pending_rx_read()) {
+        uint8_t            *packet = mr_radio_get_rx_packet_ptr(&received->packet_len);
+        mr_packet_header_t *header = (mr_packet_header_t *)packet;
+        received->status           = MARI_RX_FOREIGN;
+        if (header->version == MARI_PROTOCOL_VERSION) {
+            received->status = MARI_RX_FRAME;
+            received->src    = header->src;
+            // with the pool exhausted, the frame is in the radio buffer, which the next frame overwrites: it only counts in the stats
+            received->packet = mac_vars.rx_buffer != NULL ? packet : NULL;
+
+            if (mari_get_node_type() == MARI_NODE && mr_assoc_is_joined() && header->src == mac_vars.synced_gateway) {
+                // only fix drift if the packet comes from the gateway we are synced to
+                // NOTE: this should ideally be done at ri3 (when the packet starts), but we don't have the id there.
+                //       could use use the physical BLE address for that?
+                fix_drift(received->start_ts);
+            }
+        }
     }
 
-    mr_radio_get_rx_packet(mac_vars.received_packet.packet, &mac_vars.received_packet.packet_len);
+    if (defer_received_packet() && received->packet != NULL) {
+        // the buffer now belongs to the bottom half, take another one for the next frame
+        mac_vars.rx_buffer = NULL;
+        mr_radio_set_rx_buffer(NULL);
+    }
 
-    mr_packet_header_t *header = (mr_packet_header_t *)mac_vars.received_packet.packet;
+    end_slot();
+}
 
-    if (header->version != MARI_PROTOCOL_VERSION) {
-        end_slot();
-        return;
+static void activity_rie2(void) {
+    // rie2: something went wrong, stayed in rx for too long, abort
+    // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_RIE2);
+    mr_stats_inc(MARI_STATS_RX_TOO_LONG);
+    mr_scheduler_stats_register(MARI_CELL_STATS_RX_TIMEOUT);
+    if (mac_vars.state == STATE_RX_DATA && mac_vars.current_slot_info.type == SLOT_TYPE_SHARED_UPLINK) {
+        // a frame started but was never decoded: most likely several nodes transmitted at once
+        mr_scheduler_stats_register(MARI_CELL_STATS_COLLISION);
     }
+    update_link_stats(mac_vars.current_slot_info.type, mr_scheduler_get_current_cell_index(), NULL);
+    update_serving_link(mac_vars.current_slot_info.type, NULL);
+    update_join_contention(mac_vars.current_slot_info.type, MARI_SHARED_SLOT_COLLISION);
+    set_slot_state(STATE_SLEEP);
 
-    if (mari_get_node_type() == MARI_NODE && mr_assoc_is_joined() && header->src == mac_vars.synced_gateway) {
-        // only fix drift if the packet comes from the gateway we are synced to
-        // NOTE: this should ideally be done at ri3 (when the packet starts), but we don't have the id there.
-        //       could use use the physical BLE address for that?
-        fix_drift(mac_vars.received_packet.start_ts);
+    end_slot();
+}
+
+static void arm_rx_buffer(void) {
+    // keep the buffer of the previous slot if nothing was received in it
+    if (mac_vars.rx_buffer == NULL) {
+        mac_vars.rx_buffer = mr_rx_pool_alloc();
     }
+    // with the pool exhausted, frames are still received in the radio buffer, for synchronization, but dropped
+    mr_radio_set_rx_buffer(mac_vars.rx_buffer != NULL ? mac_vars.rx_buffer->pdu : NULL);
+}
 
-    // now that we know it's a mari packet, store some info about it
-    mac_vars.received_packet.channel = mac_vars.current_slot_info.channel;
-    mac_vars.received_packet.rssi    = mr_radio_rssi();
-    mac_vars.received_packet.end_ts  = ts;
-    mac_vars.received_packet.asn     = mac_vars.asn;
+// returns false if the frame was dropped, in which case its buffer, if any, is kept for the next frame
+static bool defer_received_packet(void) {
+    uint8_t head = mac_vars.rx_deferred_head;
+    if ((uint8_t)(head - mac_vars.rx_deferred_tail) >= MARI_RX_DEFERRED_QUEUE_SIZE) {
+        // the bottom half is late, e.g. held up by the application callback
+        mac_vars.rx_deferred_dropped++;
+        mr_stats_inc(MARI_STATS_RX_LATE);
+        return false;
+    }
+
+    // only the info about the frame is copied, the frame itself stays in its buffer
+    mac_vars.rx_deferred[head % MARI_RX_DEFERRED_QUEUE_SIZE] = mac_vars.received_packet;
 
-    header->stats.rssi = mr_radio_rssi();
+    __DMB();  // the entry must be written before the bottom half can see it
+    mac_vars.rx_deferred_head = head + 1;
+    mr_swi_trigger();
+    return true;
+}
 
-    mr_handle_packet(mac_vars.received_packet.packet, mac_vars.received_packet.packet_len);
+static void isr_mac_rx_bottom_half(void) {
+    // runs below the radio and timer isr priorities, which can preempt it at any time:
+    // the schedule, cells and join responses it shares with them are changed in critical sections, see critical.h
+    uint32_t start_ts = mr_timer_hf_now(MARI_TIMER_DEV);
+
+    while (mac_vars.rx_deferred_tail != mac_vars.rx_deferred_head) {
+        __DMB();
+        mr_received_packet_t *received = &mac_vars.rx_deferred[mac_vars.rx_deferred_tail % MARI_RX_DEFERRED_QUEUE_SIZE];
+        register_reception(received);
+        if (received->packet != NULL) {
+            ((mr_packet_header_t *)received->packet)->stats.rssi = received->rssi;
+            mr_handle_packet(received);
+            // the events that refer to the packet hold their own reference to its buffer
+            mr_rx_pool_release(received->packet);
+        }
+        mac_vars.rx_deferred_tail++;
+    }
 
-    end_slot();
+    uint32_t duration_us = mr_timer_hf_now(MARI_TIMER_DEV) - start_ts;
+    if (duration_us > mac_vars.rx_bottom_half_max_us) {
+        mac_vars.rx_bottom_half_max_us = duration_us;
+    }
 }
 
-static void activity_rie2(void) {
-    // rie2: something went wrong, stayed in rx for too long, abort
-    // called by: timer isr
-    set_slot_state(STATE_SLEEP);
+// the stats of a slot that ended with a frame, or something that looked like one
+static void register_reception(const mr_received_packet_t *received) {
+    // the timer isr registers the slots that ended without a frame, and reads the links and the join contention
+    uint32_t primask = mr_critical_enter();
+    switch (received->status) {
+        case MARI_RX_NO_FRAME:
+            mr_scheduler_stats_register_cell(received->cell_index, MARI_CELL_STATS_RX_TIMEOUT);
+            update_link_stats(received->slot_type, received->cell_index, NULL);
+            update_serving_link(received->slot_type, NULL);
+            update_join_contention(received->slot_type, MARI_SHARED_SLOT_IDLE);
+            break;
+        case MARI_RX_FOREIGN:
+            update_link_stats(received->slot_type, received->cell_index, NULL);
+            update_serving_link(received->slot_type, NULL);
+            update_join_contention(received->slot_type, MARI_SHARED_SLOT_COLLISION);
+            break;
+        case MARI_RX_FRAME:
+            mr_scheduler_stats_register_cell(received->cell_index, MARI_CELL_STATS_RX);
+            update_link_stats(received->slot_type, received->cell_index, received);
+            update_serving_link(received->slot_type, received);
+            update_join_contention(received->slot_type, MARI_SHARED_SLOT_SUCCESS);
+            break;
+    }
+    mr_critical_exit(primask);
+}
 
-    end_slot();
+// received is NULL if nothing was heard from the node of the cell
+static void update_link_stats(slot_type_t slot_type, uint16_t cell_id, const mr_received_packet_t *received) {
+    // only the gateway tracks links, and only in uplink cells assigned to a node
+    schedule_t *schedule = mr_scheduler_get_active_schedule_ptr();
+    if (mari_get_node_type() != MARI_GATEWAY || slot_type != SLOT_TYPE_UPLINK || cell_id >= schedule->n_cells) {
+        return;
+    }
+    uint64_t node_id = schedule->cells[cell_id].assigned_node_id;
+    if (node_id == 0) {
+        return;
+    }
+
+    if (received != NULL && received->src == node_id) {
+        mr_link_gateway_register_rx(cell_id, node_id, received->rssi, received->asn);
+    } else {
+        mr_link_gateway_register_miss(cell_id, node_id);
+    }
+}
+
+// received is NULL if nothing was heard in the slot
+static void update_serving_link(slot_type_t slot_type, const mr_received_packet_t *received) {
+    // the node tracks the gateway it is joined to, which sends a beacon in every beacon slot
+    if (mari_get_node_type() != MARI_NODE || !mr_assoc_is_joined()) {
+        return;
+    }
+    bool is_beacon = slot_type == SLOT_TYPE_BEACON;
+    if (received != NULL && received->src == mac_vars.synced_gateway) {
+        mr_link_node_register_rx(is_beacon, received->rssi);
+    } else if (is_beacon) {
+        mr_link_node_register_miss();
+    }
+}
+
+static void update_join_contention(slot_type_t slot_type, mr_shared_slot_outcome_t outcome) {
+    // the gateway estimates how many nodes are contending for the shared uplink slots, and advertises it in the beacons
+    if (mari_get_node_type() != MARI_GATEWAY || slot_type != SLOT_TYPE_SHARED_UPLINK) {
+        return;
+    }
+    mr_assoc_gateway_register_shared_slot(outcome);
 }
 
 static void fix_drift(uint32_t ts) {
     DEBUG_GPIO_SPIIKE(&pin1);
-    uint32_t time_cpu_periph = 59;  // got this value by looking at the logic analyzer
-
-    uint32_t expected_ts     = mac_vars.start_slot_ts + slot_durations.tx_offset + time_cpu_periph;
+    uint32_t expected_ts     = mac_vars.start_slot_ts + slot_durations.tx_offset + MARI_RX_START_FRAME_DELAY_US;
     int32_t  clock_drift     = ts - expected_ts;
     uint32_t abs_clock_drift = abs(clock_drift);
 
@@ -638,6 +892,7 @@ static void fix_drift(uint32_t ts) {
             clock_drift);
     } else {
         // drift is too high, need to re-sync
+        mr_stats_inc(MARI_STATS_DRIFT_RESYNCS);
         // FIXME: use `mr_assoc_node_handle_immediate_disconnect` instead
         mr_event_data_t event_data = { .data.gateway_info.gateway_id = mac_vars.synced_gateway, .tag = MARI_OUT_OF_SYNC };
         mac_vars.mari_event_callback(MARI_DISCONNECTED, event_data);
@@ -661,7 +916,7 @@ static bool select_gateway_for_handover(uint32_t now_ts, mr_channel_info_t *sele
         return false;
     }
 
-    if (selected_gateway->rssi < (mac_vars.received_packet.rssi + MARI_HANDOVER_RSSI_HYSTERESIS)) {
+    if (selected_gateway->rssi < (mr_link_node_get_rssi() + MARI_HANDOVER_RSSI_HYSTERESIS)) {
         // the new gateway is not strong enough, ignore it
         return false;
     }
@@ -676,16 +931,33 @@ static bool select_gateway_for_handover(uint32_t now_ts, mr_channel_info_t *sele
 }
 
 static void handle_bg_scan_and_trigger_handover(uint32_t now_ts) {
+    if (mac_vars.handover_first_asn != 0) {
+        // a pre-join is already planned
+        return;
+    }
+
     mr_channel_info_t selected_gateway = { 0 };
     if (!select_gateway_for_handover(now_ts, &selected_gateway)) {
         // no handover, stop here
         return;
     }
 
+    if (now_ts - selected_gateway.timestamp > MARI_HANDOVER_MAX_BEACON_AGE_US) {
+        // the beacon is too old to find the slots of the new gateway, wait for the next background scan to hear a fresh one
+        return;
+    }
+
     // debug: show that a handover is going to happen
     DEBUG_GPIO_SET(&pin3);
     DEBUG_GPIO_CLEAR(&pin3);
+    mr_stats_inc(MARI_STATS_HANDOVERS);
+
+    if (MARI_ENABLE_MAKE_BEFORE_BREAK && handover_plan_pre_join(&selected_gateway)) {
+        // stay with the current gateway until the target gateway has given us a cell
+        return;
+    }
 
+    // no way to pre-join the target gateway: leave the current one, then sync and join as after a scan
     // a handover is going to happen, have the association module handle the disconnection event
     mr_assoc_node_handle_immediate_disconnect(MARI_HANDOVER);
     // during handover, we don't want the inter slot timer to tick again before we finish sync, so just set if far away in the future
@@ -698,7 +970,7 @@ static void handle_bg_scan_and_trigger_handover(uint32_t now_ts) {
     uint32_t handover_time_correction_us = 206;  // magic number: measured using the logic analyzer
     if (sync_to_gateway(now_ts, &selected_gateway, handover_time_correction_us)) {
         // found a gateway and synchronized to it
-        mr_assoc_node_handle_synced();
+        mr_assoc_node_handle_synced(selected_gateway.beacon.join_backlog);
     } else {
         // failed to synchronize to a gateway, back to scanning
         mr_assoc_node_handle_immediate_disconnect(MARI_HANDOVER_FAILED);
@@ -707,6 +979,281 @@ static void handle_bg_scan_and_trigger_handover(uint32_t now_ts) {
     }
 }
 
+// --------------------- make-before-break handover --------
+//
+// The node pre-joins the target gateway in a shared uplink slot of the target that is followed by a downlink slot,
+// where the join response is sent. The slots of the current gateway that overlap these two are reserved, and the
+// radio follows the slot grid of the target during them. The node keeps its cell at the current gateway until it
+// gets a cell at the target, then switches at the end of that downlink slot. If the pre-join fails, the node simply
+// stays with the current gateway, which is tried again after the next background scan.
+// NOTE: the current gateway is not told, there is no frame to leave a gateway and, once switched, the node no longer
+//       follows its slots. It keeps the cell of the node for MARI_MAX_SLOTFRAMES_NO_RX_LEAVE slotframes, then releases it.
+
+// the slots of a gateway, as heard in its beacon: the beacon is sent in the slot before beacon.asn
+static uint32_t handover_target_slot_ts(uint64_t target_asn) {
+    uint32_t beacon_slot_ts = mac_vars.handover_target.timestamp - slot_durations.tx_offset - MARI_RX_START_FRAME_DELAY_US;
+    return beacon_slot_ts + (uint32_t)(target_asn - (mac_vars.handover_target.beacon.asn - 1)) * slot_durations.whole_slot;
+}
+
+static bool handover_plan_pre_join(mr_channel_info_t *target) {
+    schedule_t *schedule = mr_scheduler_get_schedule_ptr(target->beacon.active_schedule_id);
+    if (schedule == NULL) {
+        return false;
+    }
+    mac_vars.handover_target = *target;
+
+    // the current slot is mac_vars.asn - 1, leave one more slot before the reserved ones
+    uint64_t first_usable_asn = mac_vars.asn + 1;
+    uint32_t first_usable_ts  = mac_vars.start_slot_ts + 2 * slot_durations.whole_slot;
+
+    // first slot of the target that starts after first_usable_ts
+    uint32_t beacon_slot_ts = handover_target_slot_ts(target->beacon.asn - 1);
+    uint64_t target_asn     = target->beacon.asn - 1 + (first_usable_ts - beacon_slot_ts + slot_durations.whole_slot - 1) / slot_durations.whole_slot;
+
+    for (size_t i = 0; i < schedule->n_cells; i++, target_asn++) {
+        cell_t cell      = schedule->cells[target_asn % schedule->n_cells];
+        cell_t next_cell = schedule->cells[(target_asn + 1) % schedule->n_cells];
+        if (cell.type != SLOT_TYPE_SHARED_UPLINK || next_cell.type != SLOT_TYPE_DOWNLINK) {
+            continue;
+        }
+
+        // slots of the current gateway overlapping the two slots of the target
+        uint32_t target_ts = handover_target_slot_ts(target_asn);
+        if (target_ts + 2 * slot_durations.whole_slot - target->timestamp > MARI_HANDOVER_MAX_BEACON_AGE_US) {
+            // the later slots drift too far from the beacon
+            return false;
+        }
+        uint64_t first_reserved = first_usable_asn + (target_ts - first_usable_ts) / slot_durations.whole_slot;
+        bool     uses_own_cell  = false;
+        for (uint64_t asn = first_reserved; asn < first_reserved + MARI_HANDOVER_RESERVED_SLOTS; asn++) {
+            cell_t reserved = mr_scheduler_node_peek_slot(asn);
+            uses_own_cell |= reserved.type == SLOT_TYPE_UPLINK && reserved.assigned_node_id == mac_vars.device_id;
+        }
+        if (uses_own_cell) {
+            // keep sending in our own cell, so that the current gateway does not drop us in case the pre-join fails
+            continue;
+        }
+
+        mac_vars.handover_first_asn  = first_reserved;
+        mac_vars.handover_target_asn = target_asn;
+        mac_vars.handover_target_ts  = target_ts;
+        return true;
+    }
+    return false;
+}
+
+static bool handover_slot_is_reserved(uint64_t asn) {
+    return mac_vars.handover_first_asn != 0 && asn >= mac_vars.handover_first_asn && asn < mac_vars.handover_first_asn + MARI_HANDOVER_RESERVED_SLOTS;
+}
+
+static void activity_hi1(void) {
+    // hi1: first reserved slot, wait for the shared uplink slot of the target gateway
+    // called by: function new_slot_synced
+    MR_PROFILE_SCOPE(MARI_PROFILE_HI1);
+    set_slot_state(STATE_SLEEP);
+    mac_vars.is_bg_scanning = false;
+    disable_radio_and_intra_slot_timers();
+
+    int32_t since_target_ts = (int32_t)(mr_timer_hf_now(MARI_TIMER_DEV) - mac_vars.handover_target_ts);
+    if (since_target_ts >= (int32_t)slot_durations.tx_offset) {
+        // too late to send the join request in the slot of the target gateway
+        activity_hie1();
+        return;
+    }
+    if (since_target_ts >= 0) {
+        // the slot of the target gateway began together with this one, there is still time until tx_offset
+        activity_hi2();
+        return;
+    }
+    mr_timer_hf_set_oneshot_with_ref_diff_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_CHANNEL_3,
+        mac_vars.handover_target_ts,
+        0,
+        &activity_hi2);
+}
+
+static void activity_hi2(void) {
+    // hi2: the shared uplink slot of the target gateway begins, arm tx timers and prepare the join request
+    // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_HI2);
+    set_slot_state(STATE_HANDOVER_TX_OFFSET);
+
+    uint8_t packet[MARI_PACKET_MAX_SIZE];
+    uint8_t packet_len = mr_build_packet_join_request(packet, mac_vars.handover_target.beacon.src);
+
+    mr_timer_hf_set_oneshot_with_ref_diff_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_CHANNEL_1,
+        mac_vars.handover_target_ts,
+        slot_durations.tx_offset,
+        &activity_hi3);
+
+    mr_timer_hf_set_oneshot_with_ref_diff_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_CHANNEL_2,
+        mac_vars.handover_target_ts,
+        slot_durations.tx_offset + slot_durations.tx_max,
+        &activity_hie1);
+
+    schedule_t *schedule = mr_scheduler_get_schedule_ptr(mac_vars.handover_target.beacon.active_schedule_id);
+    cell_t      cell     = schedule->cells[mac_vars.handover_target_asn % schedule->n_cells];
+    mr_radio_disable();
+    mr_radio_set_channel(mr_scheduler_get_channel(cell.type, mac_vars.handover_target_asn, cell.channel_offset));
+    mr_radio_tx_prepare(packet, packet_len);
+}
+
+static void activity_hi3(void) {
+    // hi3: tx of the join request actually begins
+    // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_HI3);
+    set_slot_state(STATE_HANDOVER_TX_DATA);
+
+    mr_radio_tx_dispatch();
+}
+
+static void activity_hi4(void) {
+    // hi4: join request sent, arm rx timers for the downlink slot of the target gateway
+    // called by: radio isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_HI4);
+    set_slot_state(STATE_HANDOVER_RX_OFFSET);
+
+    // cancel the tx error timer (hie1)
+    mr_timer_hf_cancel(MARI_TIMER_DEV, MARI_TIMER_CHANNEL_2);
+    mr_radio_disable();
+
+    uint32_t downlink_ts = mac_vars.handover_target_ts + slot_durations.whole_slot;
+
+    mr_timer_hf_set_oneshot_with_ref_diff_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_CHANNEL_1,
+        downlink_ts,
+        slot_durations.rx_offset,
+        &activity_hi5);
+
+    mr_timer_hf_set_oneshot_with_ref_diff_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_CHANNEL_2,
+        downlink_ts,
+        slot_durations.tx_offset + slot_durations.rx_guard,
+        &activity_hie1);
+
+    mr_timer_hf_set_oneshot_with_ref_diff_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_CHANNEL_3,
+        downlink_ts,
+        slot_durations.rx_offset + slot_durations.rx_max,
+        &activity_hie1);
+}
+
+static void activity_hi5(void) {
+    // hi5: listen for the join response
+    // called by: timer isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_HI5);
+    set_slot_state(STATE_HANDOVER_RX_DATA_LISTEN);
+
+    schedule_t *schedule     = mr_scheduler_get_schedule_ptr(mac_vars.handover_target.beacon.active_schedule_id);
+    uint64_t    downlink_asn = mac_vars.handover_target_asn + 1;
+    cell_t      cell         = schedule->cells[downlink_asn % schedule->n_cells];
+    mr_radio_disable();
+    mr_radio_set_channel(mr_scheduler_get_channel(cell.type, downlink_asn, cell.channel_offset));
+    mr_radio_rx();
+}
+
+static void activity_hi6(uint32_t ts) {
+    // hi6: a packet started to arrive
+    // called by: radio isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_HI6);
+    set_slot_state(STATE_HANDOVER_RX_DATA);
+
+    // cancel timer for rx_guard
+    mr_timer_hf_cancel(MARI_TIMER_DEV, MARI_TIMER_CHANNEL_2);
+
+    mac_vars.received_packet.start_ts = ts;
+}
+
+static void activity_hi7(void) {
+    // hi7: finished rx, switch to the target gateway if it gave us a cell
+    // called by: radio isr
+    MR_PROFILE_SCOPE(MARI_PROFILE_HI7);
+
+    // cancel timer for rx_max
+    mr_timer_hf_cancel(MARI_TIMER_DEV, MARI_TIMER_CHANNEL_3);
+
+    if (!mr_radio_pending_rx_read()) {
+        activity_hie1();
+        return;
+    }
+
+    uint8_t packet[MARI_PACKET_MAX_SIZE];
+    uint8_t packet_len;
+    mr_radio_get_rx_packet(packet, &packet_len);
+
+    mr_packet_header_t *header  = (mr_packet_header_t *)packet;
+    int16_t             cell_id = -1;
+    if (packet_len >= sizeof(mr_packet_header_t) && header->version == MARI_PROTOCOL_VERSION && header->type == MARI_PACKET_JOIN_RESPONSE && header->src == mac_vars.handover_target.beacon.src) {
+        cell_id = mr_packet_join_response_find_cell(packet, packet_len, mac_vars.device_id);
+    }
+    if (cell_id < 0) {
+        // lost in a collision, or the target gateway is full
+        activity_hie1();
+        return;
+    }
+
+    mac_vars.received_packet.rssi = mr_radio_rssi();
+    mr_assoc_node_set_groups(mr_assoc_node_get_groups() | mr_packet_join_response_get_groups(packet, packet_len));
+    handover_switch(cell_id, mac_vars.received_packet.start_ts);
+}
+
+static void activity_hie1(void) {
+    // hie1: the pre-join failed, stay with the current gateway
+    // called by: timer or radio isr
+    // NOTE: the remaining reserved slots are left unused
+    MR_PROFILE_SCOPE(MARI_PROFILE_HIE1);
+    mr_stats_inc(MARI_STATS_HANDOVERS_FAILED);
+    set_slot_state(STATE_SLEEP);
+    disable_radio_and_intra_slot_timers();
+}
+
+static void handover_switch(int16_t cell_id, uint32_t ts) {
+    uint64_t old_gateway = mac_vars.synced_gateway;
+
+    set_slot_state(STATE_SLEEP);
+    disable_radio_and_intra_slot_timers();
+
+    // move to the schedule of the target gateway, in the cell it gave us
+    mr_scheduler_node_deassign_myself_from_schedule();
+    if (!mr_scheduler_set_schedule(mac_vars.handover_target.beacon.active_schedule_id) || !mr_scheduler_node_assign_myself_to_cell(cell_id)) {
+        mr_assoc_node_handle_immediate_disconnect(MARI_HANDOVER_FAILED);
+        node_back_to_scanning();
+        return;
+    }
+
+    mac_vars.synced_gateway     = mac_vars.handover_target.beacon.src;
+    mac_vars.synced_network_id  = mac_vars.handover_target.beacon.network_id;
+    mac_vars.synced_ts          = ts;
+    mac_vars.asn                = mac_vars.handover_target_asn + 2;
+    mac_vars.handover_first_asn = 0;
+    mr_link_node_reset();
+    mr_link_node_register_rx(false, mac_vars.received_packet.rssi);  // the join response is the first frame from the new gateway
+
+    // the join response gives the exact timing of the target gateway, its next slot starts one slot after this one
+    // NOTE: re-arming the periodic timer also drops what is left of the current slot of the old gateway
+    uint32_t switch_ts = ts - slot_durations.tx_offset - MARI_RX_START_FRAME_DELAY_US + slot_durations.whole_slot;
+    uint32_t now_ts    = mr_timer_hf_now(MARI_TIMER_DEV);
+    mr_timer_hf_set_periodic_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_INTER_SLOT_CHANNEL,
+        slot_durations.whole_slot,
+        &new_slot_synced);
+    mr_timer_hf_adjust_periodic_us(
+        MARI_TIMER_DEV,
+        MARI_TIMER_INTER_SLOT_CHANNEL,
+        (int32_t)(switch_ts - now_ts - slot_durations.whole_slot));
+
+    mr_assoc_node_handle_handover(old_gateway, mac_vars.synced_gateway);
+}
+
 // --------------------- scan activities ------------------
 
 static void handle_scan_and_trigger_association(uint32_t now_ts) {
@@ -719,7 +1266,7 @@ static void handle_scan_and_trigger_association(uint32_t now_ts) {
 
     if (sync_to_gateway(now_ts, &selected_gateway, 0)) {
         // successfully synchronized to a gateway
-        mr_assoc_node_handle_synced();
+        mr_assoc_node_handle_synced(selected_gateway.beacon.join_backlog);
     } else {
         // failed to synchronize to a gateway, back to scanning
         start_scan();
@@ -727,6 +1274,7 @@ static void handle_scan_and_trigger_association(uint32_t now_ts) {
 }
 
 static void activity_scan_dispatch_new_schedule(void) {
+    MR_PROFILE_SCOPE(MARI_PROFILE_SCAN_NEW_SCHEDULE);
     mr_timer_hf_set_periodic_us(
         MARI_TIMER_DEV,
         MARI_TIMER_INTER_SLOT_CHANNEL,
@@ -743,6 +1291,8 @@ static bool sync_to_gateway(uint32_t now_ts, mr_channel_info_t *selected_gateway
     mac_vars.synced_gateway    = selected_gateway->beacon.src;
     mac_vars.synced_network_id = selected_gateway->beacon.network_id;
     mac_vars.synced_ts         = now_ts;
+    mr_link_node_reset();
+    mr_link_node_register_rx(true, selected_gateway->rssi);
 
     // the selected gateway may have been scanned a few slot_durations ago, so we need to account for that difference
     // NOTE: this assumes that the slot duration is the same for gateways and nodes
@@ -774,6 +1324,7 @@ static bool sync_to_gateway(uint32_t now_ts, mr_channel_info_t *selected_gateway
 }
 
 static void activity_scan_start_frame(uint32_t ts) {
+    MR_PROFILE_SCOPE(MARI_PROFILE_SCAN_START_FRAME);
     set_slot_state(STATE_RX_DATA);
     mac_vars.current_scan_item_ts = ts;
 
@@ -781,11 +1332,12 @@ static void activity_scan_start_frame(uint32_t ts) {
 }
 
 static void activity_scan_end_frame(uint32_t end_frame_ts) {
+    MR_PROFILE_SCOPE(MARI_PROFILE_SCAN_END_FRAME);
     uint8_t packet[MARI_PACKET_MAX_SIZE];
     uint8_t packet_len;
     mr_radio_get_rx_packet(packet, &packet_len);
 
-    mr_assoc_handle_beacon(packet, packet_len, MARI_FIXED_SCAN_CHANNEL, mac_vars.current_scan_item_ts);
+    mr_assoc_handle_beacon(packet, packet_len, MARI_FIXED_SCAN_CHANNEL, mac_vars.current_scan_item_ts, mr_radio_rssi());
 
     // if there is still enough time before end of scan, re-enable the radio
     bool still_time_for_rx_scan    = mac_vars.is_scanning && (end_frame_ts + MARI_BEACON_TOA_WITH_PADDING < mac_vars.scan_expected_end_ts);
@@ -820,6 +1372,9 @@ static void isr_mac_radio_start_frame(uint32_t ts) {
         case STATE_RX_DATA_LISTEN:
             activity_ri3(ts);
             break;
+        case STATE_HANDOVER_RX_DATA_LISTEN:
+            activity_hi6(ts);
+            break;
         default:
             break;
     }
@@ -830,17 +1385,28 @@ static void isr_mac_radio_end_frame(uint32_t ts) {
 
     if (mac_vars.is_scanning || mac_vars.is_bg_scanning) {
         activity_scan_end_frame(ts);
-        return;
+    } else {
+        switch (mac_vars.state) {
+            case STATE_TX_DATA:
+                activity_ti3();
+                break;
+            case STATE_RX_DATA:
+                activity_ri4(ts);
+                break;
+            case STATE_HANDOVER_TX_DATA:
+                activity_hi4();
+                break;
+            case STATE_HANDOVER_RX_DATA:
+                activity_hi7();
+                break;
+            default:
+                break;
+        }
     }
 
-    switch (mac_vars.state) {
-        case STATE_TX_DATA:
-            activity_ti3();
-            break;
-        case STATE_RX_DATA:
-            activity_ri4(ts);
-            break;
-        default:
-            break;
+    // ts is taken when the radio isr starts
+    uint32_t duration_us = mr_timer_hf_now(MARI_TIMER_DEV) - ts;
+    if (duration_us > mac_vars.radio_isr_max_us) {
+        mac_vars.radio_isr_max_us = duration_us;
     }
 }
@@ -17,6 +17,7 @@
 #include <nrf.h>
 
 #include "models.h"
+#include "occupancy.h"
 
 //=========================== defines ==========================================
 
@@ -40,8 +41,8 @@
 #define MARI_PACKET_TOA_WITH_PADDING (MARI_PACKET_TOA + 120)                             // Add padding based on experiments. Also, it takes 28 us until event ADDRESS is triggered (when the packet actually starts traveling over the air)
 
 // Duration of some packets
-#define MARI_BEACON_TOA              (BLE_2M_US_PER_BYTE * sizeof(mr_beacon_packet_header_t))  // Time on air for the beacon packet
-#define MARI_BEACON_TOA_WITH_PADDING (MARI_BEACON_TOA + 60)                                    // Add padding based on experiments.
+#define MARI_BEACON_TOA              (BLE_2M_US_PER_BYTE * (sizeof(mr_beacon_packet_header_t) + MARI_DOWNLINK_PENDING_MAX_LEN + MARI_OCCUPANCY_MAX_LEN))  // Time on air for the longest beacon packet
+#define MARI_BEACON_TOA_WITH_PADDING (MARI_BEACON_TOA + 60)                                                                                     // Add padding based on experiments.
 
 #define MARI_WHOLE_SLOT_DURATION (MARI_TS_TX_OFFSET + MARI_PACKET_TOA_WITH_PADDING + MARI_END_GUARD_TIME)  // Complete slot duration
 
@@ -85,4 +86,9 @@ uint64_t mr_mac_get_asn(void);
 uint32_t mr_mac_get_tiner_value(void);
 bool     mr_mac_node_is_synced(void);
 
+// worst-case durations, in microseconds, of the radio isr at the end of a frame and of the bottom half that handles the frame
+uint32_t mr_mac_get_radio_isr_max_us(void);
+uint32_t mr_mac_get_rx_bottom_half_max_us(void);
+uint32_t mr_mac_get_rx_deferred_dropped(void);
+
 #endif  // __MAC_H
@@ -23,7 +23,11 @@
 #include "scheduler.h"
 #include "association.h"
 #include "queue.h"
-#include "bloom.h"
+#include "occupancy.h"
+#include "link.h"
+#include "events.h"
+#include "stats.h"
+#include "profile.h"
 #include "mari.h"
 
 //=========================== defines ==========================================
@@ -56,10 +60,15 @@ void mari_init(mr_node_type_t node_type, uint16_t net_id, schedule_t *app_schedu
     mr_rng_init();
 
     // initialize stateful mari modules
+    mr_stats_init();
+    mr_profile_init();
+    mr_events_init();
+    mr_queue_init();
     mr_assoc_init(net_id, event_callback);
     mr_scheduler_init(app_schedule);
     if (node_type == MARI_GATEWAY) {
-        mr_bloom_gateway_init();
+        mr_occupancy_gateway_init();
+        mr_link_gateway_init();
     }
 
     if (node_type == MARI_GATEWAY) {
@@ -70,8 +79,45 @@ void mari_init(mr_node_type_t node_type, uint16_t net_id, schedule_t *app_schedu
     mr_mac_init(event_callback);
 }
 
-void mari_tx(uint8_t *packet, uint8_t length) {
-    mr_queue_add(packet, length);
+size_t mari_poll_events(mari_event_t *batch, size_t max_events) {
+    return mr_events_poll(batch, max_events);
+}
+
+void mari_release_event(const mari_event_t *event) {
+    mr_events_release(event);
+}
+
+uint32_t mari_get_dropped_events(void) {
+    return mr_events_get_dropped();
+}
+
+// returns false if the queue is full
+bool mari_tx(uint8_t *packet, uint8_t length) {
+    return mr_queue_add(packet, length);
+}
+
+// the packet is dropped if it could not be sent within ttl_ms, 0 to keep it until it is sent
+bool mari_tx_with_priority(uint8_t *packet, uint8_t length, mr_priority_t priority, uint32_t ttl_ms) {
+    if (priority >= MARI_N_PRIORITIES) {
+        return false;
+    }
+    uint64_t expiry_asn = 0;
+    if (ttl_ms > 0) {
+        expiry_asn = mr_mac_get_asn() + ((uint64_t)ttl_ms * 1000) / MARI_WHOLE_SLOT_DURATION;
+    }
+    return mr_queue_add_with_priority(packet, length, priority, expiry_asn);
+}
+
+uint32_t mari_get_expired_packets(void) {
+    return mr_queue_get_dropped_expired();
+}
+
+void mari_stats_snapshot(uint32_t *counters) {
+    mr_stats_snapshot(counters);
+}
+
+size_t mari_profile_snapshot(mr_profile_entry_t *entries) {
+    return mr_profile_snapshot(entries);
 }
 
 mr_node_type_t mari_get_node_type(void) {
@@ -92,12 +138,46 @@ size_t mari_gateway_count_nodes(void) {
     return mr_scheduler_gateway_get_nodes_count();
 }
 
+// a single downlink frame, received by all the nodes in the group
+// returns false if the group does not exist or the queue is full
+bool mari_gateway_tx_group(uint8_t group_id, uint8_t *payload, uint8_t payload_len) {
+    if (group_id >= MARI_N_GROUPS) {
+        return false;
+    }
+    uint8_t packet[MARI_PACKET_MAX_SIZE] = { 0 };
+    uint8_t len                          = mr_build_packet_data(packet, MARI_GROUP_ADDRESS(group_id), payload, payload_len);
+    return mr_queue_add(packet, len);
+}
+
+// returns false if the queue is full, the node then keeps its previous groups
+bool mari_gateway_set_node_groups(uint64_t node_id, uint32_t groups) {
+    uint8_t packet[MARI_PACKET_MAX_SIZE] = { 0 };
+    uint8_t len                          = mr_build_packet_group_config(packet, node_id, groups);
+    return mr_queue_add_with_priority(packet, len, MARI_PRIORITY_HIGH, 0);
+}
+
+void mari_gateway_set_join_groups(uint32_t groups) {
+    mr_assoc_gateway_set_join_groups(groups);
+}
+
 // -------- node ----------
 
-void mari_node_tx_payload(uint8_t *payload, uint8_t payload_len) {
+// returns false if the queue is full
+bool mari_node_tx_payload(uint8_t *payload, uint8_t payload_len) {
+    uint8_t packet[MARI_PACKET_MAX_SIZE] = { 0 };
+    uint8_t len                          = mr_build_packet_data(packet, mari_node_gateway_id(), payload, payload_len);
+    return mr_queue_add(packet, len);
+}
+
+bool mari_node_tx_payload_with_priority(uint8_t *payload, uint8_t payload_len, mr_priority_t priority, uint32_t ttl_ms) {
     uint8_t packet[MARI_PACKET_MAX_SIZE] = { 0 };
     uint8_t len                          = mr_build_packet_data(packet, mari_node_gateway_id(), payload, payload_len);
-    mr_queue_add(packet, len);
+    return mari_tx_with_priority(packet, len, priority, ttl_ms);
+}
+
+// the value replaces the one in the mailbox, and is sent in the next uplink slot with nothing queued
+bool mari_node_set_mailbox(uint8_t mailbox_id, uint8_t *payload, uint8_t payload_len) {
+    return mr_queue_node_set_mailbox(mailbox_id, payload, payload_len);
 }
 
 bool mari_node_is_connected(void) {
@@ -108,23 +188,44 @@ uint64_t mari_node_gateway_id(void) {
     return mr_mac_get_synced_gateway();
 }
 
+void mari_node_join_group(uint8_t group_id) {
+    if (group_id < MARI_N_GROUPS) {
+        mr_assoc_node_set_groups(mr_assoc_node_get_groups() | (1UL << group_id));
+    }
+}
+
+void mari_node_leave_group(uint8_t group_id) {
+    if (group_id < MARI_N_GROUPS) {
+        mr_assoc_node_set_groups(mr_assoc_node_get_groups() & ~(1UL << group_id));
+    }
+}
+
+bool mari_node_is_in_group(uint8_t group_id) {
+    return group_id < MARI_N_GROUPS && mr_assoc_node_is_in_group(MARI_GROUP_ADDRESS(group_id));
+}
+
 //=========================== iternal api =====================================
 
 void mr_mari_force_gateway_startup_random_delay(void) {
     // in the gateway, defer the start of the MAC for a random time (between 0 and slotframe duration)
     // this is to avoid gateway-to-gateway mutual cancellation, in case all gateways start at the same time
-    uint8_t rng_value;
-    mr_rng_read_u8(&rng_value);
+    uint16_t rng_value;
+    mr_rng_read_u16(&rng_value);
     // restrict random value to slotframe slot count
-    uint8_t  random_slot_count = rng_value % mr_scheduler_get_active_schedule_slot_count();
+    uint16_t random_slot_count = rng_value % mr_scheduler_get_active_schedule_slot_count();
     uint32_t delay_us          = random_slot_count * MARI_WHOLE_SLOT_DURATION;
     mr_timer_hf_delay_us(MARI_TIMER_DEV, delay_us);
 }
 
-bool mr_handle_packet(uint8_t *packet, uint8_t length) {
+// called in the bottom half of the radio isr, asn is the slot the packet was received in
+bool mr_handle_packet(mr_received_packet_t *received) {
+    MR_PROFILE_SCOPE(MARI_PROFILE_HANDLE_PACKET);
+    uint8_t            *packet = received->packet;
+    uint8_t             length = received->packet_len;
     mr_packet_header_t *header = (mr_packet_header_t *)packet;
 
-    bool wrong_destination = header->dst != mr_device_id() && header->dst != MARI_BROADCAST_ADDRESS;
+    bool to_my_group       = mari_get_node_type() == MARI_NODE && mr_assoc_node_is_in_group(header->dst);
+    bool wrong_destination = header->dst != mr_device_id() && header->dst != MARI_BROADCAST_ADDRESS && !to_my_group;
     bool not_a_beacon      = header->type != MARI_PACKET_BEACON;
     if (wrong_destination && not_a_beacon) {
         return false;
@@ -143,17 +244,22 @@ bool mr_handle_packet(uint8_t *packet, uint8_t length) {
             {
                 // try to assign a cell to the node
                 // the asn-based keep-alive is also initialized
-                // the hashes h1 and h2 are also set
+                // the occupancy tag is also set
                 // NOTE: we accept re-joins because of possible collisions on the join response (downlink)
-                int16_t cell_id = mr_scheduler_gateway_assign_next_available_uplink_cell(header->src, mr_mac_get_asn());
+                int16_t cell_id = mr_scheduler_gateway_assign_next_available_uplink_cell(header->src, received->asn);
+                if (cell_id >= 0 && !mr_queue_set_join_response(header->src, cell_id)) {
+                    // no room for the response: the node will time out and try again, a new node must not keep the cell meanwhile
+                    if (!from_joined_node) {
+                        mr_scheduler_gateway_release_cell(cell_id);
+                    }
+                    return false;
+                }
                 if (cell_id >= 0) {
-                    // at the packet level, max_nodes is limited to 256 (using uint8_t cell_id)
-                    mr_queue_set_join_response(header->src, (uint8_t)cell_id);
-                    // set the dirty flag that will trigger the event loop to compute the bloom filter
-                    mr_bloom_gateway_set_dirty();
-                    _mari_vars.app_event_callback(MARI_NODE_JOINED, (mr_event_data_t){ .data.node_info.node_id = header->src });
+                    // set the dirty flag that will trigger the event loop to compute the occupancy
+                    mr_occupancy_gateway_set_dirty();
+                    event_callback(MARI_NODE_JOINED, (mr_event_data_t){ .data.node_info.node_id = header->src });
                 } else {
-                    _mari_vars.app_event_callback(MARI_ERROR, (mr_event_data_t){ .tag = MARI_GATEWAY_FULL });
+                    event_callback(MARI_ERROR, (mr_event_data_t){ .tag = MARI_GATEWAY_FULL });
                 }
                 break;
             }
@@ -171,8 +277,32 @@ bool mr_handle_packet(uint8_t *packet, uint8_t length) {
                         .payload     = packet + sizeof(mr_packet_header_t),
                         .payload_len = length - sizeof(mr_packet_header_t) }
                 };
-                _mari_vars.app_event_callback(MARI_NEW_PACKET, event_data);
-                mr_assoc_gateway_keep_node_alive(header->src, mr_mac_get_asn());  // keep track of when the last packet was received
+                event_callback(MARI_NEW_PACKET, event_data);
+                mr_assoc_gateway_keep_node_alive(header->src, received->asn);  // keep track of when the last packet was received
+                break;
+            }
+            case MARI_PACKET_DATA_AGGREGATED:
+            {
+                if (!from_joined_node) {
+                    // ignore packets from nodes that are not joined
+                    return false;
+                }
+                // split the frame back into the packets queued by the node
+                size_t   offset = 0;
+                uint16_t ordinal;
+                uint8_t  payload_len;
+                uint8_t *payload;
+                while ((payload = mr_packet_aggregated_next_record(packet, length, &offset, &ordinal, &payload_len)) != NULL) {
+                    mr_event_data_t event_data = {
+                        .data.new_packet = {
+                            .len         = sizeof(mr_packet_header_t) + payload_len,
+                            .header      = header,
+                            .payload     = payload,
+                            .payload_len = payload_len }
+                    };
+                    event_callback(MARI_NEW_PACKET, event_data);
+                }
+                mr_assoc_gateway_keep_node_alive(header->src, received->asn);  // keep track of when the last packet was received
                 break;
             }
             case MARI_PACKET_KEEPALIVE:
@@ -181,11 +311,11 @@ bool mr_handle_packet(uint8_t *packet, uint8_t length) {
                     // ignore packets from nodes that are not joined
                     return false;
                 }
-                mr_assoc_gateway_keep_node_alive(header->src, mr_mac_get_asn());  // keep track of when the last packet was received
+                mr_assoc_gateway_keep_node_alive(header->src, received->asn);  // keep track of when the last packet was received
                 mr_event_data_t event_data = {
                     .data.node_info = { .node_id = header->src }
                 };
-                _mari_vars.app_event_callback(MARI_KEEPALIVE, event_data);
+                event_callback(MARI_KEEPALIVE, event_data);
                 break;
             }
             default:
@@ -202,24 +332,29 @@ bool mr_handle_packet(uint8_t *packet, uint8_t length) {
 
         switch (header->type) {
             case MARI_PACKET_BEACON:
-                mr_assoc_handle_beacon(packet, length, MARI_FIXED_SCAN_CHANNEL, mr_mac_get_asn());
+                mr_assoc_handle_beacon(packet, length, MARI_FIXED_SCAN_CHANNEL, received->start_ts, received->rssi);
                 break;
             case MARI_PACKET_JOIN_RESPONSE:
             {
-                if (mr_assoc_get_state() != JOIN_STATE_JOINING) {
-                    // ignore if not in the JOINING state
+                if (mr_assoc_get_state() != JOIN_STATE_JOINING && mr_assoc_get_state() != JOIN_STATE_SYNCED) {
+                    // ignore if not trying to join
+                    // NOTE: a node back in the SYNCED state can still accept a response that came late
+                    return false;
+                }
+                if (header->src != mr_mac_get_synced_gateway()) {
+                    // ignore if not from the gateway I am trying to join
                     return false;
                 }
-                if (header->dst != mr_device_id()) {
-                    // ignore if not for me
+                int16_t cell_id = mr_packet_join_response_find_cell(packet, length, mr_device_id());
+                if (cell_id < 0) {
+                    // ignore if there is nothing for me
                     return false;
                 }
-                // the first byte after the header contains the cell_id
-                uint8_t cell_id = packet[sizeof(mr_packet_header_t)];
                 if (mr_scheduler_node_assign_myself_to_cell(cell_id)) {
+                    mr_assoc_node_set_groups(mr_assoc_node_get_groups() | mr_packet_join_response_get_groups(packet, length));
                     mr_assoc_node_handle_joined(header->src);
                 } else {
-                    _mari_vars.app_event_callback(MARI_ERROR, (mr_event_data_t){ 0 });
+                    event_callback(MARI_ERROR, (mr_event_data_t){ 0 });
                 }
                 break;
             }
@@ -237,8 +372,37 @@ bool mr_handle_packet(uint8_t *packet, uint8_t length) {
                         .payload     = packet + sizeof(mr_packet_header_t),
                         .payload_len = length - sizeof(mr_packet_header_t) }
                 };
-                _mari_vars.app_event_callback(MARI_NEW_PACKET, event_data);
-                mr_assoc_node_keep_gateway_alive(mr_mac_get_asn());
+                event_callback(MARI_NEW_PACKET, event_data);
+                mr_assoc_node_keep_gateway_alive(received->asn);
+                break;
+            }
+            case MARI_PACKET_DATA_AGGREGATED:
+            {
+                if (!from_my_joined_gateway) {
+                    // ignore data packets from other gateways
+                    return false;
+                }
+                // records are addressed by the ordinal of the uplink cell, pick the ones for me
+                int16_t  my_ordinal = mr_scheduler_node_get_uplink_ordinal();
+                size_t   offset     = 0;
+                uint16_t ordinal;
+                uint8_t  payload_len;
+                uint8_t *payload;
+                while ((payload = mr_packet_aggregated_next_record(packet, length, &offset, &ordinal, &payload_len)) != NULL) {
+                    if (my_ordinal < 0 || ordinal != (uint16_t)my_ordinal) {
+                        continue;
+                    }
+                    // the header is the one of the frame, the payload is within the frame
+                    mr_event_data_t event_data = {
+                        .data.new_packet = {
+                            .len         = sizeof(mr_packet_header_t) + payload_len,
+                            .header      = header,
+                            .payload     = payload,
+                            .payload_len = payload_len }
+                    };
+                    event_callback(MARI_NEW_PACKET, event_data);
+                }
+                mr_assoc_node_keep_gateway_alive(received->asn);
                 break;
             }
             case MARI_PACKET_KEEPALIVE:
@@ -246,8 +410,20 @@ bool mr_handle_packet(uint8_t *packet, uint8_t length) {
                     // ignore keep-alives from other gateways
                     return false;
                 }
-                mr_assoc_node_keep_gateway_alive(mr_mac_get_asn());
+                mr_assoc_node_keep_gateway_alive(received->asn);
+                break;
+            case MARI_PACKET_GROUP_CONFIG:
+            {
+                if (!from_my_joined_gateway || length < sizeof(mr_packet_header_t) + sizeof(uint32_t)) {
+                    return false;
+                }
+                // replaces the groups of the node, e.g. as decided by the host
+                uint32_t groups;
+                memcpy(&groups, packet + sizeof(mr_packet_header_t), sizeof(uint32_t));
+                mr_assoc_node_set_groups(groups);
+                mr_assoc_node_keep_gateway_alive(received->asn);
                 break;
+            }
             default:
                 break;
         }
@@ -260,7 +436,7 @@ void mari_event_loop(void) {
     // process the event loop
     switch (mari_get_node_type()) {
         case MARI_GATEWAY:
-            mr_bloom_gateway_event_loop();
+            mr_occupancy_gateway_event_loop();
             break;
         case MARI_NODE:
             break;
@@ -273,14 +449,16 @@ static void event_callback(mr_event_t event, mr_event_data_t event_data) {
     // handle some events internally
     switch (event) {
         case MARI_NODE_LEFT:
-            mr_bloom_gateway_set_dirty();
+            mr_occupancy_gateway_set_dirty();
             break;
         default:
             break;
     }
 
-    // forward the event to the application callback
+    // forward the event to the application callback, or queue it until the application polls it
     if (_mari_vars.app_event_callback) {
         _mari_vars.app_event_callback(event, event_data);
+    } else {
+        mr_events_push(event, event_data);
     }
 }
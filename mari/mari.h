@@ -18,25 +18,48 @@
 
 //=========================== defines ==========================================
 
-#define MARI_MAX_NODES         101  // FIXME: find a way to sync with the pre-stored schedules
+#define MARI_MAX_NODES         (MARI_N_CELLS_MAX - MARI_N_BEACON_CELLS - 2)  // every schedule has at least a shared uplink and a downlink cell, so no schedule has more nodes
 #define MARI_BROADCAST_ADDRESS 0xFFFFFFFFFFFFFFFF
 
+// multicast groups: a downlink frame sent to a group address is received by all the nodes in the group
+#define MARI_N_GROUPS                32
+#define MARI_GROUP_ADDRESS_PREFIX    0xFFFFFFFFFFFFFF00  // right below the broadcast address
+#define MARI_GROUP_ADDRESS(group_id) (MARI_GROUP_ADDRESS_PREFIX | (group_id))
+
 //=========================== prototypes ==========================================
 
+// with a NULL app_event_callback, events are queued in a ring, to be drained with mari_poll_events
+// a polled MARI_NEW_PACKET event points into a receive buffer, which must be given back with mari_release_event
+// with an app_event_callback, the packet is only valid until the callback returns
 void           mari_init(mr_node_type_t node_type, uint16_t net_id, schedule_t *app_schedule, mr_event_cb_t app_event_callback);
 void           mari_event_loop(void);
-void           mari_tx(uint8_t *packet, uint8_t length);
+size_t         mari_poll_events(mari_event_t *batch, size_t max_events);
+void           mari_release_event(const mari_event_t *event);
+uint32_t       mari_get_dropped_events(void);
+bool           mari_tx(uint8_t *packet, uint8_t length);                                                         // false if the queue is full
+bool           mari_tx_with_priority(uint8_t *packet, uint8_t length, mr_priority_t priority, uint32_t ttl_ms);  // false if the queue is full
+uint32_t       mari_get_expired_packets(void);
+void           mari_stats_snapshot(uint32_t *counters);             // MARI_STATS_N counters since the previous snapshot, see mr_stats_counter_t
+size_t         mari_profile_snapshot(mr_profile_entry_t *entries);  // MARI_PROFILE_N execution times since the previous snapshot, 0 without MARI_ENABLE_PROFILING
 mr_node_type_t mari_get_node_type(void);
 void           mari_set_node_type(mr_node_type_t node_type);
 
 size_t mari_gateway_get_nodes(uint64_t *nodes);
 size_t mari_gateway_count_nodes(void);
+bool   mari_gateway_tx_group(uint8_t group_id, uint8_t *payload, uint8_t payload_len);  // false if group_id >= MARI_N_GROUPS or the queue is full
+bool   mari_gateway_set_node_groups(uint64_t node_id, uint32_t groups);                 // one bit per group, replaces the groups of the node, false if the queue is full
+void   mari_gateway_set_join_groups(uint32_t groups);                                   // groups added to every node that joins
 
-void     mari_node_tx_payload(uint8_t *payload, uint8_t payload_len);
+bool     mari_node_tx_payload(uint8_t *payload, uint8_t payload_len);                       // false if the queue is full
+bool     mari_node_tx_payload_with_priority(uint8_t *payload, uint8_t payload_len, mr_priority_t priority, uint32_t ttl_ms);
+bool     mari_node_set_mailbox(uint8_t mailbox_id, uint8_t *payload, uint8_t payload_len);  // latest-value slot, up to MARI_N_MAILBOXES
 bool     mari_node_is_connected(void);
 uint64_t mari_node_gateway_id(void);
+void     mari_node_join_group(uint8_t group_id);
+void     mari_node_leave_group(uint8_t group_id);
+bool     mari_node_is_in_group(uint8_t group_id);
 
 // -------- internal api --------
-bool mr_handle_packet(uint8_t *packet, uint8_t length);
+bool mr_handle_packet(mr_received_packet_t *received);
 
 #endif  // __MARI_H
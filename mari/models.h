@@ -18,8 +18,6 @@
 #include <nrf.h>
 #include <stdbool.h>
 
-#include "bloom.h"
-
 //=========================== defines =========================================
 
 #define MARI_N_BLE_REGULAR_CHANNELS     37
@@ -30,24 +28,43 @@
 #define MARI_FIXED_SCAN_CHANNEL 37  // to hardcode the channel, use a valid value other than 0
 // #endif
 
+#ifndef MARI_WIDE_SCHEDULES
+#define MARI_WIDE_SCHEDULES 0  // set to 1 to support schedules of more than 256 cells, e.g. 500 nodes per gateway. uses more RAM
+#endif
+
+#if MARI_WIDE_SCHEDULES
+#define MARI_N_CELLS_MAX 640
+#else
 #define MARI_N_CELLS_MAX 149
+#endif
+#define MARI_N_BEACON_CELLS 3  // every schedule starts with this many beacon cells
 
-#define MARI_ENABLE_BACKGROUND_SCAN 1
+#define MARI_ENABLE_BACKGROUND_SCAN   1
+#define MARI_ENABLE_MAKE_BEFORE_BREAK 1  // handovers join the new gateway before leaving the current one
 
 #define MARI_PACKET_MAX_SIZE 255
 
-#define MARI_STATS_SCHED_USAGE_SIZE 4  // supports schedules with up to 256 cells
+#ifndef MARI_ENABLE_CELL_STATS
+#define MARI_ENABLE_CELL_STATS 1  // set to 0 in node builds: only the gateway reports the per-cell statistics, which take 8 bytes of RAM per cell
+#endif
+#define MARI_STATS_WINDOW_SLOTFRAMES 10  // number of slotframes aggregated in each per-cell statistics window
+#define MARI_STATS_CELLS_PER_INFO    48  // number of per-cell statistics carried by each gateway info frame
+
+#define MARI_LATENCY_N_BUCKETS 12  // log2 buckets of the round trip time histograms, the last one holds everything from 2048 slots
+#define MARI_LATENCY_MAX_NODES 32  // nodes probed at the same time by the gateway
 
 //=========================== types ============================================
 
 // -------- types sent over the air --------
 
 typedef enum {
-    MARI_PACKET_BEACON        = 1,
-    MARI_PACKET_JOIN_REQUEST  = 2,
-    MARI_PACKET_JOIN_RESPONSE = 4,
-    MARI_PACKET_KEEPALIVE     = 8,
-    MARI_PACKET_DATA          = 16,
+    MARI_PACKET_BEACON          = 1,
+    MARI_PACKET_JOIN_REQUEST    = 2,
+    MARI_PACKET_JOIN_RESPONSE   = 4,
+    MARI_PACKET_KEEPALIVE       = 8,
+    MARI_PACKET_DATA            = 16,
+    MARI_PACKET_GROUP_CONFIG    = 32,
+    MARI_PACKET_DATA_AGGREGATED = 64,
 } mr_packet_type_t;
 
 typedef struct __attribute__((packed)) {
@@ -64,6 +81,18 @@ typedef struct __attribute__((packed)) {
     mr_packet_statistics_t stats;
 } mr_packet_header_t;
 
+// join response record, a JOIN_RESPONSE carries a count byte followed by one or more of these
+typedef struct __attribute__((packed)) {
+    uint64_t node_id;
+    uint16_t cell_id;
+} mr_join_response_record_t;
+
+// record of an aggregated frame, a DATA_AGGREGATED frame carries one or more of these, each followed by its payload
+typedef struct __attribute__((packed)) {
+    uint16_t ordinal;  ///< Ordinal of the uplink cell of the node: the destination in downlink, the sender in uplink
+    uint8_t  length;   ///< Length of the payload
+} mr_aggregated_record_t;
+
 // beacon packet
 typedef struct __attribute__((packed)) {
     uint8_t          version;
@@ -71,11 +100,19 @@ typedef struct __attribute__((packed)) {
     uint16_t         network_id;
     uint64_t         asn;
     uint64_t         src;
-    uint8_t          remaining_capacity;
+    uint16_t         remaining_capacity;
     uint8_t          active_schedule_id;
-    uint8_t          bloom_filter[MARI_BLOOM_M_BYTES];
+    uint8_t          join_backlog;          ///< Gateway estimate of how many nodes are trying to join
+    uint8_t          next_schedule_id;      ///< Schedule that will be used from switch_asn on, 0 if no switch is planned
+    uint64_t         switch_asn;            ///< First ASN of the next schedule
+    uint8_t          downlink_pending_len;  ///< Length of the bitmap of the nodes the gateway has downlinks for in this slotframe, or MARI_DOWNLINK_PENDING_ALL
+    uint8_t          payload[];             ///< That bitmap, then the occupancy of the uplink cells, see occupancy.h. Both grow with the number of joined nodes
 } mr_beacon_packet_header_t;
 
+// the downlink pending bitmap has one bit per uplink cell ordinal, up to the last one set. broadcast and group downlinks wake up every node
+#define MARI_DOWNLINK_PENDING_MAX_LEN ((MARI_N_CELLS_MAX + 7) / 8)
+#define MARI_DOWNLINK_PENDING_ALL     (0xFF)  // no bitmap, every node listens
+
 // -------- types used internally --------
 
 typedef enum {
@@ -83,6 +120,15 @@ typedef enum {
     MARI_NODE    = 'D',
 } mr_node_type_t;
 
+// packets of a higher priority class are always sent first
+typedef enum {
+    MARI_PRIORITY_HIGH   = 0,  ///< Latency-critical, e.g. commands
+    MARI_PRIORITY_NORMAL = 1,
+    MARI_PRIORITY_LOW    = 2,  ///< Bulk data, only sent when nothing else waits
+} mr_priority_t;
+
+#define MARI_N_PRIORITIES 3
+
 typedef enum {
     MARI_NEW_PACKET = 1,
     MARI_CONNECTED,
@@ -100,10 +146,11 @@ typedef enum {
     MARI_PEER_LOST         = 3,  // deprecated
     MARI_GATEWAY_FULL      = 4,
     MARI_PEER_LOST_TIMEOUT = 5,
-    MARI_PEER_LOST_BLOOM   = 6,
+    MARI_PEER_LOST_BLOOM   = 6,  // no longer in the beacon occupancy
     MARI_HANDOVER_FAILED   = 7,
 } mr_event_tag_t;
 
+// for a payload taken out of an aggregated frame, header is the header of that frame, and payload does not follow it
 typedef struct {
     uint8_t             len;
     mr_packet_header_t *header;
@@ -124,6 +171,12 @@ typedef struct {
     mr_event_tag_t tag;
 } mr_event_data_t;
 
+// an event waiting for the application, a MARI_NEW_PACKET event holds the receive buffer of its packet until it is released
+typedef struct {
+    mr_event_t      event;
+    mr_event_data_t event_data;  // for MARI_NEW_PACKET, header and payload point into the receive buffer
+} mari_event_t;
+
 typedef enum {
     MARI_RADIO_ACTION_SLEEP = 'S',
     MARI_RADIO_ACTION_RX    = 'R',
@@ -148,28 +201,38 @@ typedef struct {
     uint8_t     channel_offset;
     uint64_t    assigned_node_id;
     uint64_t    last_received_asn;  ///< ASN marking the last time the node was heard from
-    uint64_t    bloom_h1;           ///< H1 hash of the node ID, used to compute the bloom filter
-    uint64_t    bloom_h2;           ///< H2 hash of the node ID, used to compute the bloom filter
+    uint8_t     occupancy_tag;      ///< Check tag of the node ID, advertised in the beacon occupancy
 } cell_t;
 
 typedef struct {
-    uint8_t id;                       // unique identifier for the schedule
-    uint8_t max_nodes;                // maximum number of nodes that can be scheduled, equivalent to the number of uplink slot_durations
-    uint8_t backoff_n_min;            // minimum exponent for the backoff algorithm
-    uint8_t backoff_n_max;            // maximum exponent for the backoff algorithm
-    size_t  n_cells;                  // number of cells in this schedule
-    cell_t  cells[MARI_N_CELLS_MAX];  // cells in this schedule. NOTE(FIXME?): the first 3 cells must be beacons
+    uint8_t  id;             // unique identifier for the schedule
+    uint16_t max_nodes;      // maximum number of nodes that can be scheduled, equivalent to the number of uplink slot_durations
+    uint8_t  backoff_n_min;  // minimum exponent for the backoff algorithm
+    uint8_t  backoff_n_max;  // maximum exponent for the backoff algorithm (at most 8). 2^n_max shared uplink slots should fit in MARI_JOIN_TIMEOUT_SINCE_SYNCED
+    size_t   n_cells;        // number of cells in this schedule, at most MARI_N_CELLS_MAX
+    cell_t  *cells;          // n_cells cells, so that each schedule only takes the memory it needs. NOTE: the first MARI_N_BEACON_CELLS cells must be beacons
 } schedule_t;
 
+// what the radio got at the end of a frame
+typedef enum {
+    MARI_RX_NO_FRAME = 0,  ///< Nothing could be read, e.g. a CRC error
+    MARI_RX_FOREIGN  = 1,  ///< Not a frame of this protocol version
+    MARI_RX_FRAME    = 2,  ///< A mari frame
+} mr_rx_status_t;
+
 typedef struct {
-    uint8_t  channel;
-    int8_t   rssi;
-    uint32_t start_ts;
-    uint32_t end_ts;
-    uint64_t asn;
-    bool     to_me;
-    uint8_t  packet[MARI_PACKET_MAX_SIZE];
-    uint8_t  packet_len;
+    mr_rx_status_t status;
+    slot_type_t    slot_type;   ///< Type of the slot the frame was received in
+    uint16_t       cell_index;  ///< Index of that slot in the active schedule
+    uint8_t        channel;
+    int8_t         rssi;
+    uint32_t       start_ts;
+    uint32_t       end_ts;
+    uint64_t       asn;
+    uint64_t       src;  ///< Sender of a mari frame, kept even when the frame itself was dropped
+    bool           to_me;
+    uint8_t       *packet;  ///< Points into the buffer the radio received the packet in, NULL if there is no packet to handle
+    uint8_t        packet_len;
 } mr_received_packet_t;
 
 // -------- types used for UART --------
@@ -180,24 +243,179 @@ typedef enum {
     MARI_EDGE_DATA         = 3,
     MARI_EDGE_KEEPALIVE    = 4,
     MARI_EDGE_GATEWAY_INFO = 5,
+    MARI_EDGE_LINK_DELTAS  = 6,
+    MARI_EDGE_LATENCY      = 7,   ///< Latency summaries of the probed nodes
+    MARI_EDGE_PROBE_CONFIG = 8,   ///< From the host: rate and nodes of the latency probes sent by the gateway
+    MARI_EDGE_STATS        = 9,   ///< Counters of the gateway since the previous stats frame
+    MARI_EDGE_PROFILE      = 10,  ///< Execution times of the mari handlers, sent by the gateway when the host asks for them
 } mr_gateway_edge_type_t;
 
+// per-cell counters, aggregated over MARI_STATS_WINDOW_SLOTFRAMES slotframes (saturate at 255)
+typedef struct __attribute__((packed)) {
+    uint8_t tx;          ///< Transmission attempts
+    uint8_t rx;          ///< Successful receptions
+    uint8_t rx_timeout;  ///< Receptions that timed out (no frame, or frame not decoded)
+    uint8_t collision;   ///< Shared uplink receptions that started but could not be decoded
+} mr_cell_stats_t;
+
+typedef enum {
+    MARI_CELL_STATS_TX,
+    MARI_CELL_STATS_RX,
+    MARI_CELL_STATS_RX_TIMEOUT,
+    MARI_CELL_STATS_COLLISION,
+} mr_cell_stats_event_t;
+
 // uart packet for gateway info
+typedef struct __attribute__((packed)) {
+    uint64_t        device_id;
+    uint16_t        net_id;
+    uint16_t        schedule_id;
+    uint64_t        asn;
+    uint32_t        timer;
+    uint8_t         stats_window;   ///< Number of slotframes aggregated in the per-cell statistics
+    uint16_t        stats_n_cells;  ///< Number of cells in the active schedule
+    uint16_t        stats_offset;   ///< Index of the cell described by cell_stats[0]
+    uint8_t         stats_len;      ///< Number of valid entries in cell_stats (the frame is truncated after them)
+    mr_cell_stats_t cell_stats[MARI_STATS_CELLS_PER_INFO];
+} mr_uart_packet_gateway_info_t;
+
+// counters of the stats block, see stats.h. the order is part of the uart format: add new counters at the end
+typedef enum {
+    MARI_STATS_QUEUE_FULL,           ///< Packets not queued, the queue was full
+    MARI_STATS_QUEUE_EXPIRED,        ///< Packets dropped from the queue, their time to live was over
+    MARI_STATS_RX_CRC_ERRORS,        ///< Frames received with a wrong CRC (read from the radio driver)
+    MARI_STATS_RX_NO_FRAME,          ///< rie1: nothing started before the end of the rx guard time
+    MARI_STATS_RX_TOO_LONG,          ///< rie2: a frame started but did not end in time
+    MARI_STATS_RX_LATE,              ///< Frames dropped because the bottom half was late
+    MARI_STATS_JOIN_REQUESTS,        ///< Join requests sent (node)
+    MARI_STATS_JOIN_RETRIES,         ///< Join requests that got no response, sent again after a backoff (node)
+    MARI_STATS_JOIN_GIVE_UPS,        ///< Gateways given up on, without joining them (node)
+    MARI_STATS_JOIN_COLLISIONS,      ///< Shared uplink slots in which frames collided (gateway)
+    MARI_STATS_HANDOVERS,            ///< Handovers to another gateway (node)
+    MARI_STATS_HANDOVERS_FAILED,     ///< Handovers that ended up with the node back to scanning (node)
+    MARI_STATS_BLOOM_DISCONNECTS,    ///< The node was no longer in the beacon occupancy of its gateway (node)
+    MARI_STATS_TIMEOUT_DISCONNECTS,  ///< Peers lost after too long without hearing from them
+    MARI_STATS_DRIFT_RESYNCS,        ///< Clock drift too large to be fixed, the node scanned again (node)
+    MARI_STATS_SCAN_BEACONS,         ///< Beacons recorded in the scan list (node)
+    MARI_STATS_SCAN_EVICTIONS,       ///< Gateways pushed out of the full scan list (node)
+    MARI_STATS_DOWNLINKS_SKIPPED,    ///< Downlink slots slept through, the beacons announced nothing for the node (node)
+    MARI_STATS_DOWNLINKS_HELD,       ///< Downlink slots left empty, none of the queued downlinks was announced in the beacons (gateway)
+    MARI_STATS_N,
+} mr_stats_counter_t;
+
+// uart packet for the stats block
 typedef struct __attribute__((packed)) {
     uint64_t device_id;
-    uint16_t net_id;
-    uint16_t schedule_id;
-    uint64_t sched_usage[MARI_STATS_SCHED_USAGE_SIZE];
     uint64_t asn;
-    uint32_t timer;
-} mr_uart_packet_gateway_info_t;
+    uint8_t  n_counters;  ///< MARI_STATS_N, so that hosts that know fewer counters can skip the new ones
+    uint32_t counters[MARI_STATS_N];
+} mr_uart_packet_stats_t;
+
+// code measured when MARI_ENABLE_PROFILING is set, see profile.h. the order is part of the uart format: add new ones at the end
+typedef enum {
+    MARI_PROFILE_NEW_SLOT,
+    MARI_PROFILE_TI1,
+    MARI_PROFILE_TI2,
+    MARI_PROFILE_TIE1,
+    MARI_PROFILE_TI3,
+    MARI_PROFILE_RI1,
+    MARI_PROFILE_RI2,
+    MARI_PROFILE_RI3,
+    MARI_PROFILE_RIE1,
+    MARI_PROFILE_RI4,
+    MARI_PROFILE_RIE2,
+    MARI_PROFILE_HI1,
+    MARI_PROFILE_HI2,
+    MARI_PROFILE_HI3,
+    MARI_PROFILE_HI4,
+    MARI_PROFILE_HI5,
+    MARI_PROFILE_HI6,
+    MARI_PROFILE_HI7,
+    MARI_PROFILE_HIE1,
+    MARI_PROFILE_SCAN_START_FRAME,
+    MARI_PROFILE_SCAN_END_FRAME,
+    MARI_PROFILE_SCAN_NEW_SCHEDULE,
+    MARI_PROFILE_HANDLE_PACKET,      ///< mr_handle_packet, in the rx bottom half
+    MARI_PROFILE_OCCUPANCY_COMPUTE,  ///< mr_occupancy_gateway_compute
+    MARI_PROFILE_SCAN_ADD,           ///< mr_scan_add, for every beacon heard
+    MARI_PROFILE_SCAN_SELECT,        ///< mr_scan_select
+    MARI_PROFILE_N,
+} mr_profile_point_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t count;
+    uint32_t min;   ///< In cycles
+    uint32_t max;   ///< In cycles
+    uint32_t mean;  ///< In cycles
+} mr_profile_entry_t;
+
+// uart packet for the execution times, sent in several frames
+typedef struct __attribute__((packed)) {
+    uint16_t           cycles_per_us;  ///< e.g. 64 on the nRF5340 network core, 1000 when built for a computer (nanoseconds)
+    uint8_t            n_points;       ///< MARI_PROFILE_N, or 0 when profiling is not enabled
+    uint8_t            offset;         ///< Point described by entries[0]
+    uint8_t            count;
+    mr_profile_entry_t entries[];
+} mr_uart_packet_profile_t;
+
+#define MARI_LINK_PDR_NODE_LEFT UINT8_MAX  // pdr of the last delta of a node, sent once it left its cell
+
+// link quality of a node, as seen by the gateway (only sent when it changed)
+typedef struct __attribute__((packed)) {
+    uint64_t node_id;
+    uint16_t cell_id;
+    int8_t   rssi;           ///< RSSI moving average, in dBm
+    uint8_t  pdr;            ///< Percentage of uplink cells received over the last MARI_LINK_PDR_SLOTFRAMES slotframes, or MARI_LINK_PDR_NODE_LEFT
+    uint8_t  miss_streak;    ///< Consecutive uplink cells missed
+    uint64_t last_seen_asn;  ///< ASN of the last frame received from the node
+} mr_link_delta_t;
+
+// uart packet for link deltas
+typedef struct __attribute__((packed)) {
+    uint8_t         count;
+    mr_link_delta_t deltas[];
+} mr_uart_packet_link_deltas_t;
 
 // -------- types used for metrics collection --------
 
 typedef enum {
     MARI_PAYLOAD_TYPE_METRICS_PROBE = 0x9C,
+    MARI_PAYLOAD_TYPE_LATENCY_PROBE = 0x9D,
 } mr_metrics_payload_type_t;
 
+// latency probe sent by the gateway, and sent back as is by the node
+typedef struct __attribute__((packed)) {
+    mr_metrics_payload_type_t type;    ///< MARI_PAYLOAD_TYPE_LATENCY_PROBE
+    uint16_t                  seq;     ///< Sequence number of the probe, per node
+    uint64_t                  tx_asn;  ///< ASN at which the gateway queued the probe
+} mr_latency_probe_t;
+
+// round trip times of the probes to a node since the previous summary, in slots
+// bucket 0 counts round trips of 0 and 1 slot, bucket i those of [2^i, 2^(i+1)) slots, the last one all the longer ones
+typedef struct __attribute__((packed)) {
+    uint64_t node_id;
+    uint16_t sent;      ///< Probes sent
+    uint16_t received;  ///< Probes received back (late ones are counted in the summary they arrive in)
+    uint16_t rtt_min;
+    uint16_t rtt_max;   ///< Saturates at UINT16_MAX
+    uint32_t rtt_sum;   ///< For the mean round trip time
+    uint16_t buckets[MARI_LATENCY_N_BUCKETS];
+} mr_latency_summary_t;
+
+// uart packet for latency summaries
+typedef struct __attribute__((packed)) {
+    uint8_t              count;
+    mr_latency_summary_t summaries[];
+} mr_uart_packet_latency_t;
+
+// uart packet from the host to configure the latency probes
+typedef struct __attribute__((packed)) {
+    uint32_t period_ms;          ///< Time between two probes to the same node, 0 to stop probing
+    uint32_t summary_period_ms;  ///< Time covered by each summary
+    uint8_t  n_nodes;            ///< 0 to probe any joined node, up to MARI_LATENCY_MAX_NODES of them
+    uint64_t node_ids[];         ///< Nodes to probe
+} mr_uart_packet_probe_config_t;
+
 typedef struct __attribute__((packed)) {
     mr_metrics_payload_type_t type;  ///< Payload type (1 byte)
 
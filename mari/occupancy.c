@@ -0,0 +1,207 @@
+/**
+ * @file
+ * @ingroup     occupancy
+ *
+ * @brief       Occupancy of the uplink cells, as advertised in the beacons
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+
+#include <nrf.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "occupancy.h"
+#include "scheduler.h"
+#include "critical.h"
+#include "profile.h"
+
+//=========================== defines ==========================================
+
+typedef struct {
+    uint8_t n_segments;                                                     // number of segments used for the active schedule
+    uint8_t segments[MARI_OCCUPANCY_MAX_SEGMENTS][MARI_OCCUPANCY_MAX_LEN];  // occupancy output, in wire format
+    uint8_t lengths[MARI_OCCUPANCY_MAX_SEGMENTS];                           // length of each segment, in bytes
+} occupancy_buffer_t;
+
+typedef struct {
+    // used by the gateway
+    bool               is_dirty;      // true if the occupancy needs to be re-computed
+    bool               is_available;  // false while the occupancy is being computed
+    uint8_t            next_segment;  // segment to be sent in the next beacon
+    uint8_t            active;        // buffer copied into the beacons, the other one is where the next computation goes
+    occupancy_buffer_t buffers[2];
+} occupancy_vars_t;
+
+//=========================== variables ========================================
+
+static occupancy_vars_t occupancy_vars = { 0 };
+
+//=========================== prototypes =======================================
+
+//=========================== public ===========================================
+
+// 8-bit check tag of a node, folded from its FNV-1a 64-bit hash
+uint8_t mr_occupancy_tag(uint64_t node_id) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int b = 0; b < 8; b++) {
+        uint8_t byte = (node_id >> (56 - b * 8)) & 0xFF;
+        hash ^= byte;
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 32;
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+    return hash & 0xFF;
+}
+
+// -------- gateway ---------
+
+void mr_occupancy_gateway_init(void) {
+    occupancy_vars.is_dirty     = false;
+    occupancy_vars.is_available = true;
+    occupancy_vars.next_segment = 0;
+    occupancy_vars.active       = 0;
+    // an empty segment, until the first computation
+    occupancy_buffer_t *buffer = &occupancy_vars.buffers[0];
+    buffer->n_segments         = 1;
+    memset(buffer->segments[0], 0, MARI_OCCUPANCY_HEADER_LEN);
+    buffer->segments[0][1] = 1;
+    buffer->lengths[0]     = MARI_OCCUPANCY_HEADER_LEN;
+}
+
+void mr_occupancy_gateway_set_dirty(void) {
+    occupancy_vars.is_dirty = true;
+}
+
+void mr_occupancy_gateway_set_clean(void) {
+    occupancy_vars.is_dirty = false;
+}
+
+bool mr_occupancy_gateway_is_dirty(void) {
+    return occupancy_vars.is_dirty;
+}
+
+bool mr_occupancy_gateway_is_available(void) {
+    return occupancy_vars.is_available;
+}
+
+// copies the next segment of the occupancy, segments are sent in turn. returns the number of bytes copied
+// called from the timer interrupt, it only reads the active buffer, which a computation never writes to
+uint8_t mr_occupancy_gateway_copy(uint8_t *output) {
+    const occupancy_buffer_t *buffer = &occupancy_vars.buffers[occupancy_vars.active];
+    if (occupancy_vars.next_segment >= buffer->n_segments) {
+        occupancy_vars.next_segment = 0;
+    }
+    uint8_t segment = occupancy_vars.next_segment++;
+    memcpy(output, buffer->segments[segment], buffer->lengths[segment]);
+    return buffer->lengths[segment];
+}
+
+// builds the occupancy into the inactive buffer, then swaps the buffers, so that a beacon never carries a partial one
+void mr_occupancy_gateway_compute(void) {
+    MR_PROFILE_SCOPE(MARI_PROFILE_OCCUPANCY_COMPUTE);
+    occupancy_vars.is_available = false;
+    occupancy_buffer_t *buffer  = &occupancy_vars.buffers[occupancy_vars.active ^ 1];
+    memset(buffer->segments, 0, sizeof(buffer->segments));
+
+    schedule_t *schedule_ptr = mr_scheduler_get_active_schedule_ptr();
+
+    uint16_t n_uplink = 0;
+    for (size_t i = 0; i < schedule_ptr->n_cells; i++) {
+        n_uplink += schedule_ptr->cells[i].type == SLOT_TYPE_UPLINK;
+    }
+
+    uint8_t n_segments = (n_uplink + MARI_OCCUPANCY_SEGMENT_CELLS - 1) / MARI_OCCUPANCY_SEGMENT_CELLS;
+    if (n_segments == 0) {
+        n_segments = 1;
+    } else if (n_segments > MARI_OCCUPANCY_MAX_SEGMENTS) {
+        n_segments = MARI_OCCUPANCY_MAX_SEGMENTS;
+    }
+    buffer->n_segments = n_segments;
+
+    for (uint8_t segment = 0; segment < n_segments; segment++) {
+        uint16_t first   = segment * MARI_OCCUPANCY_SEGMENT_CELLS;
+        uint8_t  n_cells = n_uplink - first < MARI_OCCUPANCY_SEGMENT_CELLS ? n_uplink - first : MARI_OCCUPANCY_SEGMENT_CELLS;
+
+        buffer->segments[segment][0] = segment;
+        buffer->segments[segment][1] = n_segments;
+        buffer->segments[segment][2] = n_cells;
+        // tags are appended after the bitmap
+        buffer->lengths[segment] = MARI_OCCUPANCY_HEADER_LEN + (n_cells + 7) / 8;
+    }
+
+    uint16_t ordinal = 0;
+    for (size_t i = 0; i < schedule_ptr->n_cells; i++) {
+        cell_t *cell = &schedule_ptr->cells[i];
+        if (cell->type != SLOT_TYPE_UPLINK) {
+            continue;  // skip non-uplink cells
+        }
+        uint8_t  segment = ordinal / MARI_OCCUPANCY_SEGMENT_CELLS;
+        uint16_t bit     = ordinal % MARI_OCCUPANCY_SEGMENT_CELLS;
+        ordinal++;
+        if (cell->assigned_node_id == 0 || segment >= n_segments) {
+            continue;  // skip empty cells
+        }
+
+        uint8_t *output = buffer->segments[segment];
+        output[MARI_OCCUPANCY_HEADER_LEN + bit / 8] |= (1 << (bit % 8));
+        output[buffer->lengths[segment]++] = cell->occupancy_tag;
+    }
+
+    uint32_t primask      = mr_critical_enter();
+    occupancy_vars.active ^= 1;
+    mr_critical_exit(primask);
+    occupancy_vars.is_available = true;
+}
+
+void mr_occupancy_gateway_event_loop(void) {
+    // check if the occupancy needs to be re-computed
+    if (mr_occupancy_gateway_is_dirty()) {
+        // cleared first, so that a cell assigned during the computation marks it dirty again
+        mr_occupancy_gateway_set_clean();
+        mr_occupancy_gateway_compute();
+    }
+}
+
+// -------- node ---------
+
+// returns false if the uplink cell at ordinal is free, or assigned to a node with another tag
+// returns true if it is assigned to a node with this tag, or if the occupancy does not cover it
+bool mr_occupancy_node_contains(uint16_t ordinal, uint8_t tag, const uint8_t *occupancy, uint8_t length) {
+    if (length < MARI_OCCUPANCY_HEADER_LEN) {
+        return true;
+    }
+    uint8_t segment    = occupancy[0];
+    uint8_t n_segments = occupancy[1];
+    uint8_t n_cells    = occupancy[2];
+    if (n_segments == 0 || ordinal / MARI_OCCUPANCY_SEGMENT_CELLS != segment || ordinal % MARI_OCCUPANCY_SEGMENT_CELLS >= n_cells) {
+        return true;
+    }
+
+    const uint8_t *bitmap     = &occupancy[MARI_OCCUPANCY_HEADER_LEN];
+    uint8_t        bitmap_len = (n_cells + 7) / 8;
+    uint8_t        bit        = ordinal % MARI_OCCUPANCY_SEGMENT_CELLS;
+    if (length < MARI_OCCUPANCY_HEADER_LEN + bitmap_len) {
+        return true;
+    }
+    if ((bitmap[bit / 8] & (1 << (bit % 8))) == 0) {
+        return false;
+    }
+
+    // the tag of this cell comes after the tags of the assigned cells before it
+    uint8_t rank = 0;
+    for (uint8_t i = 0; i < bit / 8; i++) {
+        rank += __builtin_popcount(bitmap[i]);
+    }
+    rank += __builtin_popcount(bitmap[bit / 8] & ((1 << (bit % 8)) - 1));
+    if (MARI_OCCUPANCY_HEADER_LEN + bitmap_len + rank >= length) {
+        return true;
+    }
+    return bitmap[bitmap_len + rank] == tag;
+}
+
+//=========================== private ==========================================
@@ -0,0 +1,56 @@
+#ifndef __OCCUPANCY_H
+#define __OCCUPANCY_H
+
+/**
+ * @ingroup     mari
+ * @brief       Occupancy of the uplink cells, as advertised in the beacons
+ *
+ * Each beacon carries a bitmap of the assigned uplink cells, indexed by ordinal (the n-th uplink cell of the
+ * schedule), followed by a check tag for each assigned cell, derived from the ID of the node it is assigned to.
+ * A node that finds its own bit cleared, or a tag that is not its own, knows that it is no longer joined.
+ *
+ * Wire format, right after the beacon header:
+ *   uint8_t segment              index of the segment carried by this beacon
+ *   uint8_t n_segments           number of segments the occupancy is split into
+ *   uint8_t n_cells              number of uplink cells covered by this segment
+ *   uint8_t bitmap[(n_cells + 7) / 8]
+ *   uint8_t tags[]               one per bit set in the bitmap, in the same order
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2024-now
+ * @}
+ */
+
+#include <nrf.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//=========================== defines =========================================
+
+#define MARI_OCCUPANCY_HEADER_LEN 3
+
+// big schedules split the occupancy in segments, each beacon carries one of them
+#define MARI_OCCUPANCY_SEGMENT_CELLS 104  // uplink cells per segment, so that schedule_huge fits in one
+#define MARI_OCCUPANCY_MAX_SEGMENTS  ((MARI_N_CELLS_MAX + MARI_OCCUPANCY_SEGMENT_CELLS - 1) / MARI_OCCUPANCY_SEGMENT_CELLS)
+#define MARI_OCCUPANCY_MAX_LEN       (MARI_OCCUPANCY_HEADER_LEN + MARI_OCCUPANCY_SEGMENT_CELLS / 8 + MARI_OCCUPANCY_SEGMENT_CELLS)  // all cells assigned
+
+//=========================== variables =======================================
+
+//=========================== prototypes ======================================
+
+uint8_t mr_occupancy_tag(uint64_t node_id);
+
+void    mr_occupancy_gateway_init(void);
+void    mr_occupancy_gateway_set_dirty(void);
+void    mr_occupancy_gateway_set_clean(void);
+bool    mr_occupancy_gateway_is_dirty(void);
+bool    mr_occupancy_gateway_is_available(void);
+uint8_t mr_occupancy_gateway_copy(uint8_t *output);
+void    mr_occupancy_gateway_compute(void);
+void    mr_occupancy_gateway_event_loop(void);
+
+bool mr_occupancy_node_contains(uint16_t ordinal, uint8_t tag, const uint8_t *occupancy, uint8_t length);
+
+#endif  // __OCCUPANCY_H
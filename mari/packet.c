@@ -10,9 +10,13 @@
 
 #include "mr_device.h"
 #include "scheduler.h"
+#include "occupancy.h"
 #include "association.h"
 #include "packet.h"
 #include "mac.h"
+#include "link.h"
+#include "stats.h"
+#include "profile.h"
 
 //=========================== prototypes =======================================
 
@@ -34,36 +38,166 @@ size_t mr_build_packet_join_request(uint8_t *buffer, uint64_t dst) {
     return _set_header(buffer, dst, MARI_PACKET_JOIN_REQUEST);
 }
 
-size_t mr_build_packet_join_response(uint8_t *buffer, uint64_t dst) {
-    return _set_header(buffer, dst, MARI_PACKET_JOIN_RESPONSE);
+// the records are followed by the groups every joining node is added to
+size_t mr_build_packet_join_response(uint8_t *buffer, uint64_t dst, const mr_join_response_record_t *records, uint8_t count, uint32_t groups) {
+    size_t header_len    = _set_header(buffer, dst, MARI_PACKET_JOIN_RESPONSE);
+    buffer[header_len++] = count;
+    memcpy(buffer + header_len, records, count * sizeof(mr_join_response_record_t));
+    header_len += count * sizeof(mr_join_response_record_t);
+    memcpy(buffer + header_len, &groups, sizeof(uint32_t));
+    return header_len + sizeof(uint32_t);
 }
 
-size_t mr_build_packet_beacon(uint8_t *buffer, uint16_t net_id, uint64_t asn, uint8_t remaining_capacity, uint8_t active_schedule_id) {
+// returns the cell assigned to node_id in a join response, or -1 if the response has nothing for it
+int16_t mr_packet_join_response_find_cell(const uint8_t *packet, uint8_t length, uint64_t node_id) {
+    if (length < sizeof(mr_packet_header_t) + 1) {
+        return -1;
+    }
+    // the first byte after the header contains the number of records, each one assigning a cell to a node
+    uint8_t                          count   = packet[sizeof(mr_packet_header_t)];
+    const mr_join_response_record_t *records = (const mr_join_response_record_t *)(packet + sizeof(mr_packet_header_t) + 1);
+    for (size_t i = 0; i < count && sizeof(mr_packet_header_t) + 1 + (i + 1) * sizeof(mr_join_response_record_t) <= length; i++) {
+        if (records[i].node_id == node_id) {
+            return records[i].cell_id;
+        }
+    }
+    return -1;
+}
+
+// returns the groups advertised in a join response, 0 if none
+uint32_t mr_packet_join_response_get_groups(const uint8_t *packet, uint8_t length) {
+    if (length < sizeof(mr_packet_header_t) + 1) {
+        return 0;
+    }
+    uint8_t count      = packet[sizeof(mr_packet_header_t)];
+    size_t  groups_pos = sizeof(mr_packet_header_t) + 1 + count * sizeof(mr_join_response_record_t);
+    if (groups_pos + sizeof(uint32_t) > length) {
+        return 0;
+    }
+    uint32_t groups;
+    memcpy(&groups, packet + groups_pos, sizeof(uint32_t));
+    return groups;
+}
+
+size_t mr_build_packet_group_config(uint8_t *buffer, uint64_t dst, uint32_t groups) {
+    size_t header_len = _set_header(buffer, dst, MARI_PACKET_GROUP_CONFIG);
+    memcpy(buffer + header_len, &groups, sizeof(uint32_t));
+    return header_len + sizeof(uint32_t);
+}
+
+// an aggregated frame starts with the header only, records are added one by one
+size_t mr_build_packet_data_aggregated(uint8_t *buffer, uint64_t dst) {
+    return _set_header(buffer, dst, MARI_PACKET_DATA_AGGREGATED);
+}
+
+// appends a record to an aggregated frame of the given length. returns the new length, or 0 if the record does not fit
+size_t mr_packet_aggregated_add_record(uint8_t *buffer, size_t length, uint16_t ordinal, const uint8_t *payload, uint8_t payload_len) {
+    if (length + sizeof(mr_aggregated_record_t) + payload_len > MARI_PACKET_MAX_SIZE) {
+        return 0;
+    }
+    mr_aggregated_record_t record = { .ordinal = ordinal, .length = payload_len };
+    memcpy(buffer + length, &record, sizeof(mr_aggregated_record_t));
+    memcpy(buffer + length + sizeof(mr_aggregated_record_t), payload, payload_len);
+    return length + sizeof(mr_aggregated_record_t) + payload_len;
+}
+
+// walks the records of an aggregated frame, starting with *offset at 0
+// returns the payload of the next record, or NULL once all records were read or if the frame is truncated
+uint8_t *mr_packet_aggregated_next_record(uint8_t *packet, uint8_t length, size_t *offset, uint16_t *ordinal, uint8_t *payload_len) {
+    if (*offset == 0) {
+        *offset = sizeof(mr_packet_header_t);
+    }
+    if (*offset + sizeof(mr_aggregated_record_t) > length) {
+        return NULL;
+    }
+    mr_aggregated_record_t record;
+    memcpy(&record, packet + *offset, sizeof(mr_aggregated_record_t));
+    uint8_t *payload = packet + *offset + sizeof(mr_aggregated_record_t);
+    if (*offset + sizeof(mr_aggregated_record_t) + record.length > length) {
+        return NULL;
+    }
+    *offset += sizeof(mr_aggregated_record_t) + record.length;
+    *ordinal     = record.ordinal;
+    *payload_len = record.length;
+    return payload;
+}
+
+size_t mr_build_packet_beacon(uint8_t *buffer, uint16_t net_id, uint64_t asn, uint16_t remaining_capacity, uint8_t active_schedule_id, uint8_t join_backlog, uint8_t next_schedule_id, uint64_t switch_asn, const uint8_t *downlink_pending, uint8_t downlink_pending_len) {
     mr_beacon_packet_header_t beacon = {
-        .version            = MARI_PROTOCOL_VERSION,
-        .type               = MARI_PACKET_BEACON,
-        .network_id         = net_id,
-        .asn                = asn,
-        .src                = mr_device_id(),
-        .remaining_capacity = remaining_capacity,
-        .active_schedule_id = active_schedule_id,
+        .version              = MARI_PROTOCOL_VERSION,
+        .type                 = MARI_PACKET_BEACON,
+        .network_id           = net_id,
+        .asn                  = asn,
+        .src                  = mr_device_id(),
+        .remaining_capacity   = remaining_capacity,
+        .active_schedule_id   = active_schedule_id,
+        .join_backlog         = join_backlog,
+        .next_schedule_id     = next_schedule_id,
+        .switch_asn           = switch_asn,
+        .downlink_pending_len = downlink_pending_len,
     };
-    // add bloom filter
-    mr_bloom_gateway_copy(beacon.bloom_filter);
     memcpy(buffer, &beacon, sizeof(mr_beacon_packet_header_t));
-    return sizeof(mr_beacon_packet_header_t);
+    size_t len = sizeof(mr_beacon_packet_header_t);
+    // add the nodes that have pending downlinks
+    if (downlink_pending_len != MARI_DOWNLINK_PENDING_ALL) {
+        memcpy(buffer + len, downlink_pending, downlink_pending_len);
+        len += downlink_pending_len;
+    }
+    // add the occupancy of the uplink cells, or the next segment of it
+    return len + mr_occupancy_gateway_copy(buffer + len);
 }
 
 size_t mr_build_uart_packet_gateway_info(uint8_t *buffer) {
     mr_uart_packet_gateway_info_t gateway_info = {
-        .device_id   = mr_device_id(),
-        .net_id      = mr_assoc_get_network_id(),
-        .schedule_id = mr_scheduler_get_active_schedule_id(),
-        .asn         = mr_mac_get_asn(),
+        .device_id     = mr_device_id(),
+        .net_id        = mr_assoc_get_network_id(),
+        .schedule_id   = mr_scheduler_get_active_schedule_id(),
+        .asn           = mr_mac_get_asn(),
+        .stats_window  = MARI_STATS_WINDOW_SLOTFRAMES,
+        .stats_n_cells = mr_scheduler_get_active_schedule_slot_count(),
     };
-    memcpy(gateway_info.sched_usage, mr_scheduler_get_schedule_usage(), sizeof(uint64_t) * MARI_STATS_SCHED_USAGE_SIZE);
-    memcpy(buffer, &gateway_info, sizeof(mr_uart_packet_gateway_info_t));
-    return sizeof(mr_uart_packet_gateway_info_t);
+    uint16_t stats_offset     = 0;
+    gateway_info.stats_len    = mr_scheduler_stats_get_cells(gateway_info.cell_stats, &stats_offset, MARI_STATS_CELLS_PER_INFO);
+    gateway_info.stats_offset = stats_offset;
+    // only send the valid part of the per-cell statistics
+    size_t len = sizeof(mr_uart_packet_gateway_info_t) - (MARI_STATS_CELLS_PER_INFO - gateway_info.stats_len) * sizeof(mr_cell_stats_t);
+    memcpy(buffer, &gateway_info, len);
+    return len;
+}
+
+size_t mr_build_uart_packet_link_deltas(uint8_t *buffer) {
+    mr_uart_packet_link_deltas_t *link_deltas = (mr_uart_packet_link_deltas_t *)buffer;
+    link_deltas->count                        = mr_link_gateway_get_deltas(link_deltas->deltas, MARI_LINK_DELTAS_PER_FRAME);
+    return sizeof(mr_uart_packet_link_deltas_t) + link_deltas->count * sizeof(mr_link_delta_t);
+}
+
+// resets the counters, so that each frame holds what happened since the previous one
+size_t mr_build_uart_packet_stats(uint8_t *buffer) {
+    mr_uart_packet_stats_t stats = {
+        .device_id  = mr_device_id(),
+        .asn        = mr_mac_get_asn(),
+        .n_counters = MARI_STATS_N,
+    };
+    uint32_t counters[MARI_STATS_N];
+    mr_stats_snapshot(counters);
+    memcpy(stats.counters, counters, sizeof(counters));  // the packed struct may not be aligned
+    memcpy(buffer, &stats, sizeof(mr_uart_packet_stats_t));
+    return sizeof(mr_uart_packet_stats_t);
+}
+
+// entries from offset on, as many as fit in a frame, out of a snapshot of n_points entries
+size_t mr_build_uart_packet_profile(uint8_t *buffer, const mr_profile_entry_t *entries, size_t n_points, uint8_t offset) {
+    mr_uart_packet_profile_t *profile = (mr_uart_packet_profile_t *)buffer;
+    size_t                    count   = offset < n_points ? n_points - offset : 0;
+    if (count > MARI_PROFILE_PER_FRAME) {
+        count = MARI_PROFILE_PER_FRAME;
+    }
+    profile->cycles_per_us = mr_profile_cycles_per_us();
+    profile->n_points      = n_points;
+    profile->offset        = offset;
+    profile->count         = count;
+    memcpy(profile->entries, entries + offset, count * sizeof(mr_profile_entry_t));
+    return sizeof(mr_uart_packet_profile_t) + count * sizeof(mr_profile_entry_t);
 }
 
 //=========================== private ==========================================
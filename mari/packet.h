@@ -21,7 +21,7 @@
 
 //=========================== defines ==========================================
 
-#define MARI_PROTOCOL_VERSION 2
+#define MARI_PROTOCOL_VERSION 5
 
 #define MARI_NET_ID_PATTERN_ANY 0
 #define MARI_NET_ID_DEFAULT     1
@@ -32,12 +32,28 @@ size_t mr_build_packet_data(uint8_t *buffer, uint64_t dst, uint8_t *data, size_t
 
 size_t mr_build_packet_join_request(uint8_t *buffer, uint64_t dst);
 
-size_t mr_build_packet_join_response(uint8_t *buffer, uint64_t dst);
+size_t mr_build_packet_join_response(uint8_t *buffer, uint64_t dst, const mr_join_response_record_t *records, uint8_t count, uint32_t groups);
 
 size_t mr_build_packet_keepalive(uint8_t *buffer, uint64_t dst);
 
-size_t mr_build_packet_beacon(uint8_t *buffer, uint16_t net_id, uint64_t asn, uint8_t remaining_capacity, uint8_t active_schedule_id);
+int16_t mr_packet_join_response_find_cell(const uint8_t *packet, uint8_t length, uint64_t node_id);
+
+uint32_t mr_packet_join_response_get_groups(const uint8_t *packet, uint8_t length);
+
+size_t mr_build_packet_group_config(uint8_t *buffer, uint64_t dst, uint32_t groups);
+
+size_t   mr_build_packet_data_aggregated(uint8_t *buffer, uint64_t dst);
+size_t   mr_packet_aggregated_add_record(uint8_t *buffer, size_t length, uint16_t ordinal, const uint8_t *payload, uint8_t payload_len);
+uint8_t *mr_packet_aggregated_next_record(uint8_t *packet, uint8_t length, size_t *offset, uint16_t *ordinal, uint8_t *payload_len);
+
+size_t mr_build_packet_beacon(uint8_t *buffer, uint16_t net_id, uint64_t asn, uint16_t remaining_capacity, uint8_t active_schedule_id, uint8_t join_backlog, uint8_t next_schedule_id, uint64_t switch_asn, const uint8_t *downlink_pending, uint8_t downlink_pending_len);
 
 size_t mr_build_uart_packet_gateway_info(uint8_t *buffer);
 
+size_t mr_build_uart_packet_link_deltas(uint8_t *buffer);
+
+size_t mr_build_uart_packet_stats(uint8_t *buffer);
+
+size_t mr_build_uart_packet_profile(uint8_t *buffer, const mr_profile_entry_t *entries, size_t n_points, uint8_t offset);
+
 #endif
@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @ingroup     profile
+ *
+ * @brief       Execution times of the slot handlers
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+
+#include <nrf.h>
+#include <stdint.h>
+#include <string.h>
+#if !defined(DWT)
+#include <time.h>
+#endif
+
+#include "profile.h"
+
+//=========================== defines ==========================================
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} profile_point_t;
+
+//=========================== variables ========================================
+
+static profile_point_t _points[MARI_PROFILE_N] = { 0 };
+
+//=========================== public ===========================================
+
+void mr_profile_init(void) {
+#if MARI_ENABLE_PROFILING && defined(DWT)
+    // the cycle counter is part of the debug trace unit, which is off by default
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    memset(_points, 0, sizeof(_points));
+}
+
+uint32_t mr_profile_now(void) {
+#if defined(DWT)
+    return DWT->CYCCNT;
+#else
+    // built for a computer
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+uint16_t mr_profile_cycles_per_us(void) {
+#if defined(DWT)
+    return SystemCoreClock / 1000000;
+#else
+    return 1000;
+#endif
+}
+
+void mr_profile_record(mr_profile_point_t point, uint32_t cycles) {
+    profile_point_t *entry = &_points[point];
+    if (entry->count == 0 || cycles < entry->min) {
+        entry->min = cycles;
+    }
+    if (cycles > entry->max) {
+        entry->max = cycles;
+    }
+    entry->sum += cycles;
+    entry->count++;
+}
+
+void mr_profile_scope_end(mr_profile_scope_t *scope) {
+    mr_profile_record(scope->point, mr_profile_now() - scope->start);  // the counter wraps around, the difference does not
+}
+
+size_t mr_profile_snapshot(mr_profile_entry_t *entries) {
+    if (!MARI_ENABLE_PROFILING) {
+        return 0;
+    }
+
+    // the points are recorded from the radio, timer and swi interrupts
+    profile_point_t points[MARI_PROFILE_N];
+    __disable_irq();
+    memcpy(points, _points, sizeof(points));
+    memset(_points, 0, sizeof(_points));
+    __enable_irq();
+
+    for (size_t i = 0; i < MARI_PROFILE_N; i++) {
+        entries[i] = (mr_profile_entry_t){
+            .count = points[i].count,
+            .min   = points[i].min,
+            .max   = points[i].max,
+            .mean  = points[i].count ? points[i].sum / points[i].count : 0,
+        };
+    }
+    return MARI_PROFILE_N;
+}
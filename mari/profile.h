@@ -0,0 +1,68 @@
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+/**
+ * @ingroup     mari
+ * @brief       Execution times of the slot handlers, e.g. to check the margins of the slot timing
+ *
+ * With MARI_ENABLE_PROFILING set, each measured function starts with MR_PROFILE_SCOPE, which records the time taken
+ * until the function returns, early returns included, as min, mean and max for each mr_profile_point_t.
+ * Times are in cycles of the DWT cycle counter on the devices, and in nanoseconds when built for a computer.
+ * They include the functions called, e.g. new_slot_synced includes the activity it starts.
+ *
+ * Recording takes no lock: each point belongs to one step of the slot, so it is practically never recorded twice at
+ * the same time. Taking a snapshot briefly masks the interrupts. Without MARI_ENABLE_PROFILING, the hooks compile
+ * to nothing.
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025-now
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "models.h"
+
+//=========================== defines ==========================================
+
+#ifndef MARI_ENABLE_PROFILING
+#define MARI_ENABLE_PROFILING 0  // set to 1 to measure the execution time of the slot handlers, costs a few cycles per handler
+#endif
+
+// entries per uart frame, after the uart type
+#define MARI_PROFILE_PER_FRAME ((MARI_PACKET_MAX_SIZE - 1 - sizeof(mr_uart_packet_profile_t)) / sizeof(mr_profile_entry_t))
+
+typedef struct {
+    mr_profile_point_t point;
+    uint32_t           start;
+} mr_profile_scope_t;
+
+#if MARI_ENABLE_PROFILING
+#define MR_PROFILE_SCOPE(point) \
+    mr_profile_scope_t _profile_scope __attribute__((cleanup(mr_profile_scope_end))) = { (point), mr_profile_now() }
+#else
+#define MR_PROFILE_SCOPE(point) ((void)0)
+#endif
+
+//=========================== prototypes =======================================
+
+void     mr_profile_init(void);
+uint32_t mr_profile_now(void);
+uint16_t mr_profile_cycles_per_us(void);
+void     mr_profile_record(mr_profile_point_t point, uint32_t cycles);
+void     mr_profile_scope_end(mr_profile_scope_t *scope);
+
+/**
+ * @brief Copies the times of all the points into entries, and starts over
+ *
+ * @param[out] entries  MARI_PROFILE_N entries, in the order of mr_profile_point_t
+ *
+ * @return MARI_PROFILE_N, or 0 if profiling is not enabled
+ */
+size_t mr_profile_snapshot(mr_profile_entry_t *entries);
+
+#endif  // __PROFILE_H
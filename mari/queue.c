@@ -18,27 +18,49 @@
 #include "mac.h"
 #include "scheduler.h"
 #include "association.h"
-#include "bloom.h"
+#include "occupancy.h"
 #include "mari.h"
 #include "queue.h"
+#include "stats.h"
+#include "critical.h"
 
 //=========================== defines ==========================================
 
 typedef struct {
-    uint8_t length;
-    uint8_t buffer[MARI_PACKET_MAX_SIZE];
+    uint8_t  length;
+    uint64_t expiry_asn;  ///< The packet is dropped if not sent by this asn, 0 if it never expires
+    uint8_t  buffer[MARI_PACKET_MAX_SIZE];
 } mr_packet_t;
 
+// latest value published by the node, overwritten in place until it is sent
+typedef struct {
+    bool    pending;  ///< True if the value was not sent yet
+    uint8_t length;
+    uint8_t payload[MARI_MAILBOX_MAX_PAYLOAD];
+} mr_mailbox_t;
+
+// FIFO of the packets of one priority class, as indexes into the shared packet pool
 typedef struct {
-    uint8_t     current;  ///< Current position in the queue
-    uint8_t     last;     ///< Position of the last item added in the queue
-    mr_packet_t packets[MARI_PACKET_QUEUE_SIZE];
+    uint8_t current;  ///< Current position in the queue
+    uint8_t last;     ///< Position of the last item added in the queue
+    uint8_t slots[MARI_PACKET_QUEUE_SIZE];
 } mari_packet_queue_t;
 
 typedef struct {
-    mari_packet_queue_t packet_queue;
-    bool                queue_locked;  ///< Simple lock to prevent concurrent access
-    mr_packet_t         join_packet;
+    mr_packet_t               packets[MARI_PACKET_QUEUE_SIZE - 1];              ///< Packet pool, shared by the priority classes
+    uint8_t                   free_slots[MARI_PACKET_QUEUE_SIZE - 1];           ///< Stack of the unused entries of the pool
+    uint8_t                   free_slots_len;
+    mari_packet_queue_t       packet_queues[MARI_N_PRIORITIES];
+    bool                      queue_locked;                                     ///< Simple lock to prevent concurrent access
+    uint32_t                  dropped_expired;                                  ///< Packets not sent before their expiry
+    uint32_t                  dropped_full;                                     ///< Packets not queued because the pool was full
+    mr_mailbox_t              mailboxes[MARI_N_MAILBOXES];                      ///< Latest values, used by the node
+    uint8_t                   next_mailbox;                                     ///< Mailbox to look at first, so that all of them get their turn
+    mr_packet_t               join_packet;                                      ///< Join request, used by the node
+    mr_join_response_record_t join_responses[MARI_JOIN_RESPONSE_QUEUE_SIZE];    ///< Pending join responses, used by the gateway
+    uint8_t                   join_responses_len;
+    uint8_t                   downlink_pending[MARI_DOWNLINK_PENDING_MAX_LEN];  ///< Downlinks announced in the beacons of this slotframe, one bit per ordinal, used by the gateway
+    uint8_t                   downlink_pending_len;                             ///< Length of that bitmap, or MARI_DOWNLINK_PENDING_ALL
 } queue_vars_t;
 
 //=========================== variables ========================================
@@ -47,6 +69,15 @@ static queue_vars_t queue_vars = { 0 };
 
 //=========================== prototypes =======================================
 
+static int16_t  _next_slot(void);
+static int16_t  _next_entry(uint8_t *priority);
+static void     _remove_entry(uint8_t priority, uint8_t index);
+static bool     _downlink_is_announced(uint64_t dst);
+static uint8_t  _node_get_mailboxes(uint8_t *packet);
+static uint8_t  _aggregate_data_packets(uint8_t *packet, uint8_t length);
+static int16_t  _aggregation_ordinal(const uint8_t *packet, uint8_t length, uint64_t dst);
+static void     _gateway_downlink_pending(void);
+
 //=========================== public ===========================================
 
 uint8_t mr_queue_next_packet(slot_type_t slot_type, uint8_t *packet) {
@@ -54,22 +85,43 @@ uint8_t mr_queue_next_packet(slot_type_t slot_type, uint8_t *packet) {
 
     if (mari_get_node_type() == MARI_GATEWAY) {
         if (slot_type == SLOT_TYPE_BEACON) {
-            // prepare a beacon packet with current asn, remaining capacity and active schedule id
-            len = mr_build_packet_beacon(
+            if (mr_scheduler_get_current_cell_index() == 0) {
+                // the pending downlinks are looked up in the first beacon of the slotframe, the next ones repeat them,
+                // so that whichever beacon a node hears, it listens in the downlink slots where it could be sent something
+                _gateway_downlink_pending();
+            }
+            // prepare a beacon packet with current asn, remaining capacity, active schedule id, join contention, planned schedule switch and pending downlinks
+            uint64_t switch_asn       = 0;
+            uint8_t  next_schedule_id = mr_scheduler_get_next_schedule(&switch_asn);
+            len                       = mr_build_packet_beacon(
                 packet,
                 mr_assoc_get_network_id(),
                 mr_mac_get_asn(),
                 mr_scheduler_gateway_remaining_capacity(),
-                mr_scheduler_get_active_schedule_id());
+                mr_scheduler_get_active_schedule_id(),
+                mr_assoc_gateway_get_join_backlog(),
+                next_schedule_id,
+                switch_asn,
+                queue_vars.downlink_pending,
+                queue_vars.downlink_pending_len);
         } else if (slot_type == SLOT_TYPE_DOWNLINK) {
-            if (mr_queue_has_join_packet()) {
-                len = mr_queue_get_join_packet(packet);
+            if (mr_queue_has_join_response()) {
+                len = mr_queue_get_join_response(packet);
             } else {
-                // load a packet from the queue, if any is available
-                len = mr_queue_peek(packet);
-                if (len) {
-                    // actually pop the packet from the queue
-                    mr_queue_pop();
+                // the first packet announced in the beacons, including those queued after them for an announced node
+                uint8_t priority;
+                int16_t index = _next_entry(&priority);
+                if (index >= 0) {
+                    mr_packet_t *next = &queue_vars.packets[queue_vars.packet_queues[priority].slots[index]];
+                    len               = next->length;
+                    memcpy(packet, next->buffer, len);
+                    _remove_entry(priority, index);
+                    if (MARI_ENABLE_DOWNLINK_AGGREGATION) {
+                        len = _aggregate_data_packets(packet, len);
+                    }
+                } else if (!queue_vars.queue_locked && _next_slot() >= 0) {
+                    // only packets whose destinations may be asleep
+                    mr_stats_inc(MARI_STATS_DOWNLINKS_HELD);
                 }
             }
         }
@@ -85,6 +137,11 @@ uint8_t mr_queue_next_packet(slot_type_t slot_type, uint8_t *packet) {
             if (len) {
                 // actually pop the packet from the queue
                 mr_queue_pop();
+                if (MARI_ENABLE_UPLINK_COALESCING) {
+                    len = _aggregate_data_packets(packet, len);
+                }
+            } else if ((len = _node_get_mailboxes(packet)) > 0) {
+                // the latest values go before the keepalive
             } else if (MARI_AUTO_UPLINK_KEEPALIVE) {
                 // send a keepalive packet
                 len = mr_build_packet_keepalive(packet, mr_mac_get_synced_gateway());
@@ -95,20 +152,44 @@ uint8_t mr_queue_next_packet(slot_type_t slot_type, uint8_t *packet) {
     return len;
 }
 
-void mr_queue_add(uint8_t *packet, uint8_t length) {
+void mr_queue_init(void) {
+    queue_vars.dropped_expired = 0;
+    queue_vars.dropped_full    = 0;
+    mr_queue_reset();
+}
+
+// returns false if the queue is full
+bool mr_queue_add(uint8_t *packet, uint8_t length) {
+    return mr_queue_add_with_priority(packet, length, MARI_PRIORITY_NORMAL, 0);
+}
+
+// returns false if the queue is full
+bool mr_queue_add_with_priority(uint8_t *packet, uint8_t length, mr_priority_t priority, uint64_t expiry_asn) {
     // lock is asymetrical: add (called from application) can wait in busy loop
     while (queue_vars.queue_locked) {
         // wait for the queue to be unlocked
     }
     queue_vars.queue_locked = true;
 
+    if (queue_vars.free_slots_len == 0) {
+        queue_vars.dropped_full++;
+        mr_stats_inc(MARI_STATS_QUEUE_FULL);
+        queue_vars.queue_locked = false;
+        return false;
+    }
+
     // enqueue for transmission
-    memcpy(queue_vars.packet_queue.packets[queue_vars.packet_queue.last].buffer, packet, length);
-    queue_vars.packet_queue.packets[queue_vars.packet_queue.last].length = length;
+    uint8_t              slot  = queue_vars.free_slots[--queue_vars.free_slots_len];
+    mari_packet_queue_t *queue = &queue_vars.packet_queues[priority];
+    memcpy(queue_vars.packets[slot].buffer, packet, length);
+    queue_vars.packets[slot].length     = length;
+    queue_vars.packets[slot].expiry_asn = expiry_asn;
+    queue->slots[queue->last]           = slot;
     // increment the `last` index
-    queue_vars.packet_queue.last = (queue_vars.packet_queue.last + 1) % MARI_PACKET_QUEUE_SIZE;
+    queue->last = (queue->last + 1) % MARI_PACKET_QUEUE_SIZE;
 
     queue_vars.queue_locked = false;
+    return true;
 }
 
 uint8_t mr_queue_peek(uint8_t *packet) {
@@ -118,13 +199,14 @@ uint8_t mr_queue_peek(uint8_t *packet) {
         return 0;
     }
 
-    if (queue_vars.packet_queue.current == queue_vars.packet_queue.last) {
+    int16_t slot = _next_slot();
+    if (slot < 0) {
         return 0;
     }
 
-    memcpy(packet, queue_vars.packet_queue.packets[queue_vars.packet_queue.current].buffer, queue_vars.packet_queue.packets[queue_vars.packet_queue.current].length);
+    memcpy(packet, queue_vars.packets[slot].buffer, queue_vars.packets[slot].length);
     // do not increment the `current` index here, as this is just a peek
-    return queue_vars.packet_queue.packets[queue_vars.packet_queue.current].length;
+    return queue_vars.packets[slot].length;
 }
 
 bool mr_queue_pop(void) {
@@ -134,39 +216,112 @@ bool mr_queue_pop(void) {
         return false;
     }
 
-    if (queue_vars.packet_queue.current == queue_vars.packet_queue.last) {
-        return false;
-    } else {
-        // increment the `current` index
-        queue_vars.packet_queue.current = (queue_vars.packet_queue.current + 1) % MARI_PACKET_QUEUE_SIZE;
-        return true;
+    for (uint8_t priority = 0; priority < MARI_N_PRIORITIES; priority++) {
+        mari_packet_queue_t *queue = &queue_vars.packet_queues[priority];
+        if (queue->current != queue->last) {
+            // give the entry back to the pool, and increment the `current` index
+            queue_vars.free_slots[queue_vars.free_slots_len++] = queue->slots[queue->current];
+            queue->current                                     = (queue->current + 1) % MARI_PACKET_QUEUE_SIZE;
+            return true;
+        }
     }
+    return false;
 }
 
 void mr_queue_reset(void) {
-    queue_vars.packet_queue.current = 0;
-    queue_vars.packet_queue.last    = 0;
-    queue_vars.join_packet.length   = 0;
-    queue_vars.queue_locked         = false;
+    // a node that joins resets its queue from the bottom half, which the timer isr can preempt to send from it
+    uint32_t primask = mr_critical_enter();
+    for (uint8_t priority = 0; priority < MARI_N_PRIORITIES; priority++) {
+        queue_vars.packet_queues[priority].current = 0;
+        queue_vars.packet_queues[priority].last    = 0;
+    }
+    for (uint8_t i = 0; i < MARI_PACKET_QUEUE_SIZE - 1; i++) {
+        queue_vars.free_slots[i] = i;
+    }
+    queue_vars.free_slots_len     = MARI_PACKET_QUEUE_SIZE - 1;
+    queue_vars.join_packet.length = 0;
+    queue_vars.join_responses_len = 0;
+    queue_vars.queue_locked       = false;
     memset(queue_vars.join_packet.buffer, 0, sizeof(queue_vars.join_packet.buffer));
+    mr_critical_exit(primask);
+}
+
+uint32_t mr_queue_get_dropped_expired(void) {
+    return queue_vars.dropped_expired;
+}
+
+uint32_t mr_queue_get_dropped_full(void) {
+    return queue_vars.dropped_full;
+}
+
+// used by the node: replaces the value of a mailbox, the previous one is dropped if it was not sent yet
+bool mr_queue_node_set_mailbox(uint8_t mailbox_id, const uint8_t *payload, uint8_t payload_len) {
+    if (mailbox_id >= MARI_N_MAILBOXES || payload_len > MARI_MAILBOX_MAX_PAYLOAD) {
+        return false;
+    }
+
+    // same asymmetric lock as the queue
+    while (queue_vars.queue_locked) {
+        // wait for the queue to be unlocked
+    }
+    queue_vars.queue_locked = true;
+
+    mr_mailbox_t *mailbox = &queue_vars.mailboxes[mailbox_id];
+    memcpy(mailbox->payload, payload, payload_len);
+    mailbox->length  = payload_len;
+    mailbox->pending = true;
+
+    queue_vars.queue_locked = false;
+    return true;
 }
 
 void mr_queue_set_join_request(uint64_t node_id) {
     queue_vars.join_packet.length = mr_build_packet_join_request(queue_vars.join_packet.buffer, node_id);
 }
 
-void mr_queue_set_join_response(uint64_t node_id, uint8_t assigned_cell_id) {
-    uint8_t len                          = mr_build_packet_join_response(queue_vars.join_packet.buffer, node_id);
-    queue_vars.join_packet.buffer[len++] = assigned_cell_id;
-    queue_vars.join_packet.length        = len;
+bool mr_queue_set_join_response(uint64_t node_id, uint16_t assigned_cell_id) {
+    // called from the bottom half, the timer isr that sends and clears the responses must see the record and the length together
+    uint32_t primask = mr_critical_enter();
+    bool     queued  = true;
+    size_t   i       = 0;
+    while (i < queue_vars.join_responses_len && queue_vars.join_responses[i].node_id != node_id) {
+        i++;
+    }
+    if (i < queue_vars.join_responses_len) {
+        // the node asked again before getting its response, just refresh it
+        queue_vars.join_responses[i].cell_id = assigned_cell_id;
+    } else if (queue_vars.join_responses_len == MARI_JOIN_RESPONSE_QUEUE_SIZE) {
+        // queue full, the node will time out and try again
+        queued = false;
+    } else {
+        queue_vars.join_responses[queue_vars.join_responses_len] = (mr_join_response_record_t){
+            .node_id = node_id,
+            .cell_id = assigned_cell_id,
+        };
+        queue_vars.join_responses_len++;
+    }
+    mr_critical_exit(primask);
+    return queued;
+}
+
+// used by the node after a handover: packets waiting for the old gateway go to the new one
+void mr_queue_node_redirect(uint64_t old_dst, uint64_t new_dst) {
+    for (uint8_t priority = 0; priority < MARI_N_PRIORITIES; priority++) {
+        mari_packet_queue_t *queue = &queue_vars.packet_queues[priority];
+        for (uint8_t i = queue->current; i != queue->last; i = (i + 1) % MARI_PACKET_QUEUE_SIZE) {
+            mr_packet_header_t *header = (mr_packet_header_t *)queue_vars.packets[queue->slots[i]].buffer;
+            if (header->dst == old_dst) {
+                header->dst = new_dst;
+            }
+        }
+    }
 }
 
 bool mr_queue_has_join_packet(void) {
     return queue_vars.join_packet.length > 0;
 }
 
-// if used by the node, gets it a join request packet
-// if used by the gateway, gets it a join response packet
+// used by the node: gets it a join request packet
 uint8_t mr_queue_get_join_packet(uint8_t *packet) {
     memcpy(packet, queue_vars.join_packet.buffer, queue_vars.join_packet.length);
     uint8_t len = queue_vars.join_packet.length;
@@ -176,3 +331,241 @@ uint8_t mr_queue_get_join_packet(uint8_t *packet) {
 
     return len;
 }
+
+bool mr_queue_has_join_response(void) {
+    return queue_vars.join_responses_len > 0;
+}
+
+// used by the gateway: aggregates all pending join responses in a single packet, and clears them
+uint8_t mr_queue_get_join_response(uint8_t *packet) {
+    uint32_t primask = mr_critical_enter();
+    uint8_t  count   = queue_vars.join_responses_len;
+    uint64_t dst     = count == 1 ? queue_vars.join_responses[0].node_id : MARI_BROADCAST_ADDRESS;
+    uint8_t  len     = mr_build_packet_join_response(packet, dst, queue_vars.join_responses, count, mr_assoc_gateway_get_join_groups());
+
+    queue_vars.join_responses_len = 0;
+    mr_critical_exit(primask);
+
+    return len;
+}
+
+// used by the gateway after a schedule switch: refresh the cell ids of the pending join responses
+void mr_queue_gateway_remap_join_responses(void) {
+    for (size_t i = 0; i < queue_vars.join_responses_len; i++) {
+        int16_t cell_id = mr_scheduler_gateway_get_node_cell(queue_vars.join_responses[i].node_id);
+        if (cell_id >= 0) {
+            queue_vars.join_responses[i].cell_id = cell_id;
+        }
+    }
+}
+
+//=========================== private ==========================================
+
+// used by the node: packs the mailboxes not sent yet in a single frame, as many as fit, and marks them as sent
+// returns the length of the frame, 0 if there is nothing to send
+static uint8_t _node_get_mailboxes(uint8_t *packet) {
+    if (queue_vars.queue_locked) {
+        return 0;
+    }
+
+    uint64_t dst       = mr_mac_get_synced_gateway();
+    int16_t  ordinal   = mr_scheduler_node_get_uplink_ordinal();
+    size_t   frame_len = mr_build_packet_data_aggregated(packet, dst);
+    uint8_t  n_records = 0;
+    uint8_t  first     = 0;
+    for (uint8_t i = 0; i < MARI_N_MAILBOXES; i++) {
+        uint8_t       mailbox_id = (queue_vars.next_mailbox + i) % MARI_N_MAILBOXES;
+        mr_mailbox_t *mailbox    = &queue_vars.mailboxes[mailbox_id];
+        if (!mailbox->pending) {
+            continue;
+        }
+        size_t new_len = mr_packet_aggregated_add_record(packet, frame_len, ordinal, mailbox->payload, mailbox->length);
+        if (new_len == 0) {
+            // the frame is full, this one goes first next time
+            queue_vars.next_mailbox = mailbox_id;
+            break;
+        }
+        mailbox->pending = false;
+        frame_len        = new_len;
+        if (n_records++ == 0) {
+            first = mailbox_id;
+        }
+    }
+
+    if (n_records == 0) {
+        return 0;
+    }
+    if (n_records == 1) {
+        // a single value goes as a regular data packet
+        return mr_build_packet_data(packet, dst, queue_vars.mailboxes[first].payload, queue_vars.mailboxes[first].length);
+    }
+    return frame_len;
+}
+
+// returns the pool entry of the next packet to send, from the highest priority class that has one, or -1 if there is none
+// packets past their expiry are dropped on the way. must only be called while the queue is not locked
+static int16_t _next_slot(void) {
+    uint64_t asn = mr_mac_get_asn();
+    for (uint8_t priority = 0; priority < MARI_N_PRIORITIES; priority++) {
+        mari_packet_queue_t *queue = &queue_vars.packet_queues[priority];
+        while (queue->current != queue->last) {
+            uint8_t slot = queue->slots[queue->current];
+            if (queue_vars.packets[slot].expiry_asn == 0 || asn <= queue_vars.packets[slot].expiry_asn) {
+                return slot;
+            }
+            // too late, drop it
+            queue_vars.dropped_expired++;
+            mr_stats_inc(MARI_STATS_QUEUE_EXPIRED);
+            queue_vars.free_slots[queue_vars.free_slots_len++] = slot;
+            queue->current                                     = (queue->current + 1) % MARI_PACKET_QUEUE_SIZE;
+        }
+    }
+    return -1;
+}
+
+// packs the data packets that follow the one popped from the queue in a single frame, while they fit
+// the order of the queue is kept. returns the length of the frame to send, the packet is left as is if there is nothing to pack it with
+static uint8_t _aggregate_data_packets(uint8_t *packet, uint8_t length) {
+    uint64_t dst     = ((mr_packet_header_t *)packet)->dst;
+    int16_t  ordinal = _aggregation_ordinal(packet, length, dst);
+    if (ordinal < 0) {
+        return length;
+    }
+
+    // downlink frames are heard by all the nodes, uplink frames go to the gateway of the packets
+    uint8_t frame[MARI_PACKET_MAX_SIZE];
+    size_t  frame_len = mr_build_packet_data_aggregated(frame, mari_get_node_type() == MARI_GATEWAY ? MARI_BROADCAST_ADDRESS : dst);
+    frame_len         = mr_packet_aggregated_add_record(frame, frame_len, ordinal, packet + sizeof(mr_packet_header_t), length - sizeof(mr_packet_header_t));
+    uint8_t n_records = 1;
+    uint8_t priority;
+    int16_t index;
+    while ((index = _next_entry(&priority)) >= 0) {
+        mr_packet_t *next = &queue_vars.packets[queue_vars.packet_queues[priority].slots[index]];
+        ordinal           = _aggregation_ordinal(next->buffer, next->length, dst);
+        if (ordinal < 0) {
+            break;
+        }
+        size_t new_len = mr_packet_aggregated_add_record(frame, frame_len, ordinal, next->buffer + sizeof(mr_packet_header_t), next->length - sizeof(mr_packet_header_t));
+        if (new_len == 0) {
+            // the frame is full
+            break;
+        }
+        _remove_entry(priority, index);
+        frame_len = new_len;
+        n_records++;
+    }
+
+    if (n_records < 2) {
+        // nothing to pack it with, send it on its own
+        return length;
+    }
+    memcpy(packet, frame, frame_len);
+    return frame_len;
+}
+
+// returns the ordinal to put in the record of a packet that can be aggregated, or -1 if it must be sent on its own
+// dst is the destination of the first packet of the frame
+static int16_t _aggregation_ordinal(const uint8_t *packet, uint8_t length, uint64_t dst) {
+    mr_packet_header_t *header = (mr_packet_header_t *)packet;
+    if (header->type != MARI_PACKET_DATA) {
+        return -1;
+    }
+    if (mari_get_node_type() == MARI_GATEWAY) {
+        if (length - sizeof(mr_packet_header_t) > MARI_DOWNLINK_AGGREGATION_MAX_PAYLOAD) {
+            return -1;
+        }
+        // the ordinal of the destination, group and broadcast packets have no single destination and are sent as they are
+        return mr_scheduler_gateway_get_node_ordinal(header->dst);
+    }
+    // packets queued for a gateway the node has left are not packed with the others
+    if (header->dst != dst) {
+        return -1;
+    }
+    // the ordinal of the sender, the gateway knows it already
+    return mr_scheduler_node_get_uplink_ordinal();
+}
+
+// the next packet to send, as an index in packet_queues[*priority].slots, -1 if there is none or the queue is locked
+// at the node, the head of the queue. at the gateway, the first packet announced in the beacons of this slotframe:
+// the other destinations may be asleep, and the packets queued for them after the beacons wait for the next slotframe
+static int16_t _next_entry(uint8_t *priority) {
+    if (queue_vars.queue_locked || _next_slot() < 0) {
+        // also drops the expired packets at the head
+        return -1;
+    }
+    uint64_t asn = mr_mac_get_asn();
+    for (uint8_t p = 0; p < MARI_N_PRIORITIES; p++) {
+        mari_packet_queue_t *queue = &queue_vars.packet_queues[p];
+        for (uint8_t i = queue->current; i != queue->last; i = (i + 1) % MARI_PACKET_QUEUE_SIZE) {
+            mr_packet_t *entry = &queue_vars.packets[queue->slots[i]];
+            if (mari_get_node_type() == MARI_GATEWAY) {
+                bool expired = entry->expiry_asn != 0 && asn > entry->expiry_asn;
+                if (expired || !_downlink_is_announced(((mr_packet_header_t *)entry->buffer)->dst)) {
+                    // expired packets are dropped once at the head
+                    continue;
+                }
+            }
+            *priority = p;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// gives the entry back to the pool, the packets queued before it move up one place so that the order is kept
+static void _remove_entry(uint8_t priority, uint8_t index) {
+    mari_packet_queue_t *queue                         = &queue_vars.packet_queues[priority];
+    queue_vars.free_slots[queue_vars.free_slots_len++] = queue->slots[index];
+    while (index != queue->current) {
+        uint8_t previous    = (index + MARI_PACKET_QUEUE_SIZE - 1) % MARI_PACKET_QUEUE_SIZE;
+        queue->slots[index] = queue->slots[previous];
+        index               = previous;
+    }
+    queue->current = (queue->current + 1) % MARI_PACKET_QUEUE_SIZE;
+}
+
+// true if the beacons of this slotframe woke up the destination of a downlink
+static bool _downlink_is_announced(uint64_t dst) {
+    if (queue_vars.downlink_pending_len == MARI_DOWNLINK_PENDING_ALL) {
+        return true;
+    }
+    if ((dst & MARI_GROUP_ADDRESS_PREFIX) == MARI_GROUP_ADDRESS_PREFIX) {
+        // broadcast and groups, every node must listen
+        return false;
+    }
+    int16_t ordinal = mr_scheduler_gateway_get_node_ordinal(dst);
+    if (ordinal < 0) {
+        // not joined: the node listens to every downlink slot anyway, or is gone
+        return true;
+    }
+    return ordinal / 8 < queue_vars.downlink_pending_len && (queue_vars.downlink_pending[ordinal / 8] & (1 << (ordinal % 8)));
+}
+
+// the destinations of all the queued packets, and of every node if the application is adding one right now
+static void _gateway_downlink_pending(void) {
+    queue_vars.downlink_pending_len = MARI_DOWNLINK_PENDING_ALL;
+    if (!MARI_ENABLE_DOWNLINK_PENDING || queue_vars.queue_locked) {
+        return;
+    }
+    uint8_t len = 0;
+    memset(queue_vars.downlink_pending, 0, sizeof(queue_vars.downlink_pending));
+    for (uint8_t priority = 0; priority < MARI_N_PRIORITIES; priority++) {
+        mari_packet_queue_t *queue = &queue_vars.packet_queues[priority];
+        for (uint8_t i = queue->current; i != queue->last; i = (i + 1) % MARI_PACKET_QUEUE_SIZE) {
+            uint64_t dst = ((mr_packet_header_t *)queue_vars.packets[queue->slots[i]].buffer)->dst;
+            if ((dst & MARI_GROUP_ADDRESS_PREFIX) == MARI_GROUP_ADDRESS_PREFIX) {
+                // broadcast and groups, every node listens
+                return;
+            }
+            int16_t ordinal = mr_scheduler_gateway_get_node_ordinal(dst);
+            if (ordinal < 0) {
+                continue;
+            }
+            queue_vars.downlink_pending[ordinal / 8] |= 1 << (ordinal % 8);
+            if (ordinal / 8 >= len) {
+                len = ordinal / 8 + 1;
+            }
+        }
+    }
+    queue_vars.downlink_pending_len = len;
+}
@@ -19,23 +19,44 @@
 
 //=========================== defines =========================================
 
-#define MARI_PACKET_QUEUE_SIZE (32)  // must be a power of 2
+#define MARI_PACKET_QUEUE_SIZE (32)  // must be a power of 2, holds up to MARI_PACKET_QUEUE_SIZE - 1 packets, all priority classes together
 
 #define MARI_AUTO_UPLINK_KEEPALIVE 1  // whether to send a keepalive packet when there is nothing to send
 
+#define MARI_JOIN_RESPONSE_QUEUE_SIZE (16)  // join responses waiting for a downlink slot, all sent in a single frame
+
+#define MARI_ENABLE_DOWNLINK_AGGREGATION      1     // whether the gateway packs small data packets for several nodes in a single downlink frame
+#define MARI_DOWNLINK_AGGREGATION_MAX_PAYLOAD (32)  // larger payloads are sent on their own
+#define MARI_ENABLE_UPLINK_COALESCING         1     // whether a node packs its queued data packets in a single uplink frame
+#define MARI_ENABLE_DOWNLINK_PENDING          1     // whether the beacons announce the pending downlinks, so that joined nodes sleep through the other downlink slots
+
+#define MARI_N_MAILBOXES         (4)  // latest-value slots of a node, sent when its queue is empty
+#define MARI_MAILBOX_MAX_PAYLOAD (64)
+
 //=========================== prototypes ======================================
 
-void    mr_queue_add(uint8_t *packet, uint8_t length);
-uint8_t mr_queue_next_packet(slot_type_t slot_type, uint8_t *packet);
-uint8_t mr_queue_peek(uint8_t *packet);
-bool    mr_queue_pop(void);
-void    mr_queue_reset(void);
+void     mr_queue_init(void);
+bool     mr_queue_add(uint8_t *packet, uint8_t length);
+bool     mr_queue_add_with_priority(uint8_t *packet, uint8_t length, mr_priority_t priority, uint64_t expiry_asn);
+uint8_t  mr_queue_next_packet(slot_type_t slot_type, uint8_t *packet);
+uint8_t  mr_queue_peek(uint8_t *packet);
+bool     mr_queue_pop(void);
+void     mr_queue_reset(void);
+uint32_t mr_queue_get_dropped_expired(void);
+uint32_t mr_queue_get_dropped_full(void);
+
+bool mr_queue_node_set_mailbox(uint8_t mailbox_id, const uint8_t *payload, uint8_t payload_len);
 
 // void mr_queue_set_join_packet(uint64_t node_id, mr_packet_type_t packet_type);
 void mr_queue_set_join_request(uint64_t node_id);
-void mr_queue_set_join_response(uint64_t node_id, uint8_t assigned_cell_id);
+bool mr_queue_set_join_response(uint64_t node_id, uint16_t assigned_cell_id);
+void mr_queue_node_redirect(uint64_t old_dst, uint64_t new_dst);
 
 bool    mr_queue_has_join_packet(void);
 uint8_t mr_queue_get_join_packet(uint8_t *packet);
 
+bool    mr_queue_has_join_response(void);
+uint8_t mr_queue_get_join_response(uint8_t *packet);
+void    mr_queue_gateway_remap_join_responses(void);
+
 #endif  // __QUEUE_H
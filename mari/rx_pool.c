@@ -0,0 +1,92 @@
+/**
+ * @file
+ * @ingroup     rx_pool
+ *
+ * @brief       Pool of the buffers frames are received in
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+
+#include <nrf.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "rx_pool.h"
+
+//=========================== defines ==========================================
+
+typedef struct {
+    mr_rx_buffer_t buffers[MARI_RX_POOL_SIZE];
+    uint8_t        refs[MARI_RX_POOL_SIZE];  // number of holders of each buffer, 0 if it is free
+    uint32_t       exhausted;                // allocations that failed because all buffers were held
+} rx_pool_vars_t;
+
+//=========================== variables ========================================
+
+static rx_pool_vars_t rx_pool_vars = { 0 };
+
+//=========================== prototypes =======================================
+
+static int32_t _index_of(const void *packet);
+
+//=========================== public ===========================================
+
+void mr_rx_pool_init(void) {
+    memset(rx_pool_vars.refs, 0, sizeof(rx_pool_vars.refs));
+    rx_pool_vars.exhausted = 0;
+}
+
+mr_rx_buffer_t *mr_rx_pool_alloc(void) {
+    for (uint8_t i = 0; i < MARI_RX_POOL_SIZE; i++) {
+        uint8_t expected = 0;
+        if (__atomic_compare_exchange_n(&rx_pool_vars.refs[i], &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return &rx_pool_vars.buffers[i];
+        }
+    }
+    __atomic_fetch_add(&rx_pool_vars.exhausted, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+void mr_rx_pool_hold(const void *packet) {
+    int32_t idx = _index_of(packet);
+    if (idx < 0) {
+        return;
+    }
+    __atomic_fetch_add(&rx_pool_vars.refs[idx], 1, __ATOMIC_RELAXED);
+}
+
+void mr_rx_pool_release(const void *packet) {
+    int32_t idx = _index_of(packet);
+    if (idx < 0) {
+        return;
+    }
+    // release ordering, so that the buffer is done with before the radio can write into it again
+    __atomic_fetch_sub(&rx_pool_vars.refs[idx], 1, __ATOMIC_RELEASE);
+}
+
+uint8_t mr_rx_pool_count_free(void) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MARI_RX_POOL_SIZE; i++) {
+        count += __atomic_load_n(&rx_pool_vars.refs[i], __ATOMIC_RELAXED) == 0;
+    }
+    return count;
+}
+
+uint32_t mr_rx_pool_get_exhausted(void) {
+    return __atomic_load_n(&rx_pool_vars.exhausted, __ATOMIC_RELAXED);
+}
+
+//=========================== private ==========================================
+
+// returns the index of the buffer a pointer is in, or -1 if it is not in the pool
+static int32_t _index_of(const void *packet) {
+    const uint8_t *start = (const uint8_t *)rx_pool_vars.buffers;
+    const uint8_t *ptr   = (const uint8_t *)packet;
+    if (ptr < start || ptr >= start + sizeof(rx_pool_vars.buffers)) {
+        return -1;
+    }
+    return (ptr - start) / sizeof(mr_rx_buffer_t);
+}
@@ -0,0 +1,65 @@
+#ifndef __RX_POOL_H
+#define __RX_POOL_H
+
+/**
+ * @ingroup     mari
+ * @brief       Pool of the buffers frames are received in
+ *
+ * The radio writes each frame directly into a buffer of the pool, which then goes, without being copied, to the
+ * bottom half of the radio interrupt, to the event ring and to the application.
+ * Each buffer has a reference count: it goes back to the pool when the last of its holders releases it.
+ * References are taken and dropped with atomic operations, from any interrupt or from the main loop.
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025-now
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "models.h"
+#include "mr_radio.h"
+
+//=========================== defines =========================================
+
+#ifndef MARI_RX_POOL_SIZE
+#define MARI_RX_POOL_SIZE (8)
+#endif
+
+// a received frame, laid out as the radio PDU so that the radio can write into it
+typedef struct {
+    uint8_t pdu[MR_RADIO_PDU_HEADER_LENGTH + MARI_PACKET_MAX_SIZE];
+} mr_rx_buffer_t;
+
+//=========================== prototypes ======================================
+
+void mr_rx_pool_init(void);
+
+/**
+ * @brief Takes a free buffer, with one reference
+ *
+ * @return the buffer, or NULL if the pool is exhausted
+ */
+mr_rx_buffer_t *mr_rx_pool_alloc(void);
+
+/**
+ * @brief Takes one more reference on the buffer a packet is in
+ *
+ * @param[in] packet    Any pointer into the buffer, does nothing if it is not in the pool
+ */
+void mr_rx_pool_hold(const void *packet);
+
+/**
+ * @brief Drops one reference on the buffer a packet is in, the buffer is free once no reference is left
+ *
+ * @param[in] packet    Any pointer into the buffer, does nothing if it is not in the pool
+ */
+void mr_rx_pool_release(const void *packet);
+
+uint8_t  mr_rx_pool_count_free(void);
+uint32_t mr_rx_pool_get_exhausted(void);
+
+#endif  // __RX_POOL_H
@@ -12,133 +12,135 @@
 #include <nrf.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
 #include "scan.h"
+#include "stats.h"
+#include "profile.h"
+
+//=========================== defines =========================================
+
+#define MARI_SCAN_HASH_MULTIPLY 0x9E3779B97F4A7C15ULL  // Fibonacci hashing
 
 //=========================== variables =======================================
 
 typedef struct {
     mr_gateway_scan_t scans[MARI_MAX_SCAN_LIST_SIZE];
+    uint8_t           n_scans;                      // number of entries in use, they are taken in order until the list is full
+    uint8_t           newest;                       // index + 1 of the gateway heard last, 0 if none
+    uint8_t           oldest;                       // index + 1 of the gateway heard first, replaced when the list is full
+    uint8_t           index[MARI_SCAN_INDEX_SIZE];  // gateway id -> index + 1, 0 if the slot is empty
 } scan_vars_t;
 
 scan_vars_t scan_vars = { 0 };
 
 //=========================== prototypes ======================================
 
-void              _save_rssi(size_t idx, mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts_scan, uint64_t asn_scan);
-uint32_t          _get_ts_latest(mr_gateway_scan_t scan);
-mr_channel_info_t _get_channel_info_latest(mr_gateway_scan_t scan);
-bool              _scan_is_too_old(mr_gateway_scan_t scan, uint32_t ts_scan);
+void    _save_rssi(size_t idx, mr_beacon_packet_header_t beacon, int8_t rssi, uint32_t ts_scan, uint64_t asn_scan);
+int32_t _score(const mr_gateway_scan_t *scan);
+
+// list of the gateways, from the most to the least recently heard
+void _list_remove(size_t idx);
+void _list_push_newest(size_t idx);
+
+// hash table of the gateways
+size_t  _index_home(uint64_t gateway_id);
+int32_t _index_find(uint64_t gateway_id);
+void    _index_insert(uint64_t gateway_id, size_t idx);
+void    _index_remove(uint64_t gateway_id);
 
 //=========================== public ===========================================
 
-// This function is a bit more complicated than it needed to be, but by inserting the rssi reading
-// in a smart way, later it beacomes very easy and efficient to compute the average rssi.
-// It does a few things:
-// 1. If the gateway_id (beacon.src) is already in the scan list, update the rssi reading.
-// 2. Check for old rssi readings and remove them
-//   - meaning that the loop always goes through the whole list, but it's small, so it's fine.
-//   - and also, in most cases it will have to cycle through the whole list anyway, to find old readings to replace.
-// 3. Look for empty spots, in case the gateway_id is not yet in the list.
-// 4. Save the oldest reading, to be overwritten, in case there are no empty spots.
+// Runs for every beacon heard while scanning, in constant time:
+// 1. Look up the gateway_id (beacon.src) in the hash table.
+// 2. If it is not there, take a free entry, or replace the least recently heard gateway when the list is full.
+// 3. Move the gateway to the front of the list, so that the list stays sorted by last reading.
+// 4. Fold the rssi reading into the averages of the gateway.
 void mr_scan_add(mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts_scan, uint64_t asn_scan) {
-    uint64_t gateway_id        = beacon.src;
-    bool     found             = false;
-    int16_t  empty_spot_idx    = -1;
-    uint32_t ts_oldest_all     = ts_scan;
-    uint32_t ts_oldest_all_idx = 0;
-    for (size_t i = 0; i < MARI_MAX_SCAN_LIST_SIZE; i++) {
-        // if found this gateway_id, update its respective rssi entry and mark as found.
-        if (scan_vars.scans[i].gateway_id == gateway_id) {
-            _save_rssi(i, beacon, rssi, channel, ts_scan, asn_scan);
-            found = true;
-            continue;
-        }
+    MR_PROFILE_SCOPE(MARI_PROFILE_SCAN_ADD);
+    (void)channel;  // the readings of the 3 advertising channels go into the same averages, their spread shows in the deviation
 
-        // try and save the first empty spot we see
-        // if gateway_id == 0, there is an empty spot here, save the index (will only do this once)
-        if (scan_vars.scans[i].gateway_id == 0 && empty_spot_idx < 0) {
-            empty_spot_idx = i;
-        }
-
-        uint32_t ts_cmp = _get_ts_latest(scan_vars.scans[i]);
-        if (scan_vars.scans[i].gateway_id != 0 && ts_cmp < ts_oldest_all) {
-            ts_oldest_all     = ts_cmp;
-            ts_oldest_all_idx = i;
-        }
-    }
-    if (found) {
-        // if found a matching gateway_id, nothing else to do
-        return;
+    uint64_t gateway_id = beacon.src;
+    int32_t  idx        = _index_find(gateway_id);
+    if (idx >= 0) {
+        _list_remove(idx);
     } else {
-        // if not, find an optimal spot for saving this new rssi reading
-        //   either save it onto an empty spot, or override the oldest one
-        if (empty_spot_idx >= 0) {  // there is an empty spot
-            scan_vars.scans[empty_spot_idx].gateway_id = gateway_id;
-            _save_rssi(empty_spot_idx, beacon, rssi, channel, ts_scan, asn_scan);
+        if (scan_vars.n_scans < MARI_MAX_SCAN_LIST_SIZE) {
+            idx = scan_vars.n_scans++;
         } else {
-            // last case: didn't match the gateeway_id, and didn't find an empty slot,
-            // so overwrite the oldest reading
-            memset(&scan_vars.scans[ts_oldest_all_idx], 0, sizeof(mr_gateway_scan_t));
-            scan_vars.scans[ts_oldest_all_idx].gateway_id = gateway_id;
-            _save_rssi(ts_oldest_all_idx, beacon, rssi, channel, ts_scan, asn_scan);
+            idx = scan_vars.oldest - 1;
+            mr_stats_inc(MARI_STATS_SCAN_EVICTIONS);
+            _list_remove(idx);
+            _index_remove(scan_vars.scans[idx].gateway_id);
         }
+        memset(&scan_vars.scans[idx], 0, sizeof(mr_gateway_scan_t));
+        scan_vars.scans[idx].gateway_id = gateway_id;
+        _index_insert(gateway_id, idx);
     }
+    _list_push_newest(idx);
+    _save_rssi(idx, beacon, rssi, ts_scan, asn_scan);
+    mr_stats_inc(MARI_STATS_SCAN_BEACONS);
 }
 
-// Compute the average rssi for each gateway, and return the highest one.
-// The documentation says that remaining capacity should also be taken into account,
-// but we will simply not add a gateway to the scan list if its capacity if full.
+// Rank the gateways heard recently, and return the one with the highest score.
+// The score weighs the link quality (average rssi, minus its deviation) against the room left at the gateway,
+// so that among gateways with similar links, nodes spread over the least loaded ones.
 bool mr_scan_select(mr_channel_info_t *best_channel_info, uint32_t ts_scan_started, uint32_t ts_scan_ended) {
-    int8_t best_gateway_idx = -1;
+    MR_PROFILE_SCOPE(MARI_PROFILE_SCAN_SELECT);
+    int32_t best_gateway_idx = -1;
     // make sure best_channel_info is zeroed out
     memset(best_channel_info, 0, sizeof(mr_channel_info_t));
-    int8_t best_gateway_rssi = INT8_MIN;
-    for (size_t i = 0; i < MARI_MAX_SCAN_LIST_SIZE; i++) {
-        if (scan_vars.scans[i].gateway_id == 0) {
+    int32_t best_gateway_score = INT32_MIN;
+    // NOTE: the list is sorted by arrival, which is not always the order of the timestamps, so check every gateway
+    for (uint8_t next = scan_vars.newest; next != 0; next = scan_vars.scans[next - 1].older) {
+        mr_gateway_scan_t *scan = &scan_vars.scans[next - 1];
+        // check twice for old scans: scans from before this scan started, and scans older than the mari configuration
+        if (scan->latest.timestamp < ts_scan_started) {  // scan info is too old
             continue;
         }
-        // compute average rssi, only including the rssi readings that are not too old
-        int8_t avg_rssi = 0;
-        int8_t n_rssi   = 0;
-        for (size_t j = 0; j < MARI_N_BLE_ADVERTISING_CHANNELS; j++) {
-            if (scan_vars.scans[i].channel_info[j].timestamp == 0) {  // no scan info reading here
-                continue;
-            }
-            // check twice for old scans: scans from before this scan started, and scans older than the mari configuration
-            if (scan_vars.scans[i].channel_info[j].timestamp < ts_scan_started) {  // scan info is too old
-                continue;
-            }
-            if (ts_scan_ended - scan_vars.scans[i].channel_info[j].timestamp > MARI_SCAN_OLD_US) {  // scan info is is too old
-                continue;
-            }
-            avg_rssi += scan_vars.scans[i].channel_info[j].rssi;
-            n_rssi++;
+        if (ts_scan_ended - scan->latest.timestamp > MARI_SCAN_OLD_US) {  // scan info is too old
+            continue;
         }
-        if (n_rssi == 0) {
+        if (scan->latest.beacon.remaining_capacity == 0) {
+            // this gateway is full
             continue;
         }
-        avg_rssi /= n_rssi;
-        if (avg_rssi > best_gateway_rssi) {
-            best_gateway_rssi = avg_rssi;
-            best_gateway_idx  = i;
+        int32_t score = _score(scan);
+        if (score > best_gateway_score) {
+            best_gateway_score = score;
+            best_gateway_idx   = next - 1;
         }
     }
     if (best_gateway_idx < 0) {
         return false;
     }
-    *best_channel_info = _get_channel_info_latest(scan_vars.scans[best_gateway_idx]);
-    // TODO: should probably report the average rssi: best_channel_info->rssi = best_gateway_rssi;
+    *best_channel_info = scan_vars.scans[best_gateway_idx].latest;
+    // report the average rssi rather than the last reading, e.g. for the handover hysteresis
+    int16_t rssi_avg        = scan_vars.scans[best_gateway_idx].rssi_avg;
+    best_channel_info->rssi = (rssi_avg + (rssi_avg < 0 ? -8 : 8)) / 16;
     return true;
 }
 
 //=========================== private ==========================================
 
-inline void _save_rssi(size_t idx, mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts_scan, uint64_t asn_scan) {
-    size_t channel_idx = channel % MARI_N_BLE_REGULAR_CHANNELS;
-    // copy beacon without bloom filter to reduce memory consumption during scan
+void _save_rssi(size_t idx, mr_beacon_packet_header_t beacon, int8_t rssi, uint32_t ts_scan, uint64_t asn_scan) {
+    mr_gateway_scan_t *scan = &scan_vars.scans[idx];
+
+    // exponentially weighted averages of the rssi and of its deviation, as for the round-trip time in TCP
+    int32_t rssi_16 = rssi * 16;
+    if (scan->latest.timestamp == 0 || ts_scan - scan->latest.timestamp > MARI_SCAN_OLD_US) {
+        // first reading, or the previous ones are too old to be relevant
+        scan->rssi_avg = rssi_16;
+        scan->rssi_dev = MARI_SCAN_RSSI_DEVIATION_INIT * 16;
+    } else {
+        int32_t error = rssi_16 - scan->rssi_avg;
+        scan->rssi_avg += error / (1 << MARI_SCAN_EWMA_SHIFT);
+        scan->rssi_dev += (abs(error) - (int32_t)scan->rssi_dev) / (1 << MARI_SCAN_EWMA_SHIFT);
+    }
+
+    // copy beacon without the occupancy to reduce memory consumption during scan
     mr_beacon_scan_header_t scan_beacon = {
         .version            = beacon.version,
         .type               = beacon.type,
@@ -146,32 +148,108 @@ inline void _save_rssi(size_t idx, mr_beacon_packet_header_t beacon, int8_t rssi
         .asn                = beacon.asn,
         .src                = beacon.src,
         .remaining_capacity = beacon.remaining_capacity,
-        .active_schedule_id = beacon.active_schedule_id
+        .active_schedule_id = beacon.active_schedule_id,
+        .join_backlog       = beacon.join_backlog,
     };
 
-    scan_vars.scans[idx].channel_info[channel_idx].rssi         = rssi;
-    scan_vars.scans[idx].channel_info[channel_idx].timestamp    = ts_scan;
-    scan_vars.scans[idx].channel_info[channel_idx].captured_asn = asn_scan;
-    scan_vars.scans[idx].channel_info[channel_idx].beacon       = scan_beacon;
+    scan->latest.rssi         = rssi;
+    scan->latest.timestamp    = ts_scan;
+    scan->latest.captured_asn = asn_scan;
+    scan->latest.beacon       = scan_beacon;
 }
 
-inline bool _scan_is_too_old(mr_gateway_scan_t scan, uint32_t ts_scan) {
-    uint32_t ts_latest = _get_ts_latest(scan);
-    return (ts_scan - ts_latest) > MARI_SCAN_OLD_US;
+// score of a gateway, in 1/16 dB
+int32_t _score(const mr_gateway_scan_t *scan) {
+    // nodes already trying to join will take some of the free cells
+    int32_t free_cells = (int32_t)scan->latest.beacon.remaining_capacity - scan->latest.beacon.join_backlog;
+    if (free_cells < 0) {
+        free_cells = 0;
+    } else if (free_cells > MARI_SCAN_CAPACITY_PLENTY) {
+        free_cells = MARI_SCAN_CAPACITY_PLENTY;
+    }
+    int32_t capacity_bonus = MARI_SCAN_SCORE_CAPACITY_DB * 16 * free_cells / MARI_SCAN_CAPACITY_PLENTY;
+    return scan->rssi_avg - MARI_SCAN_SCORE_DEVIATION_WEIGHT * scan->rssi_dev + capacity_bonus;
 }
 
-inline uint32_t _get_ts_latest(mr_gateway_scan_t scan) {
-    mr_channel_info_t latest = _get_channel_info_latest(scan);
-    return latest.timestamp;
+void _list_remove(size_t idx) {
+    mr_gateway_scan_t *scan = &scan_vars.scans[idx];
+    if (scan->newer != 0) {
+        scan_vars.scans[scan->newer - 1].older = scan->older;
+    } else {
+        scan_vars.newest = scan->older;
+    }
+    if (scan->older != 0) {
+        scan_vars.scans[scan->older - 1].newer = scan->newer;
+    } else {
+        scan_vars.oldest = scan->newer;
+    }
+    scan->newer = 0;
+    scan->older = 0;
 }
 
-// get the latest channel_info for a given scan (could be any of them, but the latest will have minimum drift)
-inline mr_channel_info_t _get_channel_info_latest(mr_gateway_scan_t scan) {
-    uint32_t latest_idx = 0;
-    for (size_t i = 0; i < MARI_N_BLE_ADVERTISING_CHANNELS; i++) {
-        if (scan.channel_info[i].timestamp > scan.channel_info[latest_idx].timestamp) {
-            latest_idx = i;
+void _list_push_newest(size_t idx) {
+    mr_gateway_scan_t *scan = &scan_vars.scans[idx];
+    scan->newer             = 0;
+    scan->older             = scan_vars.newest;
+    if (scan_vars.newest != 0) {
+        scan_vars.scans[scan_vars.newest - 1].newer = idx + 1;
+    } else {
+        scan_vars.oldest = idx + 1;
+    }
+    scan_vars.newest = idx + 1;
+}
+
+size_t _index_home(uint64_t gateway_id) {
+    return ((gateway_id * MARI_SCAN_HASH_MULTIPLY) >> 32) % MARI_SCAN_INDEX_SIZE;
+}
+
+// returns the entry of a gateway, or -1 if there is none
+int32_t _index_find(uint64_t gateway_id) {
+    // linear probing, the index is at most half full so this stops after a few slots
+    for (size_t slot = _index_home(gateway_id); scan_vars.index[slot] != 0; slot = (slot + 1) % MARI_SCAN_INDEX_SIZE) {
+        uint8_t idx = scan_vars.index[slot] - 1;
+        if (scan_vars.scans[idx].gateway_id == gateway_id) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+void _index_insert(uint64_t gateway_id, size_t idx) {
+    size_t slot = _index_home(gateway_id);
+    while (scan_vars.index[slot] != 0) {
+        slot = (slot + 1) % MARI_SCAN_INDEX_SIZE;
+    }
+    scan_vars.index[slot] = idx + 1;
+}
+
+void _index_remove(uint64_t gateway_id) {
+    size_t slot = _index_home(gateway_id);
+    while (scan_vars.index[slot] != 0 && scan_vars.scans[scan_vars.index[slot] - 1].gateway_id != gateway_id) {
+        slot = (slot + 1) % MARI_SCAN_INDEX_SIZE;
+    }
+    if (scan_vars.index[slot] == 0) {
+        return;
+    }
+
+    // backward shift deletion: move up the entries that would not be found anymore once the slot is empty
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) % MARI_SCAN_INDEX_SIZE;
+        if (scan_vars.index[next] == 0) {
+            break;
+        }
+        size_t home = _index_home(scan_vars.scans[scan_vars.index[next] - 1].gateway_id);
+        bool   stays;  // true if home is cyclically in (slot, next]
+        if (slot <= next) {
+            stays = slot < home && home <= next;
+        } else {
+            stays = slot < home || home <= next;
+        }
+        if (!stays) {
+            scan_vars.index[slot] = scan_vars.index[next];
+            slot                  = next;
         }
     }
-    return scan.channel_info[latest_idx];
+    scan_vars.index[slot] = 0;
 }
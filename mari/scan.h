@@ -21,22 +21,33 @@
 
 //=========================== defines =========================================
 
-#define MARI_MAX_SCAN_LIST_SIZE       (5)
+#define MARI_MAX_SCAN_LIST_SIZE       (32)               // gateways tracked at once, dense sites have 15+ of them in range
+#define MARI_SCAN_INDEX_SIZE          (64)               // open addressing index over the scan list, kept at most half full
 #define MARI_SCAN_OLD_US              (1000 * 500)       // rssi reading considered old after 500 ms
 #define MARI_HANDOVER_RSSI_HYSTERESIS (24)               // hysteresis (in dBm) for handover
 #define MARI_HANDOVER_MIN_INTERVAL    (1000 * 1000 * 5)  // minimum interval between handovers (in us)
 
+// link quality estimation, rssi values are kept in 1/16 dB
+#define MARI_SCAN_EWMA_SHIFT          (2)  // a new reading weighs 1/4 in the averages
+#define MARI_SCAN_RSSI_DEVIATION_INIT (4)  // dB, deviation assumed for a gateway heard only once
+
+// ranking: score = rssi average - deviation + capacity bonus, in dB
+#define MARI_SCAN_SCORE_DEVIATION_WEIGHT (1)   // dB taken off per dB of rssi deviation, favors stable links
+#define MARI_SCAN_SCORE_CAPACITY_DB      (6)   // dB added to a gateway with plenty of free cells, scaled down as it fills up
+#define MARI_SCAN_CAPACITY_PLENTY        (16)  // free cells, minus the nodes already trying to join, for the whole capacity bonus
+
 //=========================== variables =======================================
 
-// a lightweight scan structure without bloom filter
+// a lightweight scan structure without the occupancy
 typedef struct __attribute__((packed)) {
     uint8_t          version;
     mr_packet_type_t type;
     uint16_t         network_id;
     uint64_t         asn;
     uint64_t         src;
-    uint8_t          remaining_capacity;
+    uint16_t         remaining_capacity;
     uint8_t          active_schedule_id;
+    uint8_t          join_backlog;
 } mr_beacon_scan_header_t;
 
 typedef struct {
@@ -48,13 +59,26 @@ typedef struct {
 
 typedef struct {
     uint64_t          gateway_id;
-    mr_channel_info_t channel_info[MARI_N_BLE_ADVERTISING_CHANNELS];  // channels 37, 38, 39
+    int16_t           rssi_avg;    // EWMA of the rssi, in 1/16 dBm
+    uint16_t          rssi_dev;    // EWMA of the absolute difference between the rssi and its average, in 1/16 dB
+    uint8_t           newer;       // index + 1 of the gateway heard just after this one, 0 if none
+    uint8_t           older;       // index + 1 of the gateway heard just before this one, 0 if none
+    mr_channel_info_t latest;      // latest reading, used to synchronize
 } mr_gateway_scan_t;
 
 //=========================== prototypes ======================================
 
 void mr_scan_add(mr_beacon_packet_header_t beacon, int8_t rssi, uint8_t channel, uint32_t ts_scan, uint64_t asn_scan);
 
+/**
+ * @brief Selects the gateway with the best score among the ones heard since the scan started.
+ *
+ * @param[out] best_channel_info    Latest reading of the selected gateway, with its average rssi
+ * @param[in]  ts_scan_started      Readings before this time are ignored
+ * @param[in]  ts_scan_ended        Readings older than MARI_SCAN_OLD_US at this time are ignored
+ *
+ * @return true if a gateway was selected
+ */
 bool mr_scan_select(mr_channel_info_t *best_channel_info, uint32_t ts_scan_started, uint32_t ts_scan_ended);
 
 #endif  // __SCAN_H
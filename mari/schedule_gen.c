@@ -0,0 +1,193 @@
+/**
+ * @file
+ * @ingroup     schedule_gen
+ *
+ * @brief       Generation and validation of schedules
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "schedule_gen.h"
+#include "mac.h"
+
+//=========================== defines ==========================================
+
+#define E_TIMES_1000 2718  // expected number of slots for n contenders to go through a slotted aloha contention is about e * n
+
+//=========================== prototypes =======================================
+
+static bool     _is_spread(size_t index, size_t n_spread, size_t n_total);
+static uint8_t  _backoff_n_max(uint16_t n_nodes, size_t n_shared_uplink, size_t n_cells);
+static uint32_t _max_gap(const schedule_t *schedule, slot_type_t type);
+
+//=========================== public ===========================================
+
+bool mr_schedule_gen_build(schedule_t *schedule, cell_t *cells, size_t max_cells, uint8_t id, uint16_t n_nodes, uint8_t shared_uplink_percent, uint8_t downlink_percent) {
+    size_t n_shared_uplink = ((size_t)n_nodes * shared_uplink_percent + 99) / 100;
+    if (n_shared_uplink == 0) {
+        n_shared_uplink = 1;  // nodes must be able to join
+    }
+    size_t n_downlink = ((size_t)n_nodes * downlink_percent + 99) / 100;
+    if (n_downlink < n_shared_uplink) {
+        n_downlink = n_shared_uplink;  // each shared uplink cell is followed by the downlink cell carrying the join response
+    }
+
+    size_t n_cells = MARI_N_BEACON_CELLS + n_nodes + n_shared_uplink + n_downlink;
+    if (n_cells % MARI_N_BLE_REGULAR_CHANNELS == 0) {
+        // otherwise each cell would always use the same channel
+        n_downlink++;
+        n_cells++;
+    }
+    if (n_cells > MARI_N_CELLS_MAX || n_cells > max_cells) {
+        return false;
+    }
+
+    memset(cells, 0, n_cells * sizeof(cell_t));
+    schedule->id            = id;
+    schedule->max_nodes     = n_nodes;
+    schedule->backoff_n_min = MARI_SCHEDULE_GEN_BACKOFF_N_MIN;
+    schedule->backoff_n_max = _backoff_n_max(n_nodes, n_shared_uplink, n_cells);
+    schedule->n_cells       = n_cells;
+    schedule->cells         = cells;
+
+    // beacon cells use their own channel offsets and frequencies
+    size_t cell_index = 0;
+    for (; cell_index < MARI_N_BEACON_CELLS; cell_index++) {
+        schedule->cells[cell_index].type           = SLOT_TYPE_BEACON;
+        schedule->cells[cell_index].channel_offset = cell_index;
+    }
+
+    // a block is either a shared uplink cell followed by a downlink cell, or a downlink cell alone
+    size_t      n_blocks      = n_downlink;
+    size_t      n_items       = n_nodes + n_blocks;
+    size_t      block_index   = 0;
+    size_t      regular_index = 0;
+    slot_type_t block[2]      = { 0 };
+    for (size_t item = 0; item < n_items; item++) {
+        size_t block_len = 0;
+        if (!_is_spread(item, n_blocks, n_items)) {
+            block[block_len++] = SLOT_TYPE_UPLINK;
+        } else {
+            if (!_is_spread(block_index, n_downlink - n_shared_uplink, n_blocks)) {
+                block[block_len++] = SLOT_TYPE_SHARED_UPLINK;
+            }
+            block[block_len++] = SLOT_TYPE_DOWNLINK;
+            block_index++;
+        }
+        for (size_t i = 0; i < block_len; i++) {
+            schedule->cells[cell_index].type           = block[i];
+            schedule->cells[cell_index].channel_offset = (regular_index * MARI_SCHEDULE_GEN_CHANNEL_STRIDE) % MARI_N_BLE_REGULAR_CHANNELS;
+            cell_index++;
+            regular_index++;
+        }
+    }
+
+    return true;
+}
+
+bool mr_schedule_gen_check(const schedule_t *schedule, mr_schedule_report_t *report) {
+    if (schedule->n_cells <= MARI_N_BEACON_CELLS || schedule->n_cells > MARI_N_CELLS_MAX) {
+        return false;
+    }
+    if (schedule->n_cells % MARI_N_BLE_REGULAR_CHANNELS == 0) {
+        return false;
+    }
+    if (schedule->backoff_n_min > schedule->backoff_n_max) {
+        return false;
+    }
+
+    mr_schedule_report_t counts = { 0 };
+    for (size_t i = 0; i < schedule->n_cells; i++) {
+        slot_type_t type = schedule->cells[i].type;
+        if ((i < MARI_N_BEACON_CELLS) != (type == SLOT_TYPE_BEACON)) {
+            // beacon cells come first, and only there
+            return false;
+        }
+        switch (type) {
+            case SLOT_TYPE_BEACON:
+                counts.n_beacon++;
+                break;
+            case SLOT_TYPE_UPLINK:
+                counts.n_uplink++;
+                break;
+            case SLOT_TYPE_SHARED_UPLINK:
+                if (schedule->cells[(i + 1) % schedule->n_cells].type != SLOT_TYPE_DOWNLINK) {
+                    // the join response is sent in the cell right after the request
+                    return false;
+                }
+                counts.n_shared_uplink++;
+                break;
+            case SLOT_TYPE_DOWNLINK:
+                counts.n_downlink++;
+                break;
+            default:
+                return false;
+        }
+    }
+    if (counts.n_uplink != schedule->max_nodes || counts.n_shared_uplink == 0) {
+        return false;
+    }
+
+    if (report != NULL) {
+        *report                     = counts;
+        report->uplink_latency_us   = schedule->n_cells * MARI_WHOLE_SLOT_DURATION;
+        report->downlink_latency_us = _max_gap(schedule, SLOT_TYPE_DOWNLINK) * MARI_WHOLE_SLOT_DURATION;
+        report->join_latency_us     = (_max_gap(schedule, SLOT_TYPE_SHARED_UPLINK) + 1) * MARI_WHOLE_SLOT_DURATION;
+        report->beacon_latency_us   = _max_gap(schedule, SLOT_TYPE_BEACON) * MARI_WHOLE_SLOT_DURATION;
+    }
+
+    return true;
+}
+
+//=========================== private ==========================================
+
+// spreads n_spread items evenly among n_total, returns true if the item at index is one of them
+static bool _is_spread(size_t index, size_t n_spread, size_t n_total) {
+    // rounded, so that the spread items are centered rather than pushed to the end
+    size_t before = (2 * index * n_spread + n_total) / (2 * n_total);
+    size_t after  = (2 * (index + 1) * n_spread + n_total) / (2 * n_total);
+    return after != before;
+}
+
+static uint8_t _backoff_n_max(uint16_t n_nodes, size_t n_shared_uplink, size_t n_cells) {
+    // large enough for all nodes to contend at once without colliding forever
+    uint8_t n_max = MARI_SCHEDULE_GEN_BACKOFF_N_MIN;
+    while (n_max < MARI_SCHEDULE_GEN_BACKOFF_N_MAX && ((uint32_t)1 << n_max) * 1000 < (uint32_t)n_nodes * E_TIMES_1000) {
+        n_max++;
+    }
+
+    // small enough for the largest backoff to fit in the join budget
+    while (n_max > MARI_SCHEDULE_GEN_BACKOFF_N_MIN) {
+        uint64_t backoff_us = ((uint64_t)1 << n_max) * n_cells * MARI_WHOLE_SLOT_DURATION / n_shared_uplink;
+        if (backoff_us <= MARI_SCHEDULE_GEN_JOIN_BUDGET_US) {
+            break;
+        }
+        n_max--;
+    }
+
+    return n_max;
+}
+
+// largest number of slots between two consecutive cells of a type, wrapping around the slotframe
+static uint32_t _max_gap(const schedule_t *schedule, slot_type_t type) {
+    uint32_t max_gap = 0;
+    for (size_t i = 0; i < schedule->n_cells; i++) {
+        if (schedule->cells[i].type != type) {
+            continue;
+        }
+        uint32_t gap = 1;
+        while (schedule->cells[(i + gap) % schedule->n_cells].type != type) {
+            gap++;
+        }
+        if (gap > max_gap) {
+            max_gap = gap;
+        }
+    }
+    return max_gap;
+}
@@ -0,0 +1,69 @@
+#ifndef __SCHEDULE_GEN_H
+#define __SCHEDULE_GEN_H
+
+/**
+ * @ingroup     mari
+ * @brief       Generation and validation of schedules
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025-now
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "models.h"
+
+//=========================== defines =========================================
+
+#define MARI_SCHEDULE_GEN_CHANNEL_STRIDE 13                 // channel offset step between consecutive non-beacon cells, co-prime with 37
+#define MARI_SCHEDULE_GEN_BACKOFF_N_MIN  4                  // same for every generated schedule
+#define MARI_SCHEDULE_GEN_BACKOFF_N_MAX  8                  // backoff_n_max is never larger than this
+#define MARI_SCHEDULE_GEN_JOIN_BUDGET_US (1000 * 1000 * 4)  // 2^backoff_n_max shared uplink cells must fit in this time, must be below MARI_JOIN_TIMEOUT_SINCE_SYNCED
+
+typedef struct {
+    uint16_t n_beacon;             // number of beacon cells
+    uint16_t n_uplink;             // number of dedicated uplink cells
+    uint16_t n_shared_uplink;      // number of shared uplink cells
+    uint16_t n_downlink;           // number of downlink cells
+    uint32_t uplink_latency_us;    // worst-case wait for a node's own uplink cell
+    uint32_t downlink_latency_us;  // worst-case wait for any downlink cell
+    uint32_t join_latency_us;      // worst-case wait for a shared uplink cell and the downlink cell carrying its response
+    uint32_t beacon_latency_us;    // worst-case wait for a beacon cell
+} mr_schedule_report_t;
+
+//=========================== prototypes ==========================================
+
+/**
+ * @brief Generates a schedule
+ *
+ * The schedule starts with the beacon cells. Each shared uplink cell is immediately followed by a downlink cell,
+ * and the shared uplink / downlink blocks are spread evenly among the dedicated uplink cells. Channel offsets
+ * are spread evenly over the regular BLE channels.
+ *
+ * @param[out] schedule                 Schedule to fill
+ * @param[out] cells                    Buffer receiving the cells of the schedule
+ * @param[in]  max_cells                Size of the cells buffer
+ * @param[in]  id                       Identifier of the schedule
+ * @param[in]  n_nodes                  Number of dedicated uplink cells, i.e. maximum number of nodes
+ * @param[in]  shared_uplink_percent    Number of shared uplink cells, in percent of n_nodes (rounded up, at least one)
+ * @param[in]  downlink_percent         Number of downlink cells, in percent of n_nodes (rounded up, at least one per shared uplink cell)
+ *
+ * @return true if the schedule fits in max_cells and MARI_N_CELLS_MAX cells
+ */
+bool mr_schedule_gen_build(schedule_t *schedule, cell_t *cells, size_t max_cells, uint8_t id, uint16_t n_nodes, uint8_t shared_uplink_percent, uint8_t downlink_percent);
+
+/**
+ * @brief Checks that a schedule can be used by the scheduler, and computes its worst-case latencies
+ *
+ * @param[in]  schedule     Schedule to check
+ * @param[out] report       Cell counts and worst-case latencies, can be NULL
+ *
+ * @return true if the schedule is valid
+ */
+bool mr_schedule_gen_check(const schedule_t *schedule, mr_schedule_report_t *report);
+
+#endif
@@ -16,14 +16,22 @@
 
 #include "models.h"
 #include "mr_device.h"
+#include "mari.h"
 
 #include "scheduler.h"
-#include "bloom.h"
+#include "occupancy.h"
+#include "queue.h"
+#include "link.h"
+#include "critical.h"
 #include "all_schedules.c"
 #include "association.c"
 
 //=========================== defines ==========================================
 
+#define MARI_NODE_TABLE_SIZE    (2 * MARI_MAX_NODES + 1)  // open addressing hash table, kept at most half full
+#define MARI_ORDINAL_WORDS      ((MARI_MAX_NODES + 31) / 32)
+#define MARI_NODE_HASH_MULTIPLY 0x9E3779B97F4A7C15ULL  // Fibonacci hashing
+
 //=========================== variables ========================================
 
 typedef struct {
@@ -31,22 +39,43 @@ typedef struct {
     schedule_t *active_schedule_ptr;  // pointer to the currently active schedule
     uint32_t    slotframe_counter;    // used to cycle beacon channels through slotframes (when listening for beacons at uplink slot_durations)
 
-    uint8_t num_assigned_uplink_nodes;  // number of nodes with assigned uplink slots
+    uint16_t num_assigned_uplink_nodes;  // number of nodes with assigned uplink slots
 
     size_t current_cell_index;  // index of the current cell
 
+    // schedule migration
+    schedule_t *next_schedule_ptr;  // schedule to switch to at switch_asn, NULL if no switch is planned
+    uint64_t    switch_asn;         // first asn of the next schedule
+
     // static data
     schedule_t *available_schedules[MARI_N_SCHEDULES];
     size_t      available_schedules_len;
 } schedule_vars_t;
 
+// indexes over the active schedule, so that per-node lookups at the gateway do not depend on the number of nodes
+typedef struct {
+    uint16_t uplink_cells[MARI_MAX_NODES];       // cell index of each uplink cell, by ordinal
+    uint16_t cell_ordinals[MARI_N_CELLS_MAX];    // ordinal of each uplink cell, by cell index
+    uint16_t n_uplink_cells;                     // number of uplink cells in the active schedule
+    uint32_t used_ordinals[MARI_ORDINAL_WORDS];  // bitmap of the assigned uplink cells, by ordinal
+    uint16_t node_table[MARI_NODE_TABLE_SIZE];   // node id -> cell index + 1, 0 if the slot is empty
+} schedule_index_t;
+
+#if MARI_ENABLE_CELL_STATS
 typedef struct {
-    uint64_t sched_usage[MARI_STATS_SCHED_USAGE_SIZE];
+    mr_cell_stats_t current[MARI_N_CELLS_MAX];  // counters of the window being aggregated
+    mr_cell_stats_t window[MARI_N_CELLS_MAX];   // counters of the last complete window
+    uint16_t        export_offset;              // next cell to be exported in a gateway info frame
 } schedule_stats_t;
+#endif
 
 static schedule_vars_t _schedule_vars = { 0 };
 
+#if MARI_ENABLE_CELL_STATS
 static schedule_stats_t _schedule_stats = { 0 };
+#endif
+
+static schedule_index_t _schedule_index = { 0 };
 
 //========================== prototypes ========================================
 
@@ -56,8 +85,32 @@ void _compute_gateway_action(cell_t cell, mr_slot_info_t *slot_info);
 // compute the radio action when the node is an end device
 void _compute_node_action(cell_t cell, mr_slot_info_t *slot_info);
 
-// encode the schedule usage stats
-void _encode_schedule_usage_stats(uint8_t cell_index, uint8_t radio_action);
+// reset the per-cell statistics, e.g. when the schedule changes
+static void _stats_reset(void);
+
+// move the assigned uplink cells to the next schedule, and make it active
+static void _switch_to_next_schedule(void);
+
+// at the gateway, decide if a bigger or smaller schedule fits the number of nodes better
+static void _gateway_plan_migration(uint64_t asn);
+
+// rebuild the indexes from the cells of the active schedule
+static void _index_rebuild(void);
+
+// at the gateway, give the first free uplink cell to a node, to be called in a critical section
+static int16_t _gateway_assign_uplink_cell(uint64_t node_id, uint64_t asn);
+
+// bitmap of assigned ordinals
+static void    _ordinal_set(uint16_t ordinal);
+static void    _ordinal_clear(uint16_t ordinal);
+static int32_t _ordinal_first_free(uint16_t max_ordinal);
+static int32_t _ordinal_last_used(void);
+
+// hash table of assigned nodes
+static size_t  _node_table_home(uint64_t node_id);
+static int32_t _node_table_find(uint64_t node_id);
+static void    _node_table_insert(uint64_t node_id, uint16_t cell_index);
+static void    _node_table_remove(uint64_t node_id);
 
 //=========================== public ===========================================
 
@@ -73,23 +126,60 @@ void mr_scheduler_init(schedule_t *application_schedule) {
     _schedule_vars.available_schedules[_schedule_vars.available_schedules_len++] = &schedule_medium;
     _schedule_vars.available_schedules[_schedule_vars.available_schedules_len++] = &schedule_big;
     _schedule_vars.available_schedules[_schedule_vars.available_schedules_len++] = &schedule_huge;
+#if MARI_WIDE_SCHEDULES
+    _schedule_vars.available_schedules[_schedule_vars.available_schedules_len++] = &schedule_wide;
+#endif
 
     if (application_schedule != NULL) {
         _schedule_vars.available_schedules[_schedule_vars.available_schedules_len++] = application_schedule;
         _schedule_vars.active_schedule_ptr                                           = application_schedule;
+        _index_rebuild();
     }
 }
 
 bool mr_scheduler_set_schedule(uint8_t schedule_id) {
-    for (size_t i = 0; i < MARI_N_SCHEDULES; i++) {
+    for (size_t i = 0; i < _schedule_vars.available_schedules_len; i++) {
         if (_schedule_vars.available_schedules[i]->id == schedule_id) {
+            uint32_t primask = mr_critical_enter();
+            if (_schedule_vars.active_schedule_ptr != _schedule_vars.available_schedules[i]) {
+                _stats_reset();
+            }
             _schedule_vars.active_schedule_ptr = _schedule_vars.available_schedules[i];
+            _schedule_vars.next_schedule_ptr   = NULL;
+            _index_rebuild();
+            mr_critical_exit(primask);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mr_scheduler_set_next_schedule(uint8_t schedule_id, uint64_t switch_asn) {
+    if (schedule_id == _schedule_vars.active_schedule_ptr->id) {
+        return true;
+    }
+    for (size_t i = 0; i < _schedule_vars.available_schedules_len; i++) {
+        if (_schedule_vars.available_schedules[i]->id == schedule_id) {
+            // the timer isr must not see the new schedule with the switch asn of the previous one
+            uint32_t primask                 = mr_critical_enter();
+            _schedule_vars.next_schedule_ptr = _schedule_vars.available_schedules[i];
+            _schedule_vars.switch_asn        = switch_asn;
+            mr_critical_exit(primask);
             return true;
         }
     }
     return false;
 }
 
+uint8_t mr_scheduler_get_next_schedule(uint64_t *switch_asn) {
+    if (_schedule_vars.next_schedule_ptr == NULL) {
+        *switch_asn = 0;
+        return 0;
+    }
+    *switch_asn = _schedule_vars.switch_asn;
+    return _schedule_vars.next_schedule_ptr->id;
+}
+
 uint32_t mr_scheduler_get_duration_us(void) {
     return MARI_WHOLE_SLOT_DURATION * _schedule_vars.active_schedule_ptr->n_cells;
 }
@@ -98,72 +188,113 @@ uint32_t mr_scheduler_get_duration_us(void) {
 
 // to be called at the NODE when processing a JOIN_RESPONSE
 bool mr_scheduler_node_assign_myself_to_cell(uint16_t cell_index) {
-    for (size_t i = 0; i < _schedule_vars.active_schedule_ptr->n_cells; i++) {
-        cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[i];
-        if (cell->type == SLOT_TYPE_UPLINK && i == cell_index) {
-            cell->assigned_node_id = mr_device_id();
-            return true;
-        }
+    if (cell_index >= _schedule_vars.active_schedule_ptr->n_cells) {
+        return false;
     }
-    return false;
+    cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[cell_index];
+    if (cell->type != SLOT_TYPE_UPLINK) {
+        return false;
+    }
+    uint32_t primask = mr_critical_enter();
+    mr_scheduler_node_deassign_myself_from_schedule();
+    cell->assigned_node_id = mr_device_id();
+    _ordinal_set(_schedule_index.cell_ordinals[cell_index]);
+    _node_table_insert(cell->assigned_node_id, cell_index);
+    mr_critical_exit(primask);
+    return true;
 }
 
 void mr_scheduler_node_deassign_myself_from_schedule(void) {
-    for (size_t i = 0; i < _schedule_vars.active_schedule_ptr->n_cells; i++) {
-        cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[i];
-        if (cell->type == SLOT_TYPE_UPLINK && cell->assigned_node_id == mr_device_id()) {
-            cell->assigned_node_id  = NULL;
-            cell->last_received_asn = 0;
-        }
+    uint32_t primask    = mr_critical_enter();
+    int32_t  cell_index = _node_table_find(mr_device_id());
+    if (cell_index >= 0) {
+        cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[cell_index];
+        _node_table_remove(cell->assigned_node_id);
+        _ordinal_clear(_schedule_index.cell_ordinals[cell_index]);
+        cell->assigned_node_id  = 0;
+        cell->last_received_asn = 0;
     }
+    mr_critical_exit(primask);
+}
+
+// to be called at the NODE when checking the beacon occupancy
+int16_t mr_scheduler_node_get_uplink_ordinal(void) {
+    uint32_t primask    = mr_critical_enter();
+    int32_t  cell_index = _node_table_find(mr_device_id());
+    int16_t  ordinal    = cell_index < 0 ? -1 : _schedule_index.cell_ordinals[cell_index];
+    mr_critical_exit(primask);
+    return ordinal;
 }
 
 // ------------ gateway functions ---------
 
 // to be called at the GATEWAY when processing a JOIN_REQUEST
 int16_t mr_scheduler_gateway_assign_next_available_uplink_cell(uint64_t node_id, uint64_t asn) {
-    for (size_t i = 0; i < _schedule_vars.active_schedule_ptr->n_cells; i++) {
-        cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[i];
-        if (cell->type == SLOT_TYPE_UPLINK && cell->assigned_node_id == 0) {
-            // the cell is available, so we can assign it to the node
-            cell->assigned_node_id  = node_id;
-            cell->last_received_asn = asn;
-            // pre-compute the bloom filter hashes
-            cell->bloom_h1 = mr_bloom_hash_fnv1a64(node_id);
-            cell->bloom_h2 = mr_bloom_hash_fnv1a64(node_id ^ MARI_BLOOM_FNV1A_H2_SALT);
-            _schedule_vars.num_assigned_uplink_nodes++;
-            return i;
-        } else if (cell->type == SLOT_TYPE_UPLINK && cell->assigned_node_id == node_id) {
-            // the node re-connected before the gateway could detect it was gone,
-            // probably because of a collision on the join response (donwlink)
-            // so we can just keep the same cell_id, but we still need to update the last_received_asn
-            cell->last_received_asn = asn;
-            return i;
-        }
-    }
-    return -1;
+    // join requests are handled in the bottom half, which the timer isr preempts to release cells and switch schedules
+    uint32_t primask    = mr_critical_enter();
+    int16_t  cell_index = _gateway_assign_uplink_cell(node_id, asn);
+    mr_critical_exit(primask);
+    return cell_index;
 }
 
 // to be called at the GATEWAY when a node leaves
-inline void mr_scheduler_gateway_decrease_nodes_counter(void) {
-    _schedule_vars.num_assigned_uplink_nodes--;
+void mr_scheduler_gateway_release_cell(uint16_t cell_index) {
+    uint32_t primask = mr_critical_enter();
+    cell_t  *cell    = &_schedule_vars.active_schedule_ptr->cells[cell_index];
+    if (cell->type == SLOT_TYPE_UPLINK && cell->assigned_node_id != 0) {
+        _node_table_remove(cell->assigned_node_id);
+        _ordinal_clear(_schedule_index.cell_ordinals[cell_index]);
+        cell->assigned_node_id  = 0;
+        cell->last_received_asn = 0;
+        _schedule_vars.num_assigned_uplink_nodes--;
+        mr_link_gateway_release(cell_index);
+    }
+    mr_critical_exit(primask);
+}
+
+// to be called at the GATEWAY when a packet is received from a node, returns false if the node has no cell
+bool mr_scheduler_gateway_keep_node_alive(uint64_t node_id, uint64_t asn) {
+    // the timer isr compares last_received_asn to the current asn to time nodes out, it must not see half of it
+    uint32_t primask    = mr_critical_enter();
+    int32_t  cell_index = _node_table_find(node_id);
+    if (cell_index >= 0) {
+        _schedule_vars.active_schedule_ptr->cells[cell_index].last_received_asn = asn;
+    }
+    mr_critical_exit(primask);
+    return cell_index >= 0;
 }
 
 // to be called at the GATEWAY to build a beacon
-uint8_t mr_scheduler_gateway_remaining_capacity(void) {
+uint16_t mr_scheduler_gateway_remaining_capacity(void) {
     return _schedule_vars.active_schedule_ptr->max_nodes - _schedule_vars.num_assigned_uplink_nodes;
 }
 
 // to be called at the GATEWAY to build a beacon
-uint8_t mr_scheduler_gateway_get_nodes_count(void) {
+uint16_t mr_scheduler_gateway_get_nodes_count(void) {
     return _schedule_vars.num_assigned_uplink_nodes;
 }
 
-uint8_t mr_scheduler_gateway_get_nodes(uint64_t *nodes) {
-    uint8_t count = 0;
-    for (size_t i = 0; i < _schedule_vars.active_schedule_ptr->n_cells; i++) {
-        cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[i];
-        if (cell->type == SLOT_TYPE_UPLINK && cell->assigned_node_id != NULL) {
+// to be called at the GATEWAY, returns -1 if the node has no cell
+int16_t mr_scheduler_gateway_get_node_cell(uint64_t node_id) {
+    uint32_t primask    = mr_critical_enter();
+    int32_t  cell_index = _node_table_find(node_id);
+    mr_critical_exit(primask);
+    return cell_index;
+}
+
+int16_t mr_scheduler_gateway_get_node_ordinal(uint64_t node_id) {
+    uint32_t primask    = mr_critical_enter();
+    int32_t  cell_index = _node_table_find(node_id);
+    int16_t  ordinal    = cell_index < 0 ? -1 : _schedule_index.cell_ordinals[cell_index];
+    mr_critical_exit(primask);
+    return ordinal;
+}
+
+uint16_t mr_scheduler_gateway_get_nodes(uint64_t *nodes) {
+    uint16_t count = 0;
+    for (uint16_t ordinal = 0; ordinal < _schedule_index.n_uplink_cells; ordinal++) {
+        cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[_schedule_index.uplink_cells[ordinal]];
+        if (cell->assigned_node_id != 0) {
             nodes[count++] = cell->assigned_node_id;
         }
     }
@@ -173,6 +304,10 @@ uint8_t mr_scheduler_gateway_get_nodes(uint64_t *nodes) {
 // ------------ general functions ---------
 
 mr_slot_info_t mr_scheduler_tick(uint64_t asn) {
+    if (_schedule_vars.next_schedule_ptr != NULL && asn >= _schedule_vars.switch_asn) {
+        _switch_to_next_schedule();
+    }
+
     // get the current cell
     _schedule_vars.current_cell_index = asn % (_schedule_vars.active_schedule_ptr)->n_cells;
     cell_t cell                       = (_schedule_vars.active_schedule_ptr)->cells[_schedule_vars.current_cell_index];
@@ -186,6 +321,11 @@ mr_slot_info_t mr_scheduler_tick(uint64_t asn) {
         _compute_gateway_action(cell, &slot_info);
     } else {
         _compute_node_action(cell, &slot_info);
+        if (cell.type == SLOT_TYPE_DOWNLINK && !mr_assoc_node_expects_downlink(asn - _schedule_vars.current_cell_index)) {
+            // the beacons of this slotframe announced nothing for this node
+            slot_info.radio_action = MARI_RADIO_ACTION_SLEEP;
+            mr_stats_inc(MARI_STATS_DOWNLINKS_SKIPPED);
+        }
         if (cell.type == SLOT_TYPE_SHARED_UPLINK) {
             mr_assoc_node_tick_backoff();
         }
@@ -194,6 +334,19 @@ mr_slot_info_t mr_scheduler_tick(uint64_t asn) {
     // if the slotframe wrapped, keep track of how many slotframes have passed (used to cycle beacon channels)
     if (asn != 0 && _schedule_vars.current_cell_index == 0) {
         _schedule_vars.slotframe_counter++;
+#if MARI_ENABLE_CELL_STATS
+        // close the statistics window every MARI_STATS_WINDOW_SLOTFRAMES slotframes
+        if (_schedule_vars.slotframe_counter % MARI_STATS_WINDOW_SLOTFRAMES == 0) {
+            memcpy(_schedule_stats.window, _schedule_stats.current, sizeof(_schedule_stats.window));
+            memset(_schedule_stats.current, 0, sizeof(_schedule_stats.current));
+        }
+#endif
+
+#if MARI_ENABLE_SCHEDULE_MIGRATION
+        if (mari_get_node_type() == MARI_GATEWAY && _schedule_vars.next_schedule_ptr == NULL) {
+            _gateway_plan_migration(asn);
+        }
+#endif
     }
 
     return slot_info;
@@ -220,6 +373,15 @@ uint8_t mr_scheduler_get_channel(slot_type_t slot_type, uint64_t asn, uint8_t ch
     }
 }
 
+schedule_t *mr_scheduler_get_schedule_ptr(uint8_t schedule_id) {
+    for (size_t i = 0; i < _schedule_vars.available_schedules_len; i++) {
+        if (_schedule_vars.available_schedules[i]->id == schedule_id) {
+            return _schedule_vars.available_schedules[i];
+        }
+    }
+    return NULL;
+}
+
 schedule_t *mr_scheduler_get_active_schedule_ptr(void) {
     return _schedule_vars.active_schedule_ptr;
 }
@@ -228,7 +390,7 @@ uint8_t mr_scheduler_get_active_schedule_id(void) {
     return _schedule_vars.active_schedule_ptr->id;
 }
 
-uint8_t mr_scheduler_get_active_schedule_slot_count(void) {
+uint16_t mr_scheduler_get_active_schedule_slot_count(void) {
     return _schedule_vars.active_schedule_ptr->n_cells;
 }
 
@@ -239,29 +401,328 @@ cell_t mr_scheduler_node_peek_slot(uint64_t asn) {
     return cell;
 }
 
-void mr_scheduler_stats_register_used_slot(bool used) {
-    uint8_t encoded_action = 0;
-    if (used) {
-        encoded_action = 1;
-    }
-    uint8_t cell_index   = _schedule_vars.current_cell_index;
-    uint8_t array_index  = cell_index / 64;
-    uint8_t bit_position = cell_index % 64;
+uint16_t mr_scheduler_get_current_cell_index(void) {
+    return _schedule_vars.current_cell_index;
+}
 
-    if (array_index < MARI_STATS_SCHED_USAGE_SIZE) {
-        // First clear the bit at the position
-        _schedule_stats.sched_usage[array_index] &= ~((uint64_t)1 << bit_position);
-        // Then set it to the new value
-        _schedule_stats.sched_usage[array_index] |= (uint64_t)encoded_action << bit_position;
+void mr_scheduler_stats_register(mr_cell_stats_event_t event) {
+    mr_scheduler_stats_register_cell(_schedule_vars.current_cell_index, event);
+}
+
+void mr_scheduler_stats_register_cell(uint16_t cell_index, mr_cell_stats_event_t event) {
+#if MARI_ENABLE_CELL_STATS
+    if (cell_index >= _schedule_vars.active_schedule_ptr->n_cells) {
+        // the schedule changed since
+        return;
+    }
+    mr_cell_stats_t *stats = &_schedule_stats.current[cell_index];
+    uint8_t         *counter;
+    switch (event) {
+        case MARI_CELL_STATS_TX:
+            counter = &stats->tx;
+            break;
+        case MARI_CELL_STATS_RX:
+            counter = &stats->rx;
+            break;
+        case MARI_CELL_STATS_RX_TIMEOUT:
+            counter = &stats->rx_timeout;
+            break;
+        case MARI_CELL_STATS_COLLISION:
+            counter = &stats->collision;
+            break;
+        default:
+            return;
+    }
+    if (*counter < UINT8_MAX) {
+        (*counter)++;
     }
+#endif
 }
 
-uint64_t *mr_scheduler_get_schedule_usage(void) {
-    return _schedule_stats.sched_usage;
+uint8_t mr_scheduler_stats_get_cells(mr_cell_stats_t *stats, uint16_t *offset, uint8_t max_len) {
+#if MARI_ENABLE_CELL_STATS
+    // the timer isr closes the window and may switch the schedule, copy a consistent page
+    uint32_t primask = mr_critical_enter();
+    size_t   n_cells = _schedule_vars.active_schedule_ptr->n_cells;
+    if (_schedule_stats.export_offset >= n_cells) {
+        _schedule_stats.export_offset = 0;
+    }
+
+    size_t len = n_cells - _schedule_stats.export_offset;
+    if (len > max_len) {
+        len = max_len;
+    }
+    *offset = _schedule_stats.export_offset;
+    memcpy(stats, &_schedule_stats.window[*offset], len * sizeof(mr_cell_stats_t));
+
+    _schedule_stats.export_offset += len;
+    mr_critical_exit(primask);
+    return len;
+#else
+    *offset = 0;
+    return 0;
+#endif
 }
 
 //=========================== private ==========================================
 
+static int16_t _gateway_assign_uplink_cell(uint64_t node_id, uint64_t asn) {
+    int32_t cell_index = _node_table_find(node_id);
+    if (cell_index >= 0) {
+        // the node re-connected before the gateway could detect it was gone,
+        // probably because of a collision on the join response (donwlink)
+        // so we can just keep the same cell_id, but we still need to update the last_received_asn
+        _schedule_vars.active_schedule_ptr->cells[cell_index].last_received_asn = asn;
+        return cell_index;
+    }
+
+    // while switching to a smaller schedule, only hand out cells that also exist in it
+    uint16_t max_ordinal = _schedule_index.n_uplink_cells;
+    if (_schedule_vars.next_schedule_ptr != NULL && _schedule_vars.next_schedule_ptr->max_nodes < max_ordinal) {
+        max_ordinal = _schedule_vars.next_schedule_ptr->max_nodes;
+    }
+
+    // the first available uplink cell, keeping the assigned ones packed at the beginning of the schedule
+    int32_t ordinal = _ordinal_first_free(max_ordinal);
+    if (ordinal < 0) {
+        return -1;
+    }
+    cell_index   = _schedule_index.uplink_cells[ordinal];
+    cell_t *cell = &_schedule_vars.active_schedule_ptr->cells[cell_index];
+
+    cell->assigned_node_id  = node_id;
+    cell->last_received_asn = asn;
+    // pre-compute the tag advertised in the beacons
+    cell->occupancy_tag = mr_occupancy_tag(node_id);
+    _ordinal_set(ordinal);
+    _node_table_insert(node_id, cell_index);
+    _schedule_vars.num_assigned_uplink_nodes++;
+    return cell_index;
+}
+
+static void _stats_reset(void) {
+#if MARI_ENABLE_CELL_STATS
+    memset(&_schedule_stats, 0, sizeof(_schedule_stats));
+#endif
+}
+
+static void _switch_to_next_schedule(void) {
+    schedule_t *from       = _schedule_vars.active_schedule_ptr;
+    schedule_t *to         = _schedule_vars.next_schedule_ptr;
+    bool        is_gateway = mari_get_node_type() == MARI_GATEWAY;
+    uint32_t    primask    = mr_critical_enter();
+
+    uint16_t n_to_uplink_cells = 0;
+    for (size_t j = 0; j < to->n_cells; j++) {
+        to->cells[j].assigned_node_id  = 0;
+        to->cells[j].last_received_asn = 0;
+        n_to_uplink_cells += to->cells[j].type == SLOT_TYPE_UPLINK;
+    }
+
+    // walk the uplink cells of both schedules side by side, so that the n-th uplink cell goes to the n-th uplink cell
+    // the links are indexed by cell too: those that move to a lower cell are moved in this walk, in increasing order,
+    // and those that move to a higher cell in the next one, in decreasing order, so that none is overwritten before it moved
+    size_t j = 0;
+    for (size_t i = 0; i < from->n_cells; i++) {
+        cell_t *cell = &from->cells[i];
+        if (cell->type != SLOT_TYPE_UPLINK) {
+            continue;
+        }
+        while (j < to->n_cells && to->cells[j].type != SLOT_TYPE_UPLINK) {
+            j++;
+        }
+        if (j < to->n_cells && cell->assigned_node_id != 0) {
+            // NOTE: a smaller schedule is only planned when all assigned cells fit in it
+            to->cells[j].assigned_node_id  = cell->assigned_node_id;
+            to->cells[j].last_received_asn = cell->last_received_asn;
+            to->cells[j].occupancy_tag     = cell->occupancy_tag;
+        }
+        if (is_gateway && j >= to->n_cells) {
+            mr_link_gateway_clear(i);
+        } else if (is_gateway && j <= i) {
+            mr_link_gateway_remap(i, j);
+        }
+        cell->assigned_node_id  = 0;
+        cell->last_received_asn = 0;
+        j++;
+    }
+
+    // the index still describes the current schedule
+    uint16_t ordinal = n_to_uplink_cells;
+    for (size_t k = to->n_cells; is_gateway && k-- > 0;) {
+        if (to->cells[k].type != SLOT_TYPE_UPLINK) {
+            continue;
+        }
+        ordinal--;
+        if (ordinal < _schedule_index.n_uplink_cells && _schedule_index.uplink_cells[ordinal] < k) {
+            mr_link_gateway_remap(_schedule_index.uplink_cells[ordinal], k);
+        }
+    }
+
+    _schedule_vars.active_schedule_ptr = to;
+    _schedule_vars.next_schedule_ptr   = NULL;
+    _stats_reset();
+    _index_rebuild();
+
+    if (is_gateway) {
+        // pending join responses carry cell ids of the old schedule
+        mr_queue_gateway_remap_join_responses();
+        mr_occupancy_gateway_set_dirty();
+    }
+    mr_critical_exit(primask);
+}
+
+static void _gateway_plan_migration(uint64_t asn) {
+    schedule_t *active    = _schedule_vars.active_schedule_ptr;
+    schedule_t *candidate = NULL;
+
+    // the number of uplink cells needed is given by the highest ordinal in use, not by the number of nodes
+    uint16_t used_ordinal = _ordinal_last_used() + 1;
+
+    if (active->max_nodes - _schedule_vars.num_assigned_uplink_nodes <= MARI_SCHEDULE_GROW_MARGIN) {
+        // almost full: grow to the smallest bigger schedule
+        for (size_t i = 0; i < _schedule_vars.available_schedules_len; i++) {
+            schedule_t *schedule = _schedule_vars.available_schedules[i];
+            if (schedule->max_nodes > active->max_nodes && (candidate == NULL || schedule->max_nodes < candidate->max_nodes)) {
+                candidate = schedule;
+            }
+        }
+    } else {
+        // shrink to the biggest smaller schedule, but only once it would be at most half full (hysteresis)
+        for (size_t i = 0; i < _schedule_vars.available_schedules_len; i++) {
+            schedule_t *schedule = _schedule_vars.available_schedules[i];
+            if (schedule->max_nodes < active->max_nodes && (candidate == NULL || schedule->max_nodes > candidate->max_nodes)) {
+                candidate = schedule;
+            }
+        }
+        if (candidate != NULL && used_ordinal > candidate->max_nodes / 2) {
+            candidate = NULL;
+        }
+    }
+
+    if (candidate == NULL) {
+        return;
+    }
+
+    // start the new schedule at the beginning of one of its slotframes, after a few slotframes of announcement
+    uint64_t earliest_asn            = asn + MARI_SCHEDULE_SWITCH_SLOTFRAMES * active->n_cells;
+    _schedule_vars.switch_asn        = ((earliest_asn + candidate->n_cells - 1) / candidate->n_cells) * candidate->n_cells;
+    _schedule_vars.next_schedule_ptr = candidate;
+}
+
+static void _index_rebuild(void) {
+    schedule_t *schedule = _schedule_vars.active_schedule_ptr;
+    memset(&_schedule_index, 0, sizeof(_schedule_index));
+    _schedule_vars.num_assigned_uplink_nodes = 0;
+
+    for (size_t i = 0; i < schedule->n_cells; i++) {
+        cell_t *cell = &schedule->cells[i];
+        if (cell->type != SLOT_TYPE_UPLINK || _schedule_index.n_uplink_cells == MARI_MAX_NODES) {
+            continue;
+        }
+        uint16_t ordinal                      = _schedule_index.n_uplink_cells++;
+        _schedule_index.uplink_cells[ordinal] = i;
+        _schedule_index.cell_ordinals[i]      = ordinal;
+        if (cell->assigned_node_id != 0) {
+            _ordinal_set(ordinal);
+            _node_table_insert(cell->assigned_node_id, i);
+            _schedule_vars.num_assigned_uplink_nodes++;
+        }
+    }
+}
+
+static void _ordinal_set(uint16_t ordinal) {
+    _schedule_index.used_ordinals[ordinal / 32] |= 1UL << (ordinal % 32);
+}
+
+static void _ordinal_clear(uint16_t ordinal) {
+    _schedule_index.used_ordinals[ordinal / 32] &= ~(1UL << (ordinal % 32));
+}
+
+// returns the lowest unassigned ordinal below max_ordinal, or -1 if there is none
+static int32_t _ordinal_first_free(uint16_t max_ordinal) {
+    for (size_t word = 0; word * 32 < max_ordinal; word++) {
+        uint32_t free_bits = ~_schedule_index.used_ordinals[word];
+        if (free_bits == 0) {
+            continue;
+        }
+        int32_t ordinal = word * 32 + __builtin_ctz(free_bits);
+        return ordinal < max_ordinal ? ordinal : -1;
+    }
+    return -1;
+}
+
+// returns the highest assigned ordinal, or -1 if there is none
+static int32_t _ordinal_last_used(void) {
+    for (int32_t word = MARI_ORDINAL_WORDS - 1; word >= 0; word--) {
+        uint32_t used_bits = _schedule_index.used_ordinals[word];
+        if (used_bits != 0) {
+            return word * 32 + 31 - __builtin_clz(used_bits);
+        }
+    }
+    return -1;
+}
+
+static size_t _node_table_home(uint64_t node_id) {
+    return ((node_id * MARI_NODE_HASH_MULTIPLY) >> 32) % MARI_NODE_TABLE_SIZE;
+}
+
+// returns the cell assigned to a node, or -1 if there is none
+static int32_t _node_table_find(uint64_t node_id) {
+    if (node_id == 0) {
+        return -1;
+    }
+    // linear probing, the table is at most half full so this stops after a few slots
+    for (size_t slot = _node_table_home(node_id); _schedule_index.node_table[slot] != 0; slot = (slot + 1) % MARI_NODE_TABLE_SIZE) {
+        uint16_t cell_index = _schedule_index.node_table[slot] - 1;
+        if (_schedule_vars.active_schedule_ptr->cells[cell_index].assigned_node_id == node_id) {
+            return cell_index;
+        }
+    }
+    return -1;
+}
+
+static void _node_table_insert(uint64_t node_id, uint16_t cell_index) {
+    size_t slot = _node_table_home(node_id);
+    while (_schedule_index.node_table[slot] != 0) {
+        slot = (slot + 1) % MARI_NODE_TABLE_SIZE;
+    }
+    _schedule_index.node_table[slot] = cell_index + 1;
+}
+
+static void _node_table_remove(uint64_t node_id) {
+    cell_t *cells = _schedule_vars.active_schedule_ptr->cells;
+
+    size_t slot = _node_table_home(node_id);
+    while (_schedule_index.node_table[slot] != 0 && cells[_schedule_index.node_table[slot] - 1].assigned_node_id != node_id) {
+        slot = (slot + 1) % MARI_NODE_TABLE_SIZE;
+    }
+    if (_schedule_index.node_table[slot] == 0) {
+        return;
+    }
+
+    // backward shift deletion: move up the entries that would not be found anymore once the slot is empty
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) % MARI_NODE_TABLE_SIZE;
+        if (_schedule_index.node_table[next] == 0) {
+            break;
+        }
+        size_t home = _node_table_home(cells[_schedule_index.node_table[next] - 1].assigned_node_id);
+        bool   stays;  // true if home is cyclically in (slot, next]
+        if (slot <= next) {
+            stays = slot < home && home <= next;
+        } else {
+            stays = slot < home || home <= next;
+        }
+        if (!stays) {
+            _schedule_index.node_table[slot] = _schedule_index.node_table[next];
+            slot                             = next;
+        }
+    }
+    _schedule_index.node_table[slot] = 0;
+}
+
 void _compute_gateway_action(cell_t cell, mr_slot_info_t *slot_info) {
     switch (cell.type) {
         case SLOT_TYPE_BEACON:
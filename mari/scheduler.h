@@ -21,6 +21,10 @@
 
 //=========================== defines ==========================================
 
+#define MARI_ENABLE_SCHEDULE_MIGRATION  1  // the gateway switches between the available schedules as nodes join and leave
+#define MARI_SCHEDULE_SWITCH_SLOTFRAMES 3  // a schedule switch is announced in the beacons at least this many slotframes in advance
+#define MARI_SCHEDULE_GROW_MARGIN       1  // switch to a bigger schedule when this many uplink cells (or fewer) are still free
+
 //=========================== prototypes ==========================================
 
 /**
@@ -52,29 +56,128 @@ bool mr_scheduler_set_schedule(uint8_t schedule_id);
 
 uint32_t mr_scheduler_get_duration_us(void);
 
+/**
+ * @brief Plans a switch to another schedule.
+ *
+ * Assigned uplink cells are carried over by ordinal: the node using the n-th uplink cell of the current schedule
+ * uses the n-th uplink cell of the next one.
+ *
+ * @param[in] schedule_id       Schedule ID
+ * @param[in] switch_asn        First ASN of the new schedule, a multiple of its number of cells
+ *
+ * @return true if the schedule exists, false otherwise
+ */
+bool mr_scheduler_set_next_schedule(uint8_t schedule_id, uint64_t switch_asn);
+
+/**
+ * @brief Gets the planned schedule switch, if any.
+ *
+ * @param[out] switch_asn       First ASN of the new schedule
+ *
+ * @return The ID of the next schedule, or 0 if no switch is planned
+ */
+uint8_t mr_scheduler_get_next_schedule(uint64_t *switch_asn);
+
 int16_t mr_scheduler_gateway_assign_next_available_uplink_cell(uint64_t node_id, uint64_t asn);
 
 bool mr_scheduler_node_assign_myself_to_cell(uint16_t cell_index);
 
 void mr_scheduler_node_deassign_myself_from_schedule(void);
 
-void mr_scheduler_gateway_decrease_nodes_counter(void);
+/**
+ * @brief Gets the ordinal of the uplink cell assigned to this node, i.e. its position among the uplink cells.
+ *
+ * The ordinal of a node does not change when the schedule migrates.
+ *
+ * @return Ordinal of the cell, or -1 if this node has no cell
+ */
+int16_t mr_scheduler_node_get_uplink_ordinal(void);
 
-uint8_t mr_scheduler_gateway_remaining_capacity(void);
+/**
+ * @brief Frees the uplink cell of a node that left.
+ *
+ * @param[in] cell_index        Index of the cell in the active schedule
+ */
+void mr_scheduler_gateway_release_cell(uint16_t cell_index);
 
-uint8_t mr_scheduler_gateway_get_nodes_count(void);
+/**
+ * @brief Records that a node was heard from, so that it is not timed out.
+ *
+ * @param[in] node_id           Node ID
+ * @param[in] asn               ASN of the packet received from the node
+ *
+ * @return false if the node has no cell
+ */
+bool mr_scheduler_gateway_keep_node_alive(uint64_t node_id, uint64_t asn);
+
+uint16_t mr_scheduler_gateway_remaining_capacity(void);
 
-uint8_t mr_scheduler_gateway_get_nodes(uint64_t *nodes);
+uint16_t mr_scheduler_gateway_get_nodes_count(void);
+
+uint16_t mr_scheduler_gateway_get_nodes(uint64_t *nodes);
+
+/**
+ * @brief Gets the uplink cell assigned to a node, in constant time.
+ *
+ * @param[in] node_id           Node ID
+ *
+ * @return Index of the cell in the active schedule, or -1 if the node has no cell
+ */
+int16_t mr_scheduler_gateway_get_node_cell(uint64_t node_id);
+
+/**
+ * @brief Gets the ordinal of the uplink cell assigned to a node, in constant time.
+ *
+ * @param[in] node_id           Node ID
+ *
+ * @return Ordinal of the cell, or -1 if the node has no cell
+ */
+int16_t mr_scheduler_gateway_get_node_ordinal(uint64_t node_id);
+
+/**
+ * @brief Gets one of the available schedules, without activating it.
+ *
+ * @param[in] schedule_id       Schedule ID
+ *
+ * @return Pointer to the schedule, or NULL if it is not available
+ */
+schedule_t *mr_scheduler_get_schedule_ptr(uint8_t schedule_id);
 
 schedule_t *mr_scheduler_get_active_schedule_ptr(void);
 
-uint8_t mr_scheduler_get_active_schedule_slot_count(void);
+uint16_t mr_scheduler_get_active_schedule_slot_count(void);
 
 cell_t mr_scheduler_node_peek_slot(uint64_t asn);
 
-void mr_scheduler_stats_register_used_slot(bool used);
+uint16_t mr_scheduler_get_current_cell_index(void);
 
-uint64_t *mr_scheduler_get_schedule_usage(void);
+/**
+ * @brief Counts a radio event in the statistics of the current cell.
+ *
+ * @param[in] event         What happened in the current slot
+ */
+void mr_scheduler_stats_register(mr_cell_stats_event_t event);
+
+/**
+ * @brief Counts a radio event in the statistics of a cell, e.g. once the slot it happened in is over.
+ *
+ * @param[in] cell_index    Cell of the active schedule, nothing is counted if it is out of range
+ * @param[in] event         What happened in that cell
+ */
+void mr_scheduler_stats_register_cell(uint16_t cell_index, mr_cell_stats_event_t event);
+
+/**
+ * @brief Copies the next page of the last complete statistics window.
+ *
+ * Successive calls walk through the whole schedule, wrapping around at the end.
+ *
+ * @param[out] stats        Buffer receiving up to max_len entries
+ * @param[out] offset       Index of the cell described by stats[0]
+ * @param[in]  max_len      Maximum number of entries to copy
+ *
+ * @return Number of entries copied
+ */
+uint8_t mr_scheduler_stats_get_cells(mr_cell_stats_t *stats, uint16_t *offset, uint8_t max_len);
 
 /**
  * @brief Computes the channel to be used in a given slot.
@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @ingroup     stats
+ *
+ * @brief       Counters of what happened in all the modules
+ *
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ *
+ * @copyright Anon, 2025
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mr_radio.h"
+#include "stats.h"
+
+//=========================== variables ========================================
+
+uint32_t mr_stats_counters[MARI_STATS_N] = { 0 };
+
+static uint32_t _radio_crc_errors = 0;  // reading of the radio driver counter at the previous snapshot
+
+//=========================== public ===========================================
+
+void mr_stats_init(void) {
+    for (size_t i = 0; i < MARI_STATS_N; i++) {
+        __atomic_store_n(&mr_stats_counters[i], 0, __ATOMIC_RELAXED);
+    }
+    _radio_crc_errors = mr_radio_get_crc_errors();
+}
+
+void mr_stats_snapshot(uint32_t *counters) {
+    for (size_t i = 0; i < MARI_STATS_N; i++) {
+        counters[i] = __atomic_exchange_n(&mr_stats_counters[i], 0, __ATOMIC_RELAXED);
+    }
+
+    // the driver does not know about mari, so it keeps its own counter, which only goes up
+    uint32_t crc_errors                = mr_radio_get_crc_errors();
+    counters[MARI_STATS_RX_CRC_ERRORS] = crc_errors - _radio_crc_errors;
+    _radio_crc_errors                  = crc_errors;
+}
@@ -0,0 +1,43 @@
+#ifndef __STATS_H
+#define __STATS_H
+
+/**
+ * @ingroup     mari
+ * @brief       Counters of what happened in all the modules, e.g. drops, timeouts and handovers
+ *
+ * A single block of 32-bit counters, indexed by mr_stats_counter_t. Counters are incremented without any lock,
+ * with an atomic add, so they can be incremented from the radio and timer interrupts as well as from the main loop.
+ * A snapshot swaps each counter with 0, so no increment is lost between the snapshot and the reset.
+ *
+ * @{
+ * @file
+ * @author Anonymous Anon <anonymous.anon@anon.org>
+ * @copyright Anon, 2025-now
+ * @}
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "models.h"
+
+//=========================== variables ========================================
+
+extern uint32_t mr_stats_counters[MARI_STATS_N];
+
+//=========================== prototypes =======================================
+
+void mr_stats_init(void);
+
+/**
+ * @brief Copies all the counters into counters, and sets them back to 0
+ *
+ * @param[out] counters  MARI_STATS_N counters, in the order of mr_stats_counter_t
+ */
+void mr_stats_snapshot(uint32_t *counters);
+
+static inline void mr_stats_inc(mr_stats_counter_t counter) {
+    __atomic_fetch_add(&mr_stats_counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+#endif  // __STATS_H